@@ -0,0 +1,340 @@
+/**
+ * @file basket.cpp
+ * @brief Implementation of the Basket class
+ *
+ * Numbers and strings are written straight into the target buffers; no
+ * intermediate QString, QJsonDocument or UTF-8 conversion is involved.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "basket.h"
+
+namespace {
+
+constexpr int EstimatedItemLength = 64;    ///< Typical serialized size of one payment item
+constexpr int EstimatedHeaderLength = 96;  ///< Typical serialized size of the header fields
+
+/**
+ * @brief Appends a decimal integer without creating a temporary string.
+ *
+ * @param out Buffer to append to
+ * @param value The number
+ */
+void appendInteger(QString& out, qint64 value)
+{
+    QChar digits[20];
+    int pos = 20;
+
+    // Work on the negative value so the minimum qint64 needs no special case
+    const bool negative = value < 0;
+    qint64 rest = negative ? value : -value;
+    do {
+        digits[--pos] = QChar(ushort('0' - rest % 10));
+        rest /= 10;
+    } while (rest != 0);
+
+    if (negative) {
+        out.append(QLatin1Char('-'));
+    }
+    out.append(digits + pos, 20 - pos);
+}
+
+/**
+ * @brief Appends a JSON string literal, escaping as required by RFC 8259.
+ *
+ * Runs of characters that need no escaping are appended in one piece.
+ *
+ * @param out Buffer to append to
+ * @param value The string contents
+ */
+void appendJsonString(QString& out, QStringView value)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out.append(QLatin1Char('"'));
+    const QChar* const begin = value.data();
+    const QChar* const end = begin + value.size();
+    const QChar* run = begin;
+
+    for (const QChar* p = begin; p != end; ++p) {
+        const ushort c = p->unicode();
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out.append(run, int(p - run));
+        run = p + 1;
+
+        switch (c) {
+        case '"':  out.append(QLatin1String("\\\"")); break;
+        case '\\': out.append(QLatin1String("\\\\")); break;
+        case '\b': out.append(QLatin1String("\\b")); break;
+        case '\f': out.append(QLatin1String("\\f")); break;
+        case '\n': out.append(QLatin1String("\\n")); break;
+        case '\r': out.append(QLatin1String("\\r")); break;
+        case '\t': out.append(QLatin1String("\\t")); break;
+        default: {
+            const char escape[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out.append(QLatin1String(escape, 6));
+            break;
+        }
+        }
+    }
+
+    out.append(run, int(end - run));
+    out.append(QLatin1Char('"'));
+}
+
+} // namespace
+
+/**
+ * @brief Constructor for the Basket class.
+ *
+ * Creates an empty basket with document type 0.
+ */
+Basket::Basket()
+    : m_documentType(0)
+    , m_taxFreeAmount(0)
+    , m_headerDirty(true)
+    , m_jsonDirty(true)
+{
+}
+
+/**
+ * @brief Reserves room for the given number of payment items.
+ *
+ * @param items Expected number of items
+ */
+void Basket::reserve(int items)
+{
+    m_entries.reserve(items);
+    m_json.reserve(EstimatedHeaderLength + items * EstimatedItemLength);
+}
+
+/**
+ * @brief Sets the fiscal document type.
+ *
+ * @param documentType Document type code
+ */
+void Basket::setDocumentType(int documentType)
+{
+    if (m_documentType != documentType) {
+        m_documentType = documentType;
+        m_headerDirty = m_jsonDirty = true;
+    }
+}
+
+/**
+ * @brief Returns the fiscal document type.
+ *
+ * @return Document type code
+ */
+int Basket::documentType() const
+{
+    return m_documentType;
+}
+
+/**
+ * @brief Sets the tax-free amount.
+ *
+ * @param amount Amount in minor currency units
+ */
+void Basket::setTaxFreeAmount(qint64 amount)
+{
+    if (m_taxFreeAmount != amount) {
+        m_taxFreeAmount = amount;
+        m_headerDirty = m_jsonDirty = true;
+    }
+}
+
+/**
+ * @brief Returns the tax-free amount.
+ *
+ * @return Amount in minor currency units
+ */
+qint64 Basket::taxFreeAmount() const
+{
+    return m_taxFreeAmount;
+}
+
+/**
+ * @brief Sets the customer's tax ID.
+ *
+ * @param taxId Tax ID, or an empty string for no customer information
+ */
+void Basket::setCustomerTaxId(const QString& taxId)
+{
+    if (m_customerTaxId != taxId) {
+        m_customerTaxId = taxId;
+        m_headerDirty = m_jsonDirty = true;
+    }
+}
+
+/**
+ * @brief Returns the customer's tax ID.
+ *
+ * @return Tax ID, empty if not set
+ */
+QString Basket::customerTaxId() const
+{
+    return m_customerTaxId;
+}
+
+/**
+ * @brief Appends a payment item.
+ *
+ * @param item The item to append
+ * @return Index of the new item
+ */
+int Basket::addPaymentItem(const PaymentItem& item)
+{
+    Entry entry;
+    entry.item = item;
+    m_entries.append(entry);
+    m_jsonDirty = true;
+    return m_entries.size() - 1;
+}
+
+/**
+ * @brief Replaces a payment item.
+ *
+ * Setting an item to its current contents keeps the cached fragment.
+ *
+ * @param index Index of the item
+ * @param item The new contents
+ */
+void Basket::setPaymentItem(int index, const PaymentItem& item)
+{
+    Entry& entry = m_entries[index];
+    if (entry.item != item) {
+        entry.item = item;
+        entry.dirty = true;
+        m_jsonDirty = true;
+    }
+}
+
+/**
+ * @brief Removes a payment item.
+ *
+ * @param index Index of the item
+ */
+void Basket::removePaymentItem(int index)
+{
+    m_entries.remove(index);
+    m_jsonDirty = true;
+}
+
+/**
+ * @brief Returns a payment item.
+ *
+ * @param index Index of the item
+ * @return The item
+ */
+const PaymentItem& Basket::paymentItem(int index) const
+{
+    return m_entries.at(index).item;
+}
+
+/**
+ * @brief Returns the number of payment items.
+ *
+ * @return Item count
+ */
+int Basket::paymentItemCount() const
+{
+    return m_entries.size();
+}
+
+/**
+ * @brief Removes all payment items and resets the header fields.
+ *
+ * QVector::clear() would release the storage, so the size is reduced with
+ * resize() instead to keep the capacity for the next basket.
+ */
+void Basket::clear()
+{
+    m_documentType = 0;
+    m_taxFreeAmount = 0;
+    m_customerTaxId.clear();
+    m_entries.resize(0);
+    m_headerDirty = m_jsonDirty = true;
+}
+
+/**
+ * @brief Returns the basket as compact JSON.
+ *
+ * @return The serialized document
+ */
+const QString& Basket::toJson() const
+{
+    if (!m_jsonDirty) {
+        return m_json;
+    }
+
+    if (m_headerDirty) {
+        encodeHeader();
+    }
+
+    int length = m_header.size() + 2;
+    for (Entry& entry : m_entries) {
+        if (entry.dirty) {
+            encodeItem(entry);
+        }
+        length += entry.fragment.size() + 1;
+    }
+
+    // resize(0) keeps the capacity as long as nobody else holds the buffer
+    m_json.resize(0);
+    m_json.reserve(length);
+    m_json.append(m_header);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (i > 0) {
+            m_json.append(QLatin1Char(','));
+        }
+        m_json.append(m_entries.at(i).fragment);
+    }
+    m_json.append(QLatin1String("]}"));
+
+    m_jsonDirty = false;
+    return m_json;
+}
+
+/**
+ * @brief Re-encodes the header fields.
+ */
+void Basket::encodeHeader() const
+{
+    m_header.resize(0);
+    m_header.append(QLatin1String("{\"documentType\":"));
+    appendInteger(m_header, m_documentType);
+    m_header.append(QLatin1String(",\"taxFreeAmount\":"));
+    appendInteger(m_header, m_taxFreeAmount);
+    if (!m_customerTaxId.isEmpty()) {
+        m_header.append(QLatin1String(",\"customerInfo\":{\"taxID\":"));
+        appendJsonString(m_header, m_customerTaxId);
+        m_header.append(QLatin1Char('}'));
+    }
+    m_header.append(QLatin1String(",\"paymentItems\":["));
+    m_headerDirty = false;
+}
+
+/**
+ * @brief Re-encodes one payment item into its fragment.
+ *
+ * @param entry The item to encode
+ */
+void Basket::encodeItem(Entry& entry)
+{
+    QString& out = entry.fragment;
+    out.resize(0);
+    out.reserve(EstimatedItemLength + entry.item.description.size());
+    out.append(QLatin1String("{\"amount\":"));
+    appendInteger(out, entry.item.amount);
+    out.append(QLatin1String(",\"description\":"));
+    appendJsonString(out, entry.item.description);
+    out.append(QLatin1String(",\"type\":"));
+    appendInteger(out, entry.item.type);
+    out.append(QLatin1Char('}'));
+    entry.dirty = false;
+}
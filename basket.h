@@ -0,0 +1,169 @@
+#ifndef BASKET_H
+#define BASKET_H
+
+/**
+ * @file basket.h
+ * @brief Typed basket document with incremental JSON serialization
+ *
+ * This header declares the Basket class and its PaymentItem entries. A basket
+ * keeps the serialized JSON of every item and only re-encodes the parts that
+ * changed, so rebuilding a large basket after each scan costs one copy of the
+ * cached fragments into a reused output buffer instead of a full re-encode.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/**
+ * @brief One payment entry of a basket
+ */
+struct PaymentItem
+{
+    qint64 amount = 0;    ///< Amount in minor currency units (e.g. cents)
+    QString description;  ///< Text shown on the terminal and receipt
+    int type = 0;         ///< Payment type code defined by the IntegrationHub
+
+    bool operator==(const PaymentItem& other) const
+    {
+        return amount == other.amount && type == other.type && description == other.description;
+    }
+    bool operator!=(const PaymentItem& other) const { return !(*this == other); }
+};
+
+/**
+ * @class Basket
+ * @brief Basket document sent to the terminal with POSCommunication::sendBasket()
+ *
+ * Serializes to the IntegrationHub basket format:
+ * @code
+ * {"documentType":9008,"taxFreeAmount":5000,"customerInfo":{"taxID":"11111111111"},
+ *  "paymentItems":[{"amount":5000,"description":"Nakit","type":1}]}
+ * @endcode
+ *
+ * Not thread-safe; build a basket on one thread and hand the result of
+ * toJson() to POSCommunication, which shares the string without copying it.
+ */
+class Basket
+{
+public:
+    Basket();
+
+    /**
+     * @brief Reserves room for the given number of payment items
+     * @param items Expected number of items
+     *
+     * Also reserves the output buffer, so serializing a basket of this size
+     * does not reallocate.
+     */
+    void reserve(int items);
+
+    /**
+     * @brief Sets the fiscal document type
+     * @param documentType Document type code defined by the IntegrationHub
+     */
+    void setDocumentType(int documentType);
+    int documentType() const;
+
+    /**
+     * @brief Sets the tax-free amount
+     * @param amount Amount in minor currency units
+     */
+    void setTaxFreeAmount(qint64 amount);
+    qint64 taxFreeAmount() const;
+
+    /**
+     * @brief Sets the customer's tax ID
+     * @param taxId Tax ID; customerInfo is omitted from the document when empty
+     */
+    void setCustomerTaxId(const QString& taxId);
+    QString customerTaxId() const;
+
+    /**
+     * @brief Appends a payment item
+     * @param item The item to append
+     * @return Index of the new item
+     */
+    int addPaymentItem(const PaymentItem& item);
+
+    /**
+     * @brief Replaces a payment item
+     * @param index Index of the item, must be valid
+     * @param item The new contents
+     *
+     * Only this item is re-encoded on the next toJson().
+     */
+    void setPaymentItem(int index, const PaymentItem& item);
+
+    /**
+     * @brief Removes a payment item
+     * @param index Index of the item, must be valid
+     */
+    void removePaymentItem(int index);
+
+    /**
+     * @brief Returns a payment item
+     * @param index Index of the item, must be valid
+     * @return The item
+     */
+    const PaymentItem& paymentItem(int index) const;
+
+    /**
+     * @brief Returns the number of payment items
+     * @return Item count
+     */
+    int paymentItemCount() const;
+
+    /**
+     * @brief Removes all payment items and resets the header fields
+     *
+     * Keeps the allocated buffers for the next basket.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the basket as compact JSON
+     * @return The serialized document
+     *
+     * Re-encodes only the fields and items changed since the last call and
+     * rebuilds the output in a buffer that keeps its capacity. If a previous
+     * result is still referenced (e.g. by a request in flight), the buffer is
+     * detached once instead of being overwritten.
+     */
+    const QString& toJson() const;
+
+private:
+    /**
+     * @brief Payment item with its cached JSON fragment
+     */
+    struct Entry
+    {
+        PaymentItem item;     ///< Item contents
+        QString fragment;     ///< Serialized item, valid unless dirty
+        bool dirty = true;    ///< Whether fragment must be re-encoded
+    };
+
+    /**
+     * @brief Re-encodes the header fields into m_header
+     */
+    void encodeHeader() const;
+
+    /**
+     * @brief Re-encodes one item into its fragment
+     * @param entry The item to encode
+     */
+    static void encodeItem(Entry& entry);
+
+    int m_documentType;                ///< Fiscal document type code
+    qint64 m_taxFreeAmount;            ///< Tax-free amount in minor units
+    QString m_customerTaxId;           ///< Customer tax ID, may be empty
+    mutable QVector<Entry> m_entries;  ///< Items with cached fragments
+    mutable QString m_header;          ///< Serialized header up to "paymentItems":[
+    mutable QString m_json;            ///< Reused output buffer
+    mutable bool m_headerDirty;        ///< Whether m_header must be re-encoded
+    mutable bool m_jsonDirty;          ///< Whether m_json must be rebuilt
+};
+
+#endif // BASKET_H
@@ -0,0 +1,292 @@
+/**
+ * @file basketoutbox.cpp
+ * @brief Implementation of the BasketOutbox class
+ *
+ * Baskets are handed to the device worker one at a time. A refused basket
+ * can then be resent without a newer one overtaking it, and the worker's
+ * bounded command queue stays available for other requests while a long
+ * backlog drains. The store file is only written for baskets that actually
+ * have to wait, so a connected terminal costs no disk I/O.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "basketoutbox.h"
+#include "poslogging.h"
+#include <QFile>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+
+/**
+ * @brief Constructor for the BasketOutbox class.
+ *
+ * @param communication The terminal to send baskets to
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+BasketOutbox::BasketOutbox(POSCommunication* communication, QObject* parent)
+    : QObject(parent)
+    , m_communication(communication)
+    , m_capacity(DefaultCapacity)
+    , m_sending(false)
+    , m_nextId(1)
+{
+    m_retryTimer.setSingleShot(true);
+    QObject::connect(&m_retryTimer, &QTimer::timeout, this, &BasketOutbox::pump);
+    QObject::connect(communication, &POSCommunication::stateChanged, this, &BasketOutbox::onStateChanged);
+}
+
+/**
+ * @brief Keeps queued baskets in a file and loads the ones left there.
+ *
+ * @param path Store file
+ * @return true on success, false if an existing file cannot be read
+ */
+bool BasketOutbox::setStoreFile(const QString& path)
+{
+    m_storePath = path;
+
+    QFile file(path);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(lcPosRequest) << "Cannot read basket store" << path << ":" << file.errorString();
+        return false;
+    }
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+    if (!document.isArray()) {
+        qCWarning(lcPosRequest) << path << "is not a basket store";
+        return false;
+    }
+
+    for (const QJsonValue& value : document.array()) {
+        const QJsonObject object = value.toObject();
+        Item item;
+        item.id = quint64(object.value("id").toDouble());
+        item.data = object.value("data").toString();
+        item.stored = true;
+        if (item.id == 0 || item.data.isEmpty()) {
+            continue;
+        }
+        m_nextId = std::max(m_nextId, item.id + 1);
+        m_items.push_back(std::move(item));
+    }
+
+    if (!m_items.empty()) {
+        qCInfo(lcPosRequest) << "Loaded" << m_items.size() << "queued baskets from" << path;
+        pump();
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the maximum number of queued baskets.
+ *
+ * @param capacity Limit, at least 1
+ */
+void BasketOutbox::setCapacity(int capacity)
+{
+    m_capacity = std::max(1, capacity);
+}
+
+/**
+ * @brief Returns the maximum number of queued baskets.
+ *
+ * @return The limit
+ */
+int BasketOutbox::capacity() const
+{
+    return m_capacity;
+}
+
+/**
+ * @brief Queues a basket for the terminal.
+ *
+ * @param jsonData JSON-formatted basket details
+ * @return Basket ID, or 0 if the outbox is full
+ */
+quint64 BasketOutbox::submit(const QString& jsonData)
+{
+    if (int(m_items.size()) >= m_capacity) {
+        return 0;
+    }
+
+    Item item;
+    item.id = m_nextId++;
+    item.data = jsonData;
+    m_items.push_back(std::move(item));
+    const quint64 id = m_items.back().id;
+
+    pump();
+    if (!m_items.empty() && m_items.back().id == id && !m_items.back().inFlight) {
+        save();
+    }
+    return id;
+}
+
+/**
+ * @brief Queues a typed basket for the terminal.
+ *
+ * @param basket The basket to send
+ * @return Basket ID, or 0 if the outbox is full
+ */
+quint64 BasketOutbox::submit(const Basket& basket)
+{
+    return submit(basket.toJson());
+}
+
+/**
+ * @brief Returns the number of baskets not yet completed.
+ *
+ * @return Queued and in-flight baskets
+ */
+int BasketOutbox::pendingCount() const
+{
+    return int(m_items.size());
+}
+
+/**
+ * @brief Forwards the queue once the terminal is connected.
+ *
+ * @param state The new connection state
+ */
+void BasketOutbox::onStateChanged(POSCommunication::State state)
+{
+    if (state == POSCommunication::Connected) {
+        pump();
+    }
+}
+
+/**
+ * @brief Hands the oldest queued basket to the device worker.
+ *
+ * Only one basket is in flight at a time, so one the worker refuses is
+ * resent before any newer basket is sent.
+ */
+void BasketOutbox::pump()
+{
+    if (m_sending || m_items.empty() || !m_communication || !m_communication->isConnected()) {
+        return;
+    }
+
+    Item& item = m_items.front();
+    item.inFlight = true;
+    m_sending = true;
+
+    const quint64 id = item.id;
+    auto* watcher = new QFutureWatcher<int>(this);
+    QObject::connect(watcher, &QFutureWatcher<int>::finished, this, [this, watcher, id]() {
+        watcher->deleteLater();
+        onSendFinished(id, watcher->future());
+    });
+    watcher->setFuture(m_communication->sendBasketAsync(item.data));
+}
+
+/**
+ * @brief Handles the outcome of one send.
+ *
+ * A basket the device worker refused before it reached the terminal goes
+ * back to the queue and is resent after RetryDelayMs; isConnected() may not
+ * report a lost connection yet. Anything else completes it, including a
+ * timeout, since the hung call may already have delivered the basket.
+ *
+ * @param id Basket ID
+ * @param future The finished request
+ */
+void BasketOutbox::onSendFinished(quint64 id, const QFuture<int>& future)
+{
+    m_sending = false;
+
+    const auto it = std::find_if(m_items.begin(), m_items.end(), [id](const Item& item) { return item.id == id; });
+    if (it == m_items.end()) {
+        return;
+    }
+
+    int result = 0;
+    QString error;
+    try {
+        result = future.result();
+    } catch (const DeviceException& e) {
+        if (e.error() == DeviceException::QueueFull || e.error() == DeviceException::NotConnected
+            || e.error() == DeviceException::Stopped) {
+            requeue(id);
+            m_retryTimer.start(RetryDelayMs);
+            return;
+        }
+        error = QString::fromUtf8(e.what());
+    } catch (const std::exception& e) {
+        error = QString::fromUtf8(e.what());
+    }
+
+    const bool stored = it->stored;
+    m_items.erase(it);
+    if (stored) {
+        save();
+    }
+
+    if (error.isNull()) {
+        emit delivered(id, result);
+    } else {
+        emit failed(id, error);
+    }
+    pump();
+}
+
+/**
+ * @brief Returns a basket to the queue after the device worker refused it.
+ *
+ * @param id Basket ID
+ */
+void BasketOutbox::requeue(quint64 id)
+{
+    const auto it = std::find_if(m_items.begin(), m_items.end(), [id](const Item& item) { return item.id == id; });
+    if (it == m_items.end()) {
+        return;
+    }
+    it->inFlight = false;
+    if (!it->stored) {
+        save();
+    }
+}
+
+/**
+ * @brief Writes the baskets still waiting to the store file.
+ *
+ * The file is replaced atomically, and removed once the outbox is empty.
+ */
+void BasketOutbox::save()
+{
+    if (m_storePath.isEmpty()) {
+        return;
+    }
+    if (m_items.empty()) {
+        QFile::remove(m_storePath);
+        return;
+    }
+
+    QJsonArray array;
+    for (const Item& item : m_items) {
+        QJsonObject object;
+        object.insert("id", double(item.id));
+        object.insert("data", item.data);
+        array.append(object);
+    }
+
+    QSaveFile file(m_storePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcPosRequest) << "Cannot write basket store" << m_storePath << ":" << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qCWarning(lcPosRequest) << "Cannot write basket store" << m_storePath << ":" << file.errorString();
+        return;
+    }
+    for (Item& item : m_items) {
+        item.stored = true;
+    }
+}
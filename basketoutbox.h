@@ -0,0 +1,163 @@
+#ifndef BASKETOUTBOX_H
+#define BASKETOUTBOX_H
+
+/**
+ * @file basketoutbox.h
+ * @brief Store-and-forward queue for baskets sent while the terminal is offline
+ *
+ * This header declares the BasketOutbox class. sendBasket() fails with "Not
+ * connected" while the terminal is away, which leaves retrying to the caller.
+ * The outbox accepts baskets in any state instead, keeps the ones that cannot
+ * be sent yet, optionally on disk, and forwards them in order once the
+ * terminal is back.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include <deque>
+#include "basket.h"
+#include "poscommunication.h"
+
+/**
+ * @class BasketOutbox
+ * @brief Bounded, optionally persistent queue of baskets for one terminal
+ *
+ * submit() returns at once with an ID. While the terminal is connected the
+ * basket is sent right away; otherwise it waits in the outbox and is sent,
+ * together with everything queued before it, as soon as stateChanged reports
+ * Connected again. Each basket completes with exactly one delivered() or
+ * failed() carrying its ID.
+ *
+ * Baskets are sent one at a time, so a basket refused before it reached the
+ * terminal (not connected, command queue full, worker stopped) is kept and
+ * resent without being overtaken by a newer one. Any other error completes
+ * the basket with failed(), including a timed-out call, since the terminal
+ * may have received the basket before the call hung.
+ * With a store file set, queued baskets survive a restart.
+ *
+ * The outbox lives on the thread that owns the POSCommunication; it must not
+ * outlive it.
+ */
+class BasketOutbox : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultCapacity = 256;  ///< Default maximum number of queued baskets
+    static constexpr int RetryDelayMs = 100;     ///< Wait before resending a basket the device worker refused
+
+    /**
+     * @brief Constructor for BasketOutbox
+     * @param communication The terminal to send baskets to
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit BasketOutbox(POSCommunication* communication, QObject* parent = nullptr);
+
+    /**
+     * @brief Keeps queued baskets in a file and loads the ones left there
+     * @param path Store file; created when the first basket has to wait
+     * @return true on success, false if an existing file cannot be read
+     *
+     * Call before submitting. Loaded baskets keep their IDs and are sent once
+     * the terminal is connected.
+     */
+    bool setStoreFile(const QString& path);
+
+    /**
+     * @brief Sets the maximum number of queued baskets
+     * @param capacity Limit, at least 1; baskets already queued are kept
+     */
+    void setCapacity(int capacity);
+    int capacity() const;
+
+    /**
+     * @brief Queues a basket for the terminal
+     * @param jsonData JSON-formatted basket details
+     * @return Basket ID used by delivered() and failed(), or 0 if the outbox is full
+     */
+    quint64 submit(const QString& jsonData);
+
+    /**
+     * @brief Queues a typed basket for the terminal
+     * @param basket The basket to send
+     * @return Basket ID used by delivered() and failed(), or 0 if the outbox is full
+     */
+    quint64 submit(const Basket& basket);
+
+    /**
+     * @brief Returns the number of baskets not yet completed
+     * @return Queued and in-flight baskets
+     */
+    int pendingCount() const;
+
+signals:
+    /**
+     * @brief Signal emitted when the terminal has accepted a basket
+     * @param id Basket ID returned by submit()
+     * @param result Result code from the terminal
+     */
+    void delivered(quint64 id, int result);
+
+    /**
+     * @brief Signal emitted when the terminal has rejected a basket
+     * @param id Basket ID returned by submit()
+     * @param error Human-readable error description
+     */
+    void failed(quint64 id, const QString& error);
+
+private slots:
+    /**
+     * @brief Forwards the queue once the terminal is connected
+     * @param state The new connection state
+     */
+    void onStateChanged(POSCommunication::State state);
+
+private:
+    /**
+     * @brief A basket waiting for the terminal
+     */
+    struct Item
+    {
+        quint64 id = 0;          ///< Basket ID
+        QString data;            ///< JSON sent to the terminal
+        bool inFlight = false;   ///< Whether it has been handed to the device worker
+        bool stored = false;     ///< Whether it is in the store file
+    };
+
+    /**
+     * @brief Hands the oldest queued basket to the device worker unless one is in flight
+     */
+    void pump();
+
+    /**
+     * @brief Handles the outcome of one send
+     * @param id Basket ID
+     * @param future The finished request
+     */
+    void onSendFinished(quint64 id, const QFuture<int>& future);
+
+    /**
+     * @brief Returns a basket to the queue after the device worker refused it
+     * @param id Basket ID
+     */
+    void requeue(quint64 id);
+
+    /**
+     * @brief Writes the baskets still waiting to the store file
+     */
+    void save();
+
+    QPointer<POSCommunication> m_communication;  ///< Terminal the baskets are sent to
+    std::deque<Item> m_items;                    ///< Baskets not yet completed, oldest first
+    QString m_storePath;                         ///< Store file, empty if not persistent
+    QTimer m_retryTimer;                         ///< Resends after the device worker refused a basket
+    int m_capacity;                              ///< Maximum number of baskets in m_items
+    bool m_sending;                              ///< Whether a basket is with the device worker
+    quint64 m_nextId;                            ///< ID for the next basket
+};
+
+#endif // BASKETOUTBOX_H
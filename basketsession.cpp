@@ -0,0 +1,195 @@
+/**
+ * @file basketsession.cpp
+ * @brief Implementation of the BasketSession class
+ *
+ * During fast scanning most edits are superseded before they could reach the
+ * terminal. Only the state at the end of a burst is serialized and sent, and
+ * unchanged items reuse their cached fragments when it is (see Basket).
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "basketsession.h"
+#include <algorithm>
+
+/**
+ * @brief Constructor for the BasketSession class.
+ *
+ * @param communication The terminal to send the basket to
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+BasketSession::BasketSession(POSCommunication* communication, QObject* parent)
+    : QObject(parent)
+    , m_communication(communication)
+    , m_debounceMs(DefaultDebounceMs)
+    , m_sendAfterInFlight(false)
+{
+    m_debounceTimer.setSingleShot(true);
+    QObject::connect(&m_debounceTimer, &QTimer::timeout, this, &BasketSession::onDebounceTimeout);
+    QObject::connect(&m_inFlight, &QFutureWatcher<int>::finished, this, &BasketSession::onSendFinished);
+    QObject::connect(communication, &POSCommunication::stateChanged, this, &BasketSession::onStateChanged);
+}
+
+/**
+ * @brief Returns the basket for editing.
+ *
+ * @return The local basket
+ */
+Basket& BasketSession::basket()
+{
+    return m_basket;
+}
+
+/**
+ * @brief Returns the basket.
+ *
+ * @return The local basket
+ */
+const Basket& BasketSession::basket() const
+{
+    return m_basket;
+}
+
+/**
+ * @brief Sets the pause after which pending edits are sent.
+ *
+ * @param ms Debounce interval in milliseconds
+ */
+void BasketSession::setDebounceInterval(int ms)
+{
+    m_debounceMs = std::max(0, ms);
+}
+
+/**
+ * @brief Returns the pause after which pending edits are sent.
+ *
+ * @return Debounce interval in milliseconds
+ */
+int BasketSession::debounceInterval() const
+{
+    return m_debounceMs;
+}
+
+/**
+ * @brief Schedules the current basket to be sent.
+ *
+ * Each call restarts the timer, but only until the first unsent edit is
+ * MaxDelayIntervals intervals old, so continuous scanning still updates the
+ * terminal regularly.
+ */
+void BasketSession::update()
+{
+    if (!m_debounceTimer.isActive()) {
+        m_pendingSince.start();
+        m_debounceTimer.start(m_debounceMs);
+        return;
+    }
+
+    const qint64 remaining = qint64(m_debounceMs) * MaxDelayIntervals - m_pendingSince.elapsed();
+    if (remaining > 0) {
+        m_debounceTimer.start(int(std::min<qint64>(m_debounceMs, remaining)));
+    }
+}
+
+/**
+ * @brief Sends pending edits immediately.
+ *
+ * The request is queued behind one still in flight, so anything the caller
+ * queues next (e.g. a payment) reaches the terminal after the final basket.
+ */
+void BasketSession::flush()
+{
+    m_debounceTimer.stop();
+    m_sendAfterInFlight = false;
+    send(true);
+}
+
+/**
+ * @brief Clears the basket and forgets what was sent.
+ */
+void BasketSession::reset()
+{
+    m_debounceTimer.stop();
+    m_sendAfterInFlight = false;
+    m_basket.clear();
+    m_lastSent.clear();
+}
+
+/**
+ * @brief Checks if the terminal has the current basket.
+ *
+ * @return true if the last document sent equals the current basket
+ */
+bool BasketSession::isSynced() const
+{
+    return !m_debounceTimer.isActive() && !m_sendAfterInFlight && !m_lastSent.isEmpty()
+        && m_lastSent == m_basket.toJson();
+}
+
+/**
+ * @brief Handles the end of the debounce interval.
+ */
+void BasketSession::onDebounceTimeout()
+{
+    send(false);
+}
+
+/**
+ * @brief Handles completion of the request in flight.
+ *
+ * A failed future is canceled; the terminal's basket is then unknown, so the
+ * next send goes out even if the basket has not changed.
+ */
+void BasketSession::onSendFinished()
+{
+    if (m_inFlight.isCanceled()) {
+        m_lastSent.clear();
+    }
+    if (m_sendAfterInFlight) {
+        m_sendAfterInFlight = false;
+        send(false);
+    }
+}
+
+/**
+ * @brief Resends the basket after the terminal has (re)connected.
+ *
+ * The terminal does not keep the basket across a reconnect.
+ *
+ * @param state The new connection state
+ */
+void BasketSession::onStateChanged(POSCommunication::State state)
+{
+    if (state != POSCommunication::Connected) {
+        return;
+    }
+    m_lastSent.clear();
+    if (m_basket.paymentItemCount() > 0) {
+        update();
+    }
+}
+
+/**
+ * @brief Sends the basket if it differs from the last one sent.
+ *
+ * @param queueBehindInFlight Whether to send even if a request is in flight
+ */
+void BasketSession::send(bool queueBehindInFlight)
+{
+    if (!m_communication) {
+        return;
+    }
+    if (!queueBehindInFlight && m_inFlight.isRunning()) {
+        m_sendAfterInFlight = true;
+        return;
+    }
+
+    const QString& json = m_basket.toJson();
+    if (json == m_lastSent) {
+        return;
+    }
+
+    // Shares the buffer with the queued request; the basket detaches on its next edit
+    m_lastSent = json;
+    m_inFlight.setFuture(m_communication->sendBasketAsync(json));
+}
@@ -0,0 +1,131 @@
+#ifndef BASKETSESSION_H
+#define BASKETSESSION_H
+
+/**
+ * @file basketsession.h
+ * @brief Debounced synchronization of a basket with the terminal
+ *
+ * This header declares the BasketSession class. The IntegrationHub only
+ * accepts complete basket documents, so instead of sending every edit the
+ * session waits for a pause in scanning, sends the final state once, and
+ * skips sends that would not change what the terminal already shows.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+#include "basket.h"
+#include "poscommunication.h"
+
+/**
+ * @class BasketSession
+ * @brief Keeps the basket on one terminal in sync with a local Basket
+ *
+ * Edit basket() and call update() after each change. The session sends the
+ * basket once the edits pause for debounceInterval() milliseconds, or at the
+ * latest after MaxDelayIntervals intervals of continuous editing. At most one
+ * basket request is in flight; edits made meanwhile are sent together when it
+ * completes. Call flush() before a payment so the terminal has the final
+ * basket; requests queued after it run after the basket has been sent.
+ *
+ * Results are reported through POSCommunication::basketCompleted and
+ * POSCommunication::requestFailed. The session lives on the thread that
+ * owns the POSCommunication; it must not outlive it.
+ */
+class BasketSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultDebounceMs = 80;  ///< Default pause that triggers a send
+    static constexpr int MaxDelayIntervals = 5;   ///< Longest wait, in debounce intervals, during continuous editing
+
+    /**
+     * @brief Constructor for BasketSession
+     * @param communication The terminal to send the basket to
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit BasketSession(POSCommunication* communication, QObject* parent = nullptr);
+
+    /**
+     * @brief Returns the basket for editing
+     * @return The local basket; call update() after changing it
+     */
+    Basket& basket();
+    const Basket& basket() const;
+
+    /**
+     * @brief Sets the pause after which pending edits are sent
+     * @param ms Debounce interval in milliseconds; 0 sends on the next event loop pass
+     */
+    void setDebounceInterval(int ms);
+    int debounceInterval() const;
+
+    /**
+     * @brief Schedules the current basket to be sent
+     *
+     * Restarts the debounce timer. Nothing is sent if the basket ends up equal
+     * to the last one sent.
+     */
+    void update();
+
+    /**
+     * @brief Sends pending edits immediately
+     *
+     * Does nothing if the terminal already has the current basket.
+     */
+    void flush();
+
+    /**
+     * @brief Clears the basket and forgets what was sent
+     *
+     * Call after a transaction has completed; the next update() starts a new basket.
+     */
+    void reset();
+
+    /**
+     * @brief Checks if the terminal has the current basket
+     * @return true if no edits are pending and the last send has not failed
+     */
+    bool isSynced() const;
+
+private slots:
+    /**
+     * @brief Handles the end of the debounce interval
+     */
+    void onDebounceTimeout();
+
+    /**
+     * @brief Handles completion of the request in flight
+     */
+    void onSendFinished();
+
+    /**
+     * @brief Resends the basket after the terminal has (re)connected
+     * @param state The new connection state
+     */
+    void onStateChanged(POSCommunication::State state);
+
+private:
+    /**
+     * @brief Sends the basket if it differs from the last one sent
+     * @param queueBehindInFlight Whether to send even if a request is in flight
+     */
+    void send(bool queueBehindInFlight);
+
+    QPointer<POSCommunication> m_communication;  ///< Terminal the basket is sent to
+    Basket m_basket;                             ///< Local basket being edited
+    QString m_lastSent;                          ///< Document of the last send, empty if unknown
+    QTimer m_debounceTimer;                      ///< Fires after a pause in editing
+    QElapsedTimer m_pendingSince;                ///< Time of the first unsent edit
+    int m_debounceMs;                            ///< Pause that triggers a send
+    QFutureWatcher<int> m_inFlight;              ///< Watches the basket request in flight
+    bool m_sendAfterInFlight;                    ///< Whether edits arrived while a request was in flight
+};
+
+#endif // BASKETSESSION_H
@@ -0,0 +1,254 @@
+/**
+ * @file mockintegrationhub.cpp
+ * @brief Stand-in for IntegrationHubCpp.dll used by the benchmark
+ *
+ * This file implements a shared library that exports the same functions as
+ * the IntegrationHub DLL, so POSCommunication can be exercised without a
+ * physical terminal. Every call sleeps for a configurable latency, and each
+ * connection runs a thread that fires serial-in and device-state callbacks at
+ * configurable rates.
+ *
+ * The library is built as IntegrationHubCpp.dll into the benchmark output
+ * directory, where POSCommunication picks it up instead of the real one.
+ *
+ * Platform: Windows
+ */
+
+#include <windows.h>
+#include <oleauto.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define MOCK_EXPORT extern "C" __declspec(dllexport)
+
+typedef void (__stdcall* SerialInCallback)(int, BSTR);
+typedef void (__stdcall* DeviceStateCallback)(bool, BSTR);
+
+namespace {
+
+/**
+ * @brief Behaviour shared by all mock connections
+ *
+ * Values may be changed at any time through mockConfigure(); running
+ * connections pick them up on their next call or callback tick.
+ */
+struct MockConfig
+{
+    std::atomic<int> callLatencyUs{2000};      ///< Time every request takes
+    std::atomic<int> serialInPerSecond{0};     ///< Serial-in callbacks per second
+    std::atomic<int> deviceStatePerSecond{0};  ///< Device-state callbacks per second
+    std::atomic<int> payloadLength{64};        ///< Characters per serial-in payload
+};
+
+MockConfig g_config;
+
+/**
+ * @brief Blocks the calling thread for the given time
+ * @param us Duration in microseconds
+ *
+ * Sleeps for the bulk of the duration and spins for the last millisecond,
+ * because the Windows scheduler tick is far coarser than typical latencies.
+ */
+void waitMicroseconds(int us)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::microseconds(us);
+
+    if (us > 2000) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us - 1000));
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @class MockConnection
+ * @brief Simulated terminal connection returned by createCommunication()
+ */
+class MockConnection
+{
+public:
+    explicit MockConnection(const wchar_t* companyName)
+        : m_companyName(companyName ? companyName : L"")
+        , m_serialIn(nullptr)
+        , m_deviceState(nullptr)
+        , m_running(true)
+        , m_thread(&MockConnection::run, this)
+    {
+    }
+
+    ~MockConnection()
+    {
+        m_running = false;
+        m_thread.join();
+    }
+
+    void setSerialInCallback(SerialInCallback callback)
+    {
+        m_serialIn = callback;
+    }
+
+    void setDeviceStateCallback(DeviceStateCallback callback)
+    {
+        m_deviceState = callback;
+        fireDeviceState();
+    }
+
+    /**
+     * @brief Reports the device as connected again, like the real DLL does
+     */
+    void reconnect()
+    {
+        waitMicroseconds(g_config.callLatencyUs);
+        fireDeviceState();
+    }
+
+private:
+    /**
+     * @brief Delivers one device-state callback for the simulated device
+     */
+    void fireDeviceState()
+    {
+        if (DeviceStateCallback callback = m_deviceState) {
+            BSTR deviceId = SysAllocString(L"MOCK-0001");
+            callback(true, deviceId);
+            SysFreeString(deviceId);
+        }
+    }
+
+    /**
+     * @brief Callback thread
+     *
+     * Wakes up once per millisecond and fires as many callbacks as are due,
+     * so the configured rates hold even above the scheduler's resolution.
+     */
+    void run()
+    {
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point start = Clock::now();
+        int serialRate = 0;
+        int stateRate = 0;
+        long long serialFired = 0;
+        long long stateFired = 0;
+
+        while (m_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            // Restart the accounting whenever the rates are reconfigured
+            if (serialRate != g_config.serialInPerSecond || stateRate != g_config.deviceStatePerSecond) {
+                serialRate = g_config.serialInPerSecond;
+                stateRate = g_config.deviceStatePerSecond;
+                start = Clock::now();
+                serialFired = 0;
+                stateFired = 0;
+            }
+
+            const long long elapsedUs =
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+            const long long serialDue = elapsedUs * serialRate / 1000000;
+            if (serialFired < serialDue) {
+                const std::wstring payload(static_cast<size_t>(g_config.payloadLength), L'x');
+                for (; serialFired < serialDue; ++serialFired) {
+                    if (SerialInCallback callback = m_serialIn) {
+                        BSTR value = SysAllocStringLen(payload.data(), static_cast<UINT>(payload.size()));
+                        callback(static_cast<int>(serialFired % 16), value);
+                        SysFreeString(value);
+                    }
+                }
+            }
+
+            const long long stateDue = elapsedUs * stateRate / 1000000;
+            for (; stateFired < stateDue; ++stateFired) {
+                fireDeviceState();
+            }
+        }
+    }
+
+    std::wstring m_companyName;                  ///< Company name passed to createCommunication()
+    std::atomic<SerialInCallback> m_serialIn;    ///< Registered serial-in callback
+    std::atomic<DeviceStateCallback> m_deviceState; ///< Registered device-state callback
+    std::atomic<bool> m_running;                 ///< Cleared to stop the callback thread
+    std::thread m_thread;                        ///< Thread that fires the callbacks
+};
+
+MockConnection* connection(void* handle)
+{
+    return static_cast<MockConnection*>(handle);
+}
+
+} // namespace
+
+/**
+ * @brief Configures the simulated terminal (mock only, not part of the real DLL)
+ * @param callLatencyUs Time every request takes, in microseconds
+ * @param serialInPerSecond Serial-in callbacks fired per second and connection
+ * @param deviceStatePerSecond Device-state callbacks fired per second and connection
+ * @param payloadLength Characters per serial-in payload
+ */
+MOCK_EXPORT void __cdecl mockConfigure(int callLatencyUs, int serialInPerSecond,
+                                       int deviceStatePerSecond, int payloadLength)
+{
+    g_config.callLatencyUs = callLatencyUs;
+    g_config.serialInPerSecond = serialInPerSecond;
+    g_config.deviceStatePerSecond = deviceStatePerSecond;
+    g_config.payloadLength = payloadLength;
+}
+
+MOCK_EXPORT void* __cdecl createCommunication(const wchar_t* companyName)
+{
+    waitMicroseconds(g_config.callLatencyUs);
+    return new MockConnection(companyName);
+}
+
+MOCK_EXPORT void __cdecl deleteCommunication(void* handle)
+{
+    delete connection(handle);
+}
+
+MOCK_EXPORT void __cdecl reconnect(void* handle)
+{
+    connection(handle)->reconnect();
+}
+
+MOCK_EXPORT int __cdecl getActiveDeviceIndex(void* handle)
+{
+    (void)handle;
+    return 0;
+}
+
+MOCK_EXPORT int __cdecl sendBasket(void* handle, const wchar_t* jsonData)
+{
+    (void)handle;
+    (void)jsonData;
+    waitMicroseconds(g_config.callLatencyUs);
+    return 0;
+}
+
+MOCK_EXPORT int __cdecl sendPayment(void* handle, const wchar_t* jsonData)
+{
+    (void)handle;
+    (void)jsonData;
+    waitMicroseconds(g_config.callLatencyUs);
+    return 0;
+}
+
+MOCK_EXPORT BSTR __cdecl getFiscalInfo(void* handle)
+{
+    (void)handle;
+    waitMicroseconds(g_config.callLatencyUs);
+    return SysAllocString(L"{\"serialNumber\":\"MOCK-0001\",\"zNo\":1,\"receiptNo\":1}");
+}
+
+MOCK_EXPORT void __cdecl setSerialInCallback(void* handle, SerialInCallback callback)
+{
+    connection(handle)->setSerialInCallback(callback);
+}
+
+MOCK_EXPORT void __cdecl setDeviceStateCallback(void* handle, DeviceStateCallback callback)
+{
+    connection(handle)->setDeviceStateCallback(callback);
+}
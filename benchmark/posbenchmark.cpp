@@ -0,0 +1,367 @@
+/**
+ * @file posbenchmark.cpp
+ * @brief Throughput and latency benchmark for POSCommunication
+ *
+ * This file contains a console application that drives POSCommunication
+ * against the mock IntegrationHub DLL (Windows) or the simulated backend
+ * (any platform) and reports:
+ * - p50/p99 latency of sendBasket, sendPayment and getFiscalInfo (uncached and cached)
+ * - serial-in callbacks delivered per second, through the serialInReceived
+ *   signal and through a subscribeSerialIn() handler
+ * - heap allocations per serial-in callback
+ *
+ * Both terminals add a fixed latency to every call, so the reported figures
+ * minus that latency are the overhead of the wrapper itself. The mock DLL also
+ * exercises the library backend's BSTR callback path.
+ *
+ * Allocations are counted at the malloc level where possible, since Qt's
+ * containers allocate with malloc() rather than operator new. With glibc,
+ * this executable defines malloc(), calloc() and realloc() in front of the C
+ * library, which interposes them for Qt as well. MSVC debug builds use a CRT
+ * allocation hook, which also sees allocations made inside the Qt DLLs.
+ * Elsewhere only the global operator new of this executable is replaced, and
+ * the report says that Qt container allocations are excluded.
+ *
+ * Platform: Qt C++ cross-platform framework (mock DLL: Windows only)
+ */
+
+#include "librarybackend.h"
+#include "poscommunication.h"
+#include "simulatedbackend.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLibrary>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define POS_BENCHMARK_CRT_HOOK
+#elif defined(__GLIBC__)
+#define POS_BENCHMARK_MALLOC_HOOK
+#endif
+
+#ifdef POS_BENCHMARK_MALLOC_HOOK
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* p, std::size_t size);
+}
+#endif
+
+namespace {
+
+std::atomic<quint64> g_allocations(0);  ///< Heap allocations since start
+
+#if defined(POS_BENCHMARK_CRT_HOOK) || defined(POS_BENCHMARK_MALLOC_HOOK)
+const char* const AllocationScope = "all heap allocations, including Qt";  ///< What g_allocations counts
+#else
+const char* const AllocationScope = "operator new only, Qt container allocations excluded";  ///< What g_allocations counts
+#endif
+
+#ifdef POS_BENCHMARK_CRT_HOOK
+int countAllocation(int allocType, void*, size_t, int, long, const unsigned char*, int)
+{
+    if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    return 1;
+}
+#endif
+
+#ifdef Q_OS_WIN
+typedef void (__cdecl* MockConfigure)(int, int, int, int);
+#endif
+
+/**
+ * @brief Latency percentiles of one call type
+ */
+struct LatencyResult
+{
+    double p50Us = 0.0;  ///< Median latency in microseconds
+    double p99Us = 0.0;  ///< 99th percentile latency in microseconds
+    int failures = 0;    ///< Calls that threw
+};
+
+/**
+ * @brief Returns the given percentile of sorted samples
+ * @param sortedNs Samples in nanoseconds, sorted ascending
+ * @param percentile Percentile in [0, 100]
+ * @return The percentile in microseconds
+ */
+double percentileUs(const std::vector<qint64>& sortedNs, double percentile)
+{
+    if (sortedNs.empty()) {
+        return 0.0;
+    }
+    const size_t index = static_cast<size_t>(percentile / 100.0 * (sortedNs.size() - 1) + 0.5);
+    return sortedNs[index] / 1000.0;
+}
+
+/**
+ * @brief Times a synchronous call repeatedly
+ * @param iterations Number of calls
+ * @param call The call to time
+ * @return Latency percentiles and failure count
+ */
+LatencyResult measure(int iterations, const std::function<void()>& call)
+{
+    std::vector<qint64> samples;
+    samples.reserve(static_cast<size_t>(iterations));
+
+    LatencyResult result;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        try {
+            call();
+        } catch (const std::exception&) {
+            ++result.failures;
+            continue;
+        }
+        samples.push_back(timer.nsecsElapsed());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.p50Us = percentileUs(samples, 50.0);
+    result.p99Us = percentileUs(samples, 99.0);
+    return result;
+}
+
+/**
+ * @brief Runs the event loop until the instance is connected or the timeout expires
+ * @param pos The instance to wait for
+ * @param timeoutMs Maximum time to wait
+ * @return true if connected, false on timeout or failure
+ */
+bool waitForConnected(POSCommunication& pos, int timeoutMs)
+{
+    QEventLoop loop;
+    QObject::connect(&pos, &POSCommunication::stateChanged, &loop, [&loop](POSCommunication::State state) {
+        if (state == POSCommunication::Connected || state == POSCommunication::Failed) {
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+    pos.connect();
+    if (!pos.isConnected()) {
+        loop.exec();
+    }
+    return pos.isConnected();
+}
+
+} // namespace
+
+#if defined(POS_BENCHMARK_MALLOC_HOOK)
+// operator new of libstdc++ allocates through malloc(), so it is counted here too
+extern "C" void* malloc(std::size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, std::size_t size) noexcept
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+#elif !defined(POS_BENCHMARK_CRT_HOOK)
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+/**
+ * @brief Benchmark entry point
+ *
+ * @param argc Command line argument count
+ * @param argv Command line argument values
+ * @return 0 on success, 1 if the mock could not be loaded or connected
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("POSBenchmark");
+
+#ifdef POS_BENCHMARK_CRT_HOOK
+    _CrtSetAllocHook(countAllocation);
+#endif
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures POSCommunication overhead against a simulated terminal");
+    parser.addHelpOption();
+    const QCommandLineOption iterationsOption("iterations", "Calls per request type.", "n", "1000");
+    const QCommandLineOption latencyOption("latency-us", "Simulated latency of every DLL call.", "us", "500");
+    const QCommandLineOption serialRateOption("serial-rate", "Serial-in callbacks per second.", "n", "5000");
+    const QCommandLineOption stateRateOption("state-rate", "Device-state callbacks per second.", "n", "50");
+    const QCommandLineOption payloadOption("payload", "Characters per serial-in payload.", "n", "64");
+    const QCommandLineOption durationOption("duration-ms", "Length of each callback phase.", "ms", "5000");
+#ifdef Q_OS_WIN
+    const QCommandLineOption backendOption("backend", "Terminal to drive: library (mock DLL) or simulated.", "name", "library");
+#else
+    const QCommandLineOption backendOption("backend", "Terminal to drive: simulated.", "name", "simulated");
+#endif
+    parser.addOptions({backendOption, iterationsOption, latencyOption, serialRateOption, stateRateOption,
+                       payloadOption, durationOption});
+    parser.process(app);
+
+    const int iterations = parser.value(iterationsOption).toInt();
+    const int latencyUs = parser.value(latencyOption).toInt();
+    const int serialRate = parser.value(serialRateOption).toInt();
+    const int stateRate = parser.value(stateRateOption).toInt();
+    const int payload = parser.value(payloadOption).toInt();
+    const int durationMs = parser.value(durationOption).toInt();
+
+    const QString backendName = parser.value(backendOption);
+
+    QTextStream out(stdout);
+
+    // Sets the simulated latency and callback rates of whichever terminal is used
+    std::function<void(int, int)> configure;
+    std::unique_ptr<POSBackend> backend;
+
+    if (backendName == "simulated") {
+        SimulatedBackend* simulated = new SimulatedBackend();
+        backend.reset(simulated);
+        configure = [simulated, latencyUs, payload](int serialPerSecond, int statePerSecond) {
+            SimulatedBackend::Options options;
+            options.callLatencyUs = latencyUs;
+            options.serialInPerSecond = serialPerSecond;
+            options.deviceStatePerSecond = statePerSecond;
+            options.payloadLength = payload;
+            simulated->setOptions(options);
+        };
+    } else {
+#ifdef Q_OS_WIN
+        // The mock sits next to the executable under the real DLL's name
+        QLibrary mock(QCoreApplication::applicationDirPath() + "/IntegrationHubCpp.dll");
+        const MockConfigure mockConfigure = reinterpret_cast<MockConfigure>(mock.resolve("mockConfigure"));
+        if (!mockConfigure) {
+            out << "IntegrationHubCpp.dll next to the benchmark is not the mock: " << mock.errorString() << Qt::endl;
+            return 1;
+        }
+        backend.reset(new LibraryBackend());
+        configure = [mockConfigure, latencyUs, payload](int serialPerSecond, int statePerSecond) {
+            mockConfigure(latencyUs, serialPerSecond, statePerSecond, payload);
+        };
+#else
+        out << "The library backend is only available on Windows; use --backend simulated" << Qt::endl;
+        return 1;
+#endif
+    }
+    configure(0, 0);
+
+    POSCommunication pos("Benchmark", std::move(backend));
+    if (!waitForConnected(pos, 5000)) {
+        out << "Failed to connect to the " << backendName << " terminal" << Qt::endl;
+        return 1;
+    }
+
+    // Request latency
+    const QString basket = "{\"documentType\":1,\"taxFreeAmount\":0,\"paymentItems\":[]}";
+    const QString payment = "{\"amount\":100,\"type\":1}";
+
+    out << QString("Request latency (%1 calls each, %2 us simulated)").arg(iterations).arg(latencyUs) << Qt::endl;
+    const auto report = [&out](const char* name, const LatencyResult& result) {
+        out << QString("  %1  p50 %2 us  p99 %3 us  failures %4")
+               .arg(name, -22).arg(result.p50Us, 10, 'f', 1).arg(result.p99Us, 10, 'f', 1)
+               .arg(result.failures) << Qt::endl;
+    };
+    report("sendBasket", measure(iterations, [&]() { pos.sendBasket(basket); }));
+    report("sendPayment", measure(iterations, [&]() { pos.sendPayment(payment); }));
+
+    // Measure the terminal round trip first, then the cache that normally hides it
+    const int fiscalInfoTtl = pos.fiscalInfoTtl();
+    pos.setFiscalInfoTtl(0);
+    report("getFiscalInfo", measure(iterations, [&]() { pos.getFiscalInfo(); }));
+    pos.setFiscalInfoTtl(fiscalInfoTtl);
+    report("getFiscalInfo (cached)", measure(iterations, [&]() { pos.getFiscalInfo(); }));
+
+    // Callback throughput and allocations, once through the Qt signal and
+    // once through a direct subscriber
+    std::atomic<quint64> serialIn(0);
+    const auto measureCallbacks = [&](const char* delivery) {
+        serialIn.store(0);
+        const quint64 allocationsBefore = g_allocations.load();
+        QElapsedTimer elapsed;
+        elapsed.start();
+        configure(serialRate, stateRate);
+
+        QEventLoop loop;
+        QTimer::singleShot(durationMs, &loop, &QEventLoop::quit);
+        loop.exec();
+
+        configure(0, 0);
+        const double seconds = elapsed.nsecsElapsed() / 1e9;
+        const quint64 callbacks = serialIn.load();
+        const quint64 allocations = g_allocations.load() - allocationsBefore;
+
+        out << QString("Callbacks via %1 (%2 serial-in/s, %3 device-state/s requested)")
+               .arg(delivery).arg(serialRate).arg(stateRate) << Qt::endl;
+        out << QString("  delivered      %1 callbacks/s").arg(callbacks / seconds, 0, 'f', 0) << Qt::endl;
+        out << QString("  allocations    %1 per callback (%2)")
+               .arg(callbacks ? double(allocations) / callbacks : 0.0, 0, 'f', 2).arg(AllocationScope) << Qt::endl;
+    };
+
+    const QMetaObject::Connection signalConnection =
+        QObject::connect(&pos, &POSCommunication::serialInReceived, &pos, [&serialIn](int, const QString&) {
+            serialIn.fetch_add(1, std::memory_order_relaxed);
+        }, Qt::DirectConnection);
+    measureCallbacks("signal");
+    QObject::disconnect(signalConnection);
+
+    const int subscription = pos.subscribeSerialIn([&serialIn](int, QStringView) {
+        serialIn.fetch_add(1, std::memory_order_relaxed);
+    });
+    measureCallbacks("subscriber");
+    pos.unsubscribeSerialIn(subscription);
+
+    pos.disconnect();
+    return 0;
+}
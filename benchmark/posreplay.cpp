@@ -0,0 +1,312 @@
+/**
+ * @file posreplay.cpp
+ * @brief Replays captured terminal traffic against the simulated terminal
+ *
+ * This file contains a console application that reads a TrafficCapture file
+ * (recorded with POS_CAPTURE in the demo or --capture in POSService) and
+ * reproduces it through POSCommunication:
+ * - baskets, payments and fiscal info queries are issued at their recorded
+ *   times through the asynchronous API, as the application issued them
+ * - serial-in and device state callbacks are injected into the simulated
+ *   terminal from a separate thread, as the DLL delivers them
+ *
+ * --speed compresses the timeline, so a capture of a store's peak hour can
+ * be replayed at N times its real load. The report shows how far the replay
+ * fell behind schedule, requests that failed or were rejected by the full
+ * command queue, and the per-call latency recorded by the wrapper.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "poscommunication.h"
+#include "simulatedbackend.h"
+#include "trafficcapture.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Outcome of one replay run
+ */
+struct ReplayResult
+{
+    std::vector<qint64> lagNs;                    ///< Lateness of every event against its schedule
+    quint64 issued[TrafficCapture::KindCount] = {};  ///< Events replayed per kind
+    quint64 failed[TrafficCapture::KindCount] = {};  ///< Requests that failed per kind
+    quint64 rejected = 0;                         ///< Requests refused because the command queue was full
+    qint64 elapsedNs = 0;                         ///< Wall time of the replay
+};
+
+/**
+ * @brief Returns the name of an event kind for the report
+ * @param kind The kind
+ * @return Short name
+ */
+const char* kindName(TrafficCapture::Kind kind)
+{
+    switch (kind) {
+    case TrafficCapture::SendBasket:    return "sendBasket";
+    case TrafficCapture::SendPayment:   return "sendPayment";
+    case TrafficCapture::GetFiscalInfo: return "getFiscalInfo";
+    case TrafficCapture::SerialIn:      return "serialIn";
+    case TrafficCapture::DeviceState:   return "deviceState";
+    default:                            return "unknown";
+    }
+}
+
+/**
+ * @brief Returns the given percentile of sorted samples
+ * @param sortedNs Samples in nanoseconds, sorted ascending
+ * @param percentile Percentile in [0, 100]
+ * @return The percentile in microseconds
+ */
+double percentileUs(const std::vector<qint64>& sortedNs, double percentile)
+{
+    if (sortedNs.empty()) {
+        return 0.0;
+    }
+    const size_t index = static_cast<size_t>(percentile / 100.0 * (sortedNs.size() - 1) + 0.5);
+    return sortedNs[index] / 1000.0;
+}
+
+/**
+ * @brief Blocks until a point in time
+ *
+ * Sleeps for the bulk of the wait and spins for the last millisecond, since
+ * captured events are often closer together than the system timer resolution.
+ *
+ * @param due The point in time
+ */
+void waitUntil(Clock::time_point due)
+{
+    const Clock::time_point wake = due - std::chrono::milliseconds(1);
+    if (Clock::now() < wake) {
+        std::this_thread::sleep_until(wake);
+    }
+    while (Clock::now() < due) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Waits for a request and counts its failure
+ * @param future The request
+ * @param kind Kind of the request
+ * @param result Receives the failure counts
+ */
+template <typename T>
+void collect(const QFuture<T>& future, TrafficCapture::Kind kind, ReplayResult& result)
+{
+    try {
+        future.waitForFinished();
+    } catch (const DeviceException& e) {
+        ++result.failed[kind];
+        if (e.error() == DeviceException::QueueFull) {
+            ++result.rejected;
+        }
+    } catch (const std::exception&) {
+        ++result.failed[kind];
+    }
+}
+
+/**
+ * @brief Replays the events on the calling thread
+ * @param events Captured events in recorded order
+ * @param speed Timeline compression factor
+ * @param loops Number of passes over the capture
+ * @param pos The instance to drive
+ * @param terminal The simulated terminal behind pos
+ * @return Schedule lag and failure counts
+ */
+ReplayResult replay(const QVector<TrafficCapture::Event>& events, double speed, int loops,
+                    POSCommunication& pos, SimulatedBackend& terminal)
+{
+    ReplayResult result;
+    result.lagNs.reserve(size_t(events.size()) * size_t(loops));
+
+    std::vector<QFuture<int>> codes;
+    std::vector<QFuture<QString>> infos;
+    std::vector<TrafficCapture::Kind> codeKinds;
+
+    const qint64 spanNs = events.isEmpty() ? 0 : events.last().timeNs - events.first().timeNs;
+    const Clock::time_point start = Clock::now();
+    for (int loop = 0; loop < loops; ++loop) {
+        for (const TrafficCapture::Event& event : events) {
+            const qint64 offsetNs = qint64(double(loop * spanNs + event.timeNs - events.first().timeNs) / speed);
+            const Clock::time_point due = start + std::chrono::nanoseconds(offsetNs);
+            waitUntil(due);
+            result.lagNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count());
+
+            switch (event.kind) {
+            case TrafficCapture::SendBasket:
+                codes.push_back(pos.sendBasketAsync(event.text));
+                codeKinds.push_back(event.kind);
+                break;
+            case TrafficCapture::SendPayment:
+                codes.push_back(pos.sendPaymentAsync(event.text));
+                codeKinds.push_back(event.kind);
+                break;
+            case TrafficCapture::GetFiscalInfo:
+                infos.push_back(pos.getFiscalInfoAsync());
+                break;
+            case TrafficCapture::SerialIn:
+                terminal.injectSerialIn(event.value, event.text);
+                break;
+            case TrafficCapture::DeviceState:
+                terminal.injectDeviceState(event.value != 0, event.text);
+                break;
+            default:
+                break;
+            }
+            ++result.issued[event.kind];
+        }
+    }
+
+    for (size_t i = 0; i < codes.size(); ++i) {
+        collect(codes[i], codeKinds[i], result);
+    }
+    for (const QFuture<QString>& info : infos) {
+        collect(info, TrafficCapture::GetFiscalInfo, result);
+    }
+    result.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    return result;
+}
+
+/**
+ * @brief Runs the event loop until the instance is connected or the timeout expires
+ * @param pos The instance to wait for
+ * @param timeoutMs Maximum time to wait
+ * @return true if connected, false on timeout or failure
+ */
+bool waitForConnected(POSCommunication& pos, int timeoutMs)
+{
+    QEventLoop loop;
+    QObject::connect(&pos, &POSCommunication::stateChanged, &loop, [&loop](POSCommunication::State state) {
+        if (state == POSCommunication::Connected || state == POSCommunication::Failed) {
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+
+    pos.connect();
+    if (!pos.isConnected()) {
+        loop.exec();
+    }
+    return pos.isConnected();
+}
+
+} // namespace
+
+/**
+ * @brief Replay entry point
+ *
+ * @param argc Command line argument count
+ * @param argv Command line argument values
+ * @return 0 on success, 1 if the capture cannot be read or the terminal not connected
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("POSReplay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays captured terminal traffic against the simulated terminal");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Traffic capture file.");
+    const QCommandLineOption speedOption("speed", "Replay speed; 2 replays twice the recorded load.", "factor", "1");
+    const QCommandLineOption loopsOption("loops", "Passes over the capture.", "n", "1");
+    const QCommandLineOption latencyOption("latency-us", "Simulated latency of every terminal call.", "us", "2000");
+    const QCommandLineOption queueOption("queue-depth", "Device command queue depth limit.", "n",
+                                         QString::number(DeviceWorker::DefaultQueueDepth));
+    parser.addOptions({speedOption, loopsOption, latencyOption, queueOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    if (parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    const QString path = parser.positionalArguments().at(0);
+    QVector<TrafficCapture::Event> events;
+    QString error;
+    if (!TrafficCapture::load(path, events, &error)) {
+        out << "Cannot read " << path << ": " << error << Qt::endl;
+        return 1;
+    }
+    if (events.isEmpty()) {
+        out << path << " contains no events" << Qt::endl;
+        return 0;
+    }
+
+    const double speed = std::max(0.001, parser.value(speedOption).toDouble());
+    const int loops = std::max(1, parser.value(loopsOption).toInt());
+
+    SimulatedBackend::Options options;
+    options.callLatencyUs = parser.value(latencyOption).toInt();
+    auto backend = std::make_unique<SimulatedBackend>(options);
+    SimulatedBackend* terminal = backend.get();
+
+    POSCommunication pos("Replay", std::move(backend));
+    pos.setMaxQueueDepth(parser.value(queueOption).toInt());
+    // Every captured query reached the terminal, so the replay must not answer from the cache
+    pos.setFiscalInfoTtl(0);
+    if (!waitForConnected(pos, 5000)) {
+        out << "Failed to connect to the simulated terminal" << Qt::endl;
+        return 1;
+    }
+
+    // Requests go out from a producer thread while signals are delivered here
+    ReplayResult result;
+    std::thread producer([&]() {
+        result = replay(events, speed, loops, pos, *terminal);
+        QMetaObject::invokeMethod(&app, &QCoreApplication::quit, Qt::QueuedConnection);
+    });
+    app.exec();
+    producer.join();
+
+    const double recordedSeconds = (events.last().timeNs - events.first().timeNs) / 1e9;
+    const double seconds = result.elapsedNs / 1e9;
+    const quint64 total = quint64(result.lagNs.size());
+    std::sort(result.lagNs.begin(), result.lagNs.end());
+
+    out << QString("Replayed %1 events (%2 s recorded) %3 times at %4x in %5 s, %6 events/s")
+           .arg(events.size()).arg(recordedSeconds, 0, 'f', 3).arg(loops).arg(speed)
+           .arg(seconds, 0, 'f', 3).arg(seconds > 0 ? total / seconds : 0.0, 0, 'f', 0) << Qt::endl;
+    out << QString("  schedule lag   p50 %1 us  p99 %2 us  max %3 us")
+           .arg(percentileUs(result.lagNs, 50.0), 0, 'f', 1).arg(percentileUs(result.lagNs, 99.0), 0, 'f', 1)
+           .arg(result.lagNs.empty() ? 0.0 : result.lagNs.back() / 1000.0, 0, 'f', 1) << Qt::endl;
+    for (int kind = 0; kind < TrafficCapture::KindCount; ++kind) {
+        if (result.issued[kind] == 0) {
+            continue;
+        }
+        out << QString("  %1  %2 issued  %3 failed")
+               .arg(kindName(TrafficCapture::Kind(kind)), -14).arg(result.issued[kind], 8).arg(result.failed[kind], 6)
+            << Qt::endl;
+    }
+    out << QString("  queue          peak depth %1  rejected %2")
+           .arg(pos.queueStats().peakDepth).arg(result.rejected) << Qt::endl;
+
+    const POSMetrics::Snapshot metrics = pos.metricsSnapshot();
+    for (POSMetrics::Operation operation : {POSMetrics::SendBasket, POSMetrics::SendPayment, POSMetrics::FiscalInfo}) {
+        const LatencyHistogram::Summary& latency = metrics.operations[operation].latency;
+        if (latency.count == 0) {
+            continue;
+        }
+        out << QString("  %1  p50 %2 us  p99 %3 us  max %4 us")
+               .arg(POSMetrics::operationName(operation), -14).arg(latency.p50Us, 10, 'f', 1)
+               .arg(latency.p99Us, 10, 'f', 1).arg(latency.maxUs, 10, 'f', 1) << Qt::endl;
+    }
+
+    pos.disconnect();
+    return 0;
+}
@@ -0,0 +1,150 @@
+#ifndef BOUNDEDMPSCQUEUE_H
+#define BOUNDEDMPSCQUEUE_H
+
+/**
+ * @file boundedmpscqueue.h
+ * @brief Fixed-capacity lock-free multi-producer/single-consumer queue
+ *
+ * This header provides the BoundedMpscQueue template used to hand device
+ * commands from any number of submitting threads to the device worker. The
+ * implementation is a ring of cells with per-cell sequence numbers, so
+ * producers only contend on a single atomic position counter and never block.
+ *
+ * Platform: Standard C++17, no Qt dependency
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * @class BoundedMpscQueue
+ * @brief Lock-free bounded FIFO with many producers and one consumer
+ *
+ * tryPush() may be called concurrently from any thread and fails instead of
+ * blocking when the queue is full. tryPop() must only be called from a single
+ * consumer thread. Items are popped in the order their push completed its
+ * position claim, which gives FIFO ordering per producer and overall.
+ *
+ * @tparam T Movable element type
+ */
+template <typename T>
+class BoundedMpscQueue
+{
+public:
+    /**
+     * @brief Constructor for BoundedMpscQueue
+     * @param capacity Maximum number of elements held at once
+     *
+     * The sequence scheme needs at least two cells, so smaller values are
+     * rounded up to two.
+     */
+    explicit BoundedMpscQueue(std::size_t capacity)
+        : m_capacity(capacity > 1 ? capacity : 2)
+        , m_cells(new Cell[m_capacity])
+        , m_enqueuePos(0)
+        , m_dequeuePos(0)
+    {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpscQueue(const BoundedMpscQueue&) = delete;
+    BoundedMpscQueue& operator=(const BoundedMpscQueue&) = delete;
+
+    /**
+     * @brief Appends an element if there is room
+     * @param value Element to move into the queue
+     * @return true if the element was queued, false if the queue is full
+     *
+     * Safe to call from any number of threads at the same time. On failure
+     * the value is left untouched.
+     */
+    bool tryPush(T&& value)
+    {
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos % m_capacity];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Removes the oldest element
+     * @param value Receives the removed element
+     * @return true if an element was removed, false if the queue is empty
+     *
+     * Must only be called from the single consumer thread.
+     */
+    bool tryPop(T& value)
+    {
+        const std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[pos % m_capacity];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (sequence != pos + 1) {
+            return false;
+        }
+
+        value = std::move(cell.value);
+        cell.value = T();
+        m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        cell.sequence.store(pos + m_capacity, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the maximum number of elements
+     * @return The capacity given at construction
+     */
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * @brief Returns the approximate number of queued elements
+     * @return Element count; may be momentarily stale while producers are active
+     */
+    std::size_t size() const
+    {
+        const std::size_t dequeued = m_dequeuePos.load(std::memory_order_relaxed);
+        const std::size_t enqueued = m_enqueuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+private:
+    /**
+     * @brief Queue slot with its sequence number
+     *
+     * A cell is free for position p when its sequence equals p, and holds the
+     * element for position p when its sequence equals p + 1.
+     */
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    const std::size_t m_capacity;                      ///< Number of cells
+    std::unique_ptr<Cell[]> m_cells;                   ///< Ring storage
+    alignas(64) std::atomic<std::size_t> m_enqueuePos; ///< Next position claimed by producers
+    alignas(64) std::atomic<std::size_t> m_dequeuePos; ///< Next position read by the consumer
+};
+
+#endif // BOUNDEDMPSCQUEUE_H
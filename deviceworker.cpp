@@ -0,0 +1,457 @@
+/**
+ * @file deviceworker.cpp
+ * @brief Implementation of the DeviceWorker class.
+ *
+ * The worker owns one QThread for the whole lifetime of a POSCommunication
+ * instance. A plain QObject is moved onto that thread and drains the bounded
+ * command queue, which gives FIFO execution of device tasks without creating
+ * a thread per request. Producers only post a wake-up event when the worker
+ * is not already scheduled to drain, so bursts cost a single event.
+ *
+ * Commands with a deadline are announced to a watchdog thread while they
+ * run. A thread stuck in the DLL cannot be interrupted, so after a timeout
+ * the thread is replaced rather than reused: each thread drains through its
+ * own Runner and stops popping as soon as a newer runner has taken over.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "deviceworker.h"
+#include "threadpolicy.h"
+#include <QDebug>
+#include <algorithm>
+
+/**
+ * @brief Constructor for the DeviceWorker class.
+ *
+ * Creates the first runner. Its context is deleted by the worker thread
+ * itself once the event loop has finished.
+ *
+ * @param name Thread name shown in debuggers and profilers
+ * @param maxQueueDepth Maximum number of commands waiting to run
+ */
+DeviceWorker::DeviceWorker(const QString& name, int maxQueueDepth)
+    : m_name(name)
+    , m_priority(QThread::NormalPriority)
+    , m_runner(nullptr)
+    , m_queue(MaxQueueCapacity)
+    , m_maxDepth(std::clamp(maxQueueDepth, 1, MaxQueueCapacity))
+    , m_depth(0)
+    , m_peakDepth(0)
+    , m_submitted(0)
+    , m_rejected(0)
+    , m_drainScheduled(false)
+    , m_started(false)
+    , m_watching(false)
+    , m_watchdogStopping(false)
+    , m_stalled(false)
+    , m_stranded(0)
+{
+    m_runners.push_back(createRunner());
+    m_runner.store(m_runners.back().get());
+}
+
+/**
+ * @brief Destructor for the DeviceWorker class.
+ *
+ * Stops the worker and watchdog threads. Contexts of threads that were
+ * never started are deleted here instead.
+ */
+DeviceWorker::~DeviceWorker()
+{
+    stop();
+    {
+        QMutexLocker locker(&m_watchMutex);
+        m_watchdogStopping = true;
+        m_watchWake.wakeAll();
+    }
+    if (m_watchdog.joinable()) {
+        m_watchdog.join();
+    }
+    failPending(DeviceException("Device worker stopped", DeviceException::Stopped));
+    for (const std::unique_ptr<Runner>& runner : m_runners) {
+        delete runner->context.data();
+    }
+}
+
+/**
+ * @brief Creates a runner whose thread has not been started.
+ *
+ * @return The new runner
+ */
+std::unique_ptr<DeviceWorker::Runner> DeviceWorker::createRunner()
+{
+    auto runner = std::make_unique<Runner>();
+    runner->context = new QObject;
+    runner->thread.setObjectName(m_runners.empty() ? m_name : m_name + QString(" #%1").arg(m_runners.size() + 1));
+    runner->context->moveToThread(&runner->thread);
+    QObject::connect(&runner->thread, &QThread::finished, runner->context.data(), &QObject::deleteLater);
+    return runner;
+}
+
+/**
+ * @brief Starts the worker thread, its event loop and the watchdog.
+ *
+ * @param priority Scheduling priority of the worker thread
+ */
+void DeviceWorker::start(QThread::Priority priority)
+{
+    QMutexLocker locker(&m_watchMutex);
+    m_priority = priority;
+    m_started = true;
+    Runner* runner = m_runner.load();
+    if (!runner->thread.isRunning()) {
+        runner->thread.start(priority);
+    }
+    if (!m_watchdog.joinable()) {
+        m_watchdog = std::thread([this]() { runWatchdog(); });
+    }
+}
+
+/**
+ * @brief Stops the worker thread and waits for it to exit.
+ *
+ * The currently running task is allowed to complete; queued commands fail
+ * with DeviceException::Stopped. Threads stuck in a timed-out command are
+ * given StrandedWaitMs and then left running.
+ */
+void DeviceWorker::stop()
+{
+    QMutexLocker locker(&m_watchMutex);
+    m_started = false;
+
+    // Only stop() erases runners, so indices stay valid while the lock is released
+    for (std::size_t i = 0; i < m_runners.size();) {
+        QThread& thread = m_runners[i]->thread;
+        const bool current = m_runners[i].get() == m_runner.load();
+        if (!thread.isRunning()) {
+            ++i;
+            continue;
+        }
+
+        thread.quit();
+        locker.unlock();
+        bool finished = false;
+        if (current) {
+            // A normal command is waited for; one that times out meanwhile is not
+            while (!(finished = thread.wait(StopPollMs)) && !m_stalled.load()) {
+            }
+        }
+        if (!finished) {
+            finished = thread.wait(StrandedWaitMs);
+        }
+        locker.relock();
+
+        if (!finished) {
+            // Destroying a running QThread aborts the process; leave it to finish on its own
+            qWarning() << "Device worker thread" << thread.objectName() << "is still blocked in a hung call";
+            m_stranded.fetch_add(1);
+            if (current) {
+                m_runners.push_back(createRunner());
+                QMutexLocker popLocker(&m_popMutex);
+                m_runner.store(m_runners.back().get());
+            }
+            m_strandedRunners.push_back(m_runners[i].release());
+            m_runners.erase(m_runners.begin() + i);
+            continue;
+        }
+        ++i;
+    }
+    m_stalled.store(false);
+    locker.unlock();
+
+    failPending(DeviceException("Device worker stopped", DeviceException::Stopped));
+}
+
+/**
+ * @brief Replaces a stalled worker thread with a new one.
+ *
+ * The switch happens under the pop lock, so the old thread cannot take
+ * another command even if its hung call returns at the same moment. The
+ * first task and a drain are queued on the new thread before it becomes
+ * current: post() and submit() only reach it after the switch, and its
+ * event queue is FIFO, so nothing can overtake the first task.
+ *
+ * @param first Control task run on the new thread before any command, may be empty
+ * @return true if a new thread was started, false if the worker is not running
+ */
+bool DeviceWorker::restart(std::function<void()> first)
+{
+    QMutexLocker locker(&m_watchMutex);
+    Runner* previous = m_runner.load();
+    if (!m_started || !previous->thread.isRunning()) {
+        return false;
+    }
+
+    m_runners.push_back(createRunner());
+    Runner* runner = m_runners.back().get();
+    runner->thread.start(m_priority);
+    if (first) {
+        QMetaObject::invokeMethod(runner->context.data(), std::move(first), Qt::QueuedConnection);
+    }
+    m_drainScheduled.store(true);
+    QMetaObject::invokeMethod(runner->context.data(), [this, runner]() { drain(runner); }, Qt::QueuedConnection);
+    {
+        QMutexLocker popLocker(&m_popMutex);
+        m_runner.store(runner);
+    }
+
+    // The old thread exits once its current command returns
+    previous->thread.quit();
+    m_watching = false;
+    m_watchedPromise = QFutureInterfaceBase();
+    m_stalled.store(false);
+    locker.unlock();
+    return true;
+}
+
+/**
+ * @brief Checks if a command has exceeded its deadline and not returned yet.
+ *
+ * @return true while the worker is stalled
+ */
+bool DeviceWorker::isStalled() const
+{
+    return m_stalled.load();
+}
+
+/**
+ * @brief Returns the number of threads still stuck in a command after stop().
+ *
+ * @return Threads that did not return within StrandedWaitMs
+ */
+int DeviceWorker::strandedThreads() const
+{
+    return m_stranded.load();
+}
+
+/**
+ * @brief Returns the number of stranded threads that have not exited yet.
+ *
+ * @return Stranded threads still running
+ */
+int DeviceWorker::runningStrandedThreads() const
+{
+    QMutexLocker locker(&m_watchMutex);
+    return int(std::count_if(m_strandedRunners.begin(), m_strandedRunners.end(),
+                             [](const Runner* runner) { return runner->thread.isRunning(); }));
+}
+
+/**
+ * @brief Sets the function called when a command exceeds its deadline.
+ *
+ * @param handler Called on the watchdog thread once per hung command
+ */
+void DeviceWorker::setStallHandler(std::function<void()> handler)
+{
+    QMutexLocker locker(&m_watchMutex);
+    m_stallHandler = std::move(handler);
+}
+
+/**
+ * @brief Checks if the caller is running on the worker thread.
+ *
+ * @return true if called from the current worker thread, false otherwise
+ */
+bool DeviceWorker::isCurrentThread() const
+{
+    return QThread::currentThread() == &m_runner.load()->thread;
+}
+
+/**
+ * @brief Returns the context object living on the worker thread.
+ *
+ * @return Pointer to the context object, or nullptr once the worker has stopped
+ */
+QObject* DeviceWorker::context() const
+{
+    return m_runner.load()->context.data();
+}
+
+/**
+ * @brief Sets the maximum number of commands waiting to run.
+ *
+ * @param depth New limit, clamped to [1, MaxQueueCapacity]
+ */
+void DeviceWorker::setMaxQueueDepth(int depth)
+{
+    m_maxDepth.store(std::clamp(depth, 1, MaxQueueCapacity));
+}
+
+/**
+ * @brief Returns the maximum number of commands waiting to run.
+ *
+ * @return The configured depth limit
+ */
+int DeviceWorker::maxQueueDepth() const
+{
+    return m_maxDepth.load();
+}
+
+/**
+ * @brief Returns current command queue metrics.
+ *
+ * All counters are read without locking, so the snapshot is only
+ * approximately consistent while commands are being submitted.
+ *
+ * @return Snapshot of depth, peak depth and accepted/rejected counters
+ */
+DeviceWorker::QueueStats DeviceWorker::queueStats() const
+{
+    QueueStats stats;
+    stats.depth = m_depth.load(std::memory_order_relaxed);
+    stats.peakDepth = m_peakDepth.load(std::memory_order_relaxed);
+    stats.maxDepth = m_maxDepth.load(std::memory_order_relaxed);
+    stats.submitted = m_submitted.load(std::memory_order_relaxed);
+    stats.rejected = m_rejected.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Pushes a command into the bounded queue and wakes the worker.
+ *
+ * A slot is reserved against the depth limit before the push, so the limit
+ * holds exactly even with many concurrent producers. The wake-up event is
+ * only posted when no drain is already pending.
+ *
+ * @param command Command to queue
+ * @return true if the command was accepted, false if the queue is full
+ */
+bool DeviceWorker::enqueue(Command&& command)
+{
+    const int depth = m_depth.fetch_add(1) + 1;
+    if (depth > m_maxDepth.load() || !m_queue.tryPush(std::move(command))) {
+        m_depth.fetch_sub(1);
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    int peak = m_peakDepth.load(std::memory_order_relaxed);
+    while (depth > peak && !m_peakDepth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
+    m_submitted.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_drainScheduled.exchange(true)) {
+        Runner* runner = m_runner.load();
+        QMetaObject::invokeMethod(runner->context.data(), [this, runner]() { drain(runner); }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+/**
+ * @brief Runs all queued commands in FIFO order.
+ *
+ * The scheduled flag is cleared before popping, so a command pushed while
+ * the last pop is in progress always results in another drain. Commands
+ * with a deadline are handed to the watchdog for as long as they run.
+ *
+ * @param runner The runner doing the work; stops once it has been replaced
+ */
+void DeviceWorker::drain(Runner* runner)
+{
+    if (m_runner.load() != runner) {
+        return;
+    }
+    m_drainScheduled.store(false);
+    ThreadPolicy::adopt(ThreadPolicy::DeviceLane);
+
+    Command command;
+    while (pop(runner, command)) {
+        m_depth.fetch_sub(1);
+
+        const bool watched = command.deadlineMs != NoDeadline;
+        if (watched) {
+            QMutexLocker locker(&m_watchMutex);
+            m_watchedPromise = command.promise;
+            m_watchedDeadline = QDeadlineTimer(command.deadlineMs);
+            m_watching = true;
+            m_watchWake.wakeOne();
+        }
+
+        command.run();
+
+        if (watched) {
+            QMutexLocker locker(&m_watchMutex);
+            if (m_runner.load() == runner) {
+                m_watching = false;
+                m_watchedPromise = QFutureInterfaceBase();
+                m_stalled.store(false);
+            }
+        }
+        command = Command();
+    }
+}
+
+/**
+ * @brief Takes the next command if the runner is still current.
+ *
+ * @param runner The runner asking
+ * @param command Receives the command
+ * @return true if a command was taken
+ */
+bool DeviceWorker::pop(Runner* runner, Command& command)
+{
+    QMutexLocker locker(&m_popMutex);
+    return m_runner.load() == runner && m_queue.tryPop(command);
+}
+
+/**
+ * @brief Fails all commands that are still queued.
+ *
+ * Used when the worker stops and by the watchdog, so no caller waits for
+ * commands stuck behind a hung one.
+ *
+ * @param error Exception reported to each waiting future
+ */
+void DeviceWorker::failPending(const DeviceException& error)
+{
+    QMutexLocker locker(&m_popMutex);
+    Command command;
+    while (m_queue.tryPop(command)) {
+        m_depth.fetch_sub(1);
+        command.promise.reportException(error);
+        command.promise.reportFinished();
+        command = Command();
+    }
+    m_drainScheduled.store(false);
+}
+
+/**
+ * @brief Watchdog thread; fails commands that exceed their deadline.
+ *
+ * Sleeps until the watched command's deadline, or indefinitely while no
+ * command with a deadline is running. The hung call itself keeps running;
+ * only its caller and the commands queued behind it are released.
+ */
+void DeviceWorker::runWatchdog()
+{
+    const QString name = m_name + QStringLiteral(" watchdog");
+    QMutexLocker locker(&m_watchMutex);
+    while (!m_watchdogStopping) {
+        ThreadPolicy::adopt(ThreadPolicy::DeviceLane, name);
+        if (!m_watching) {
+            m_watchWake.wait(&m_watchMutex);
+            continue;
+        }
+        if (!m_watchedDeadline.hasExpired()) {
+            m_watchWake.wait(&m_watchMutex, m_watchedDeadline);
+            continue;
+        }
+
+        QFutureInterfaceBase promise = m_watchedPromise;
+        const std::function<void()> handler = m_stallHandler;
+        m_watching = false;
+        m_watchedPromise = QFutureInterfaceBase();
+        m_stalled.store(true);
+        locker.unlock();
+
+        promise.reportException(DeviceException("Device call exceeded its deadline", DeviceException::Timeout));
+        promise.reportFinished();
+        failPending(DeviceException("Device worker is stalled by a hung call", DeviceException::Timeout));
+        if (handler) {
+            handler();
+        }
+
+        locker.relock();
+    }
+}
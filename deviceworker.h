@@ -0,0 +1,431 @@
+#ifndef DEVICEWORKER_H
+#define DEVICEWORKER_H
+
+/**
+ * @file deviceworker.h
+ * @brief Long-lived worker thread that serializes all IntegrationHub calls
+ *
+ * This header declares the DeviceWorker class which owns a single persistent
+ * QThread with its own event loop. Every call into the IntegrationHub DLL is
+ * executed on this thread, so the native connection handle is only ever touched
+ * from one place and no thread has to be created per connection attempt.
+ *
+ * Device commands reach the worker through a bounded lock-free queue. When the
+ * queue is full, submissions fail immediately instead of blocking the caller.
+ * A watchdog fails commands that run past their deadline, so a call hanging
+ * inside the DLL cannot block its caller forever.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QObject>
+#include <QPointer>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QException>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "boundedmpscqueue.h"
+
+/**
+ * @class DeviceException
+ * @brief Exception carried by futures returned from DeviceWorker::submit()
+ *
+ * QFuture can only transport exceptions derived from QException, so errors
+ * thrown by device tasks are wrapped in this type. Calling QFuture::result()
+ * on a failed future rethrows it in the waiting thread.
+ */
+class DeviceException : public QException
+{
+public:
+    /**
+     * @brief Reason a device request did not produce a result
+     */
+    enum Error {
+        Failed,        ///< The request ran and threw an error
+        QueueFull,     ///< The request was rejected because the command queue is full
+        Stopped,       ///< The worker was stopped before the request could run
+        Timeout,       ///< The request, or one running before it, exceeded its deadline
+        NotConnected   ///< The request ran while no connection to the terminal was open
+    };
+
+    /**
+     * @brief Constructor for DeviceException
+     * @param message Human-readable error description
+     * @param error Reason for the failure
+     */
+    explicit DeviceException(const QString& message, Error error = Failed)
+        : m_message(message.toUtf8())
+        , m_error(error)
+    {
+    }
+
+    /**
+     * @brief Returns the reason for the failure
+     * @return The error category
+     */
+    Error error() const { return m_error; }
+
+    const char* what() const noexcept override { return m_message.constData(); }
+    void raise() const override { throw *this; }
+    DeviceException* clone() const override { return new DeviceException(*this); }
+
+private:
+    QByteArray m_message;  ///< UTF-8 encoded error description
+    Error m_error;         ///< Reason for the failure
+};
+
+/**
+ * @class DeviceWorker
+ * @brief Executes device tasks in order on a dedicated thread
+ *
+ * Commands are pushed into a bounded multi-producer/single-consumer queue and
+ * drained by a context QObject that has been moved to the worker thread.
+ * Commands submitted from any thread run one after another in FIFO order.
+ * submit() queues a task without waiting and returns a QFuture for its result;
+ * invoke() queues a task and waits for its result, rethrowing any exception
+ * thrown by the task in the calling thread.
+ *
+ * Either can be given a deadline. A watchdog thread fails a command that is
+ * still running when its deadline passes with DeviceException::Timeout, fails
+ * the commands queued behind it the same way and calls the stall handler.
+ * Until the hung command returns, new commands fail immediately. restart()
+ * leaves the hung thread behind and continues on a fresh one.
+ */
+class DeviceWorker
+{
+public:
+    static constexpr int MaxQueueCapacity = 1024;  ///< Upper bound for the queue depth limit
+    static constexpr int DefaultQueueDepth = 64;   ///< Queue depth limit used unless configured
+    static constexpr int NoDeadline = 0;           ///< Deadline value for commands that may run indefinitely
+    static constexpr int StrandedWaitMs = 2000;    ///< How long stop() waits for a hung thread to return
+    static constexpr int StopPollMs = 100;         ///< Interval at which stop() checks for a stall while waiting
+
+    /**
+     * @brief Snapshot of command queue metrics
+     */
+    struct QueueStats
+    {
+        int depth = 0;          ///< Commands currently waiting to run
+        int peakDepth = 0;      ///< Highest depth observed since construction
+        int maxDepth = 0;       ///< Configured depth limit
+        quint64 submitted = 0;  ///< Commands accepted into the queue
+        quint64 rejected = 0;   ///< Commands refused because the queue was full
+    };
+
+    /**
+     * @brief Constructor for DeviceWorker
+     * @param name Thread name shown in debuggers and profilers
+     * @param maxQueueDepth Maximum number of commands waiting to run
+     *
+     * Creates the worker thread and its context object. The thread is not
+     * started until start() is called.
+     */
+    explicit DeviceWorker(const QString& name, int maxQueueDepth = DefaultQueueDepth);
+
+    /**
+     * @brief Destructor
+     *
+     * Stops the event loop and waits for the currently running task to finish.
+     * Threads left behind by restart() are only waited for StrandedWaitMs.
+     */
+    ~DeviceWorker();
+
+    /**
+     * @brief Starts the worker thread
+     * @param priority Scheduling priority of the worker thread
+     */
+    void start(QThread::Priority priority = QThread::NormalPriority);
+
+    /**
+     * @brief Stops the worker thread and waits for it to exit
+     *
+     * Queued commands that have not started yet fail with DeviceException::Stopped.
+     * A thread stuck in a command that exceeded its deadline is only waited
+     * for StrandedWaitMs and then counted by strandedThreads().
+     */
+    void stop();
+
+    /**
+     * @brief Replaces a stalled worker thread with a new one
+     * @param first Control task run on the new thread before any command, may be empty
+     * @return true if a new thread was started, false if the worker is not running
+     *
+     * The old thread finishes its current command but runs nothing after it;
+     * queued and future commands run on the new thread. Safe to call from any
+     * thread, including the stall handler.
+     */
+    bool restart(std::function<void()> first = nullptr);
+
+    /**
+     * @brief Checks if a command has exceeded its deadline and not returned yet
+     * @return true while the worker is stalled
+     */
+    bool isStalled() const;
+
+    /**
+     * @brief Returns the number of threads still stuck in a command after stop()
+     * @return Threads that did not return within StrandedWaitMs
+     *
+     * Code that a stranded thread may still execute, such as the DLL it is
+     * blocked in, must not be unloaded while this is non-zero.
+     */
+    int strandedThreads() const;
+
+    /**
+     * @brief Returns the number of stranded threads that have not exited yet
+     * @return Threads counted by strandedThreads() that are still running
+     *
+     * A stranded thread whose command returns finishes that command and
+     * exits; until then it may still use the worker and the command's owner.
+     */
+    int runningStrandedThreads() const;
+
+    /**
+     * @brief Sets the function called when a command exceeds its deadline
+     * @param handler Called on the watchdog thread once per hung command
+     *
+     * The hung command and the commands queued behind it have already failed
+     * with DeviceException::Timeout when the handler runs.
+     */
+    void setStallHandler(std::function<void()> handler);
+
+    /**
+     * @brief Checks if the caller is running on the worker thread
+     * @return true if called from the worker thread, false otherwise
+     */
+    bool isCurrentThread() const;
+
+    /**
+     * @brief Returns the context object living on the worker thread
+     * @return Pointer to the context object
+     *
+     * Objects that need the worker's event loop (e.g. timers) can use this as
+     * their parent or as the context of queued invocations.
+     */
+    QObject* context() const;
+
+    /**
+     * @brief Sets the maximum number of commands waiting to run
+     * @param depth New limit, clamped to [1, MaxQueueCapacity]
+     *
+     * Lowering the limit does not drop commands that are already queued.
+     */
+    void setMaxQueueDepth(int depth);
+
+    /**
+     * @brief Returns the maximum number of commands waiting to run
+     * @return The configured depth limit
+     */
+    int maxQueueDepth() const;
+
+    /**
+     * @brief Returns current command queue metrics
+     * @return Snapshot of depth, peak depth and accepted/rejected counters
+     */
+    QueueStats queueStats() const;
+
+    /**
+     * @brief Queues a control task for execution on the worker thread
+     * @param task Callable without arguments
+     *
+     * Control tasks (connection management, timers) bypass the bounded command
+     * queue and are never rejected. Returns immediately. The task must not throw.
+     */
+    template <typename Task>
+    void post(Task&& task)
+    {
+        QMetaObject::invokeMethod(m_runner.load()->context.data(), std::forward<Task>(task), Qt::QueuedConnection);
+    }
+
+    /**
+     * @brief Queues a command on the worker thread and returns a future for its result
+     * @param task Callable without arguments
+     * @param deadlineMs Longest time the task may run, or NoDeadline
+     * @return Future that finishes when the task has run
+     *
+     * Exceptions thrown by the task are reported through the future as a
+     * DeviceException. If the queue is full the returned future has already
+     * failed with DeviceException::QueueFull, and while the worker is stalled
+     * with DeviceException::Timeout. Never blocks the calling thread.
+     */
+    template <typename Task>
+    auto submit(Task task, int deadlineMs = NoDeadline) -> QFuture<decltype(task())>
+    {
+        using Result = decltype(task());
+
+        QFutureInterface<Result> promise;
+        promise.reportStarted();
+        QFuture<Result> future = promise.future();
+
+        if (!m_runner.load()->thread.isRunning()) {
+            promise.reportException(DeviceException("Device worker is not running", DeviceException::Stopped));
+            promise.reportFinished();
+            return future;
+        }
+        if (m_stalled.load()) {
+            promise.reportException(DeviceException("Device worker is stalled by a hung call", DeviceException::Timeout));
+            promise.reportFinished();
+            return future;
+        }
+
+        // Results reported after the watchdog failed the promise are ignored
+        Command command;
+        command.promise = promise;
+        command.deadlineMs = deadlineMs > 0 ? deadlineMs : NoDeadline;
+        command.run = [promise, task = std::move(task)]() mutable {
+            try {
+                if constexpr (std::is_void<Result>::value) {
+                    task();
+                } else {
+                    promise.reportResult(task());
+                }
+            } catch (const QException& e) {
+                promise.reportException(e);
+            } catch (const std::exception& e) {
+                promise.reportException(DeviceException(QString::fromUtf8(e.what())));
+            } catch (...) {
+                promise.reportException(DeviceException("Unknown device error"));
+            }
+            promise.reportFinished();
+        };
+
+        if (!enqueue(std::move(command))) {
+            promise.reportException(DeviceException("Device command queue is full", DeviceException::QueueFull));
+            promise.reportFinished();
+        }
+        return future;
+    }
+
+    /**
+     * @brief Queues a command on the worker thread and waits for its result
+     * @param task Callable without arguments
+     * @param deadlineMs Longest time the task may run, or NoDeadline
+     * @return The value returned by the task
+     * @throws DeviceException if the task failed or timed out, the queue is full or the worker stopped
+     *
+     * When called from the worker thread itself the task runs inline and the
+     * deadline is not enforced.
+     */
+    template <typename Task>
+    auto invoke(Task&& task, int deadlineMs = NoDeadline) -> decltype(task())
+    {
+        using Result = decltype(task());
+
+        if (isCurrentThread()) {
+            return task();
+        }
+
+        QFuture<Result> future = submit([&task]() { return task(); }, deadlineMs);
+        if constexpr (std::is_void<Result>::value) {
+            future.waitForFinished();
+        } else {
+            return future.result();
+        }
+    }
+
+private:
+    /**
+     * @brief Type-erased queued command
+     *
+     * run() executes the task on the worker thread and finishes the promise.
+     * The promise is kept separately so the watchdog, or a stopping worker,
+     * can fail the command without running it.
+     */
+    struct Command
+    {
+        std::function<void()> run;      ///< Runs the task and reports its outcome
+        QFutureInterfaceBase promise;   ///< Shared state of the caller's future
+        int deadlineMs = NoDeadline;    ///< Longest time run() may take
+    };
+
+    /**
+     * @brief One worker thread and the context object living on it
+     *
+     * Runners are only destroyed with the worker, so a pointer loaded from
+     * m_runner stays valid even if restart() replaces it meanwhile.
+     */
+    struct Runner
+    {
+        QThread thread;               ///< Thread running an event loop
+        QPointer<QObject> context;    ///< Object living on the thread that receives tasks
+    };
+
+    /**
+     * @brief Creates a runner whose thread has not been started
+     * @return The new runner
+     */
+    std::unique_ptr<Runner> createRunner();
+
+    /**
+     * @brief Pushes a command into the bounded queue and wakes the worker
+     * @param command Command to queue
+     * @return true if the command was accepted, false if the queue is full
+     */
+    bool enqueue(Command&& command);
+
+    /**
+     * @brief Runs all queued commands (on the given runner's thread)
+     * @param runner The runner doing the work; stops once it has been replaced
+     */
+    void drain(Runner* runner);
+
+    /**
+     * @brief Takes the next command if the runner is still current
+     * @param runner The runner asking
+     * @param command Receives the command
+     * @return true if a command was taken
+     */
+    bool pop(Runner* runner, Command& command);
+
+    /**
+     * @brief Fails all commands that are still queued
+     * @param error Exception reported to each waiting future
+     */
+    void failPending(const DeviceException& error);
+
+    /**
+     * @brief Watchdog thread; fails commands that exceed their deadline
+     */
+    void runWatchdog();
+
+    QString m_name;                          ///< Base thread name
+    QThread::Priority m_priority;            ///< Priority passed to start(), reused by restart()
+    std::vector<std::unique_ptr<Runner>> m_runners;  ///< All runners, the current one last; guarded by m_watchMutex
+    std::atomic<Runner*> m_runner;           ///< Runner that executes commands
+    BoundedMpscQueue<Command> m_queue;       ///< Commands waiting for the worker
+    QMutex m_popMutex;                       ///< Serializes consumers, so a replaced runner never pops
+    std::atomic<int> m_maxDepth;             ///< Configured queue depth limit
+    std::atomic<int> m_depth;                ///< Commands accepted but not yet started
+    std::atomic<int> m_peakDepth;            ///< Highest depth observed
+    std::atomic<quint64> m_submitted;        ///< Commands accepted into the queue
+    std::atomic<quint64> m_rejected;         ///< Commands refused because the queue was full
+    std::atomic<bool> m_drainScheduled;      ///< Whether a drain is already pending on the event loop
+
+    mutable QMutex m_watchMutex;             ///< Guards the watched command, m_runners and the stall handler
+    QWaitCondition m_watchWake;              ///< Wakes the watchdog when a watched command starts
+    QFutureInterfaceBase m_watchedPromise;   ///< Promise of the command being watched
+    QDeadlineTimer m_watchedDeadline;        ///< When the watched command times out
+    bool m_started;                          ///< Between start() and stop(); restart() is refused otherwise
+    bool m_watching;                         ///< Whether a watched command is running
+    bool m_watchdogStopping;                 ///< Tells the watchdog to exit
+    std::function<void()> m_stallHandler;    ///< Called when a command times out
+    std::atomic<bool> m_stalled;             ///< Whether a timed-out command is still running
+    std::atomic<int> m_stranded;             ///< Threads left running by stop()
+    std::vector<Runner*> m_strandedRunners;  ///< Runners of those threads, leaked; guarded by m_watchMutex
+    std::thread m_watchdog;                  ///< Watchdog thread, started with the worker
+};
+
+#endif // DEVICEWORKER_H
@@ -0,0 +1,673 @@
+/**
+ * @file librarybackend.cpp
+ * @brief Implementation of the LibraryBackend class
+ *
+ * This file contains the DLL-based transport: dynamic loading of the
+ * IntegrationHub library and its dependencies, resolution of the exported
+ * functions, and the per-slot callback trampolines that route DLL callbacks
+ * to the right backend.
+ *
+ * Platform: Windows; other platforms only get stubs that report the backend unavailable
+ */
+
+#include "librarybackend.h"
+#include "poslogging.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Callback routing table, one entry per callback slot
+std::atomic<LibraryBackend*> LibraryBackend::s_backends[LibraryBackend::MaxConnections];
+
+#ifdef Q_OS_WIN
+namespace {
+
+const char* const MainDll = "IntegrationHubCpp.dll";              ///< The IntegrationHub library itself
+const char* const LibraryDirSetting = "IntegrationHub/libraryDir"; ///< QSettings key of the resolved directory
+
+/**
+ * @brief Views a BSTR as a string without copying it.
+ *
+ * BSTRs are length-prefixed UTF-16, the same encoding QString uses, so the
+ * listener can copy the payload once without scanning for the terminator or
+ * transcoding. A null BSTR yields an empty view.
+ *
+ * @param value The BSTR to view
+ * @return View of the string contents, valid as long as the BSTR
+ */
+QStringView bstrView(BSTR value)
+{
+    return QStringView(reinterpret_cast<const QChar*>(value), static_cast<qsizetype>(SysStringLen(value)));
+}
+
+} // namespace
+#endif
+
+/**
+ * @brief Constructor for the LibraryBackend class.
+ *
+ * Nothing is loaded until initialize() is called.
+ */
+LibraryBackend::LibraryBackend()
+    : m_listener(nullptr)
+    , m_connection(nullptr)
+    , m_busyConnection(nullptr)
+    , m_orphaned(false)
+    , m_parked(0)
+    , m_callbackSlot(-1)
+{
+}
+
+/**
+ * @brief Destructor for the LibraryBackend class.
+ *
+ * Deletes the native connection, which releases its callback slot, and
+ * unloads the libraries. The owner has already stopped the device worker, so no other
+ * call into the DLL can be running.
+ */
+LibraryBackend::~LibraryBackend()
+{
+    close();
+
+    // Free libraries
+    for (QLibrary* lib : m_libraries) {
+        lib->unload();
+        delete lib;
+    }
+    m_libraries.clear();
+}
+
+/**
+ * @brief Returns the backend name.
+ *
+ * @return "library"
+ */
+QString LibraryBackend::name() const
+{
+    return QStringLiteral("library");
+}
+
+/**
+ * @brief Attaches the listener.
+ *
+ * The callback slot is claimed by open(), so only connected backends count
+ * against MaxConnections.
+ *
+ * @param listener Receiver of events and log messages
+ */
+void LibraryBackend::initialize(Listener* listener)
+{
+    m_listener = listener;
+}
+
+/**
+ * @brief Loads the IntegrationHub DLL and resolves its functions.
+ *
+ * Runs on the device worker thread, so the user interface is not blocked
+ * while the libraries are read from disk.
+ *
+ * @return true if the libraries were loaded and all functions resolved, false otherwise
+ */
+bool LibraryBackend::load()
+{
+    // Load required libraries
+    if (!loadLibraries()) {
+        POS_LOG(lcPosLibrary, QtWarningMsg, "Failed to load required libraries");
+        return false;
+    }
+
+    // Initialize function pointers
+    return initializeFunctions();
+}
+
+/**
+ * @brief Forwards an enabled log message to the listener.
+ *
+ * @param category The logging category of the message
+ * @param level The severity of the message
+ * @param message The formatted message text
+ */
+void LibraryBackend::log(const QLoggingCategory& category, QtMsgType level, const QString& message)
+{
+    if (m_listener) {
+        m_listener->onLog(category, level, message);
+    }
+}
+
+/**
+ * @brief Claims a free callback slot for this backend.
+ *
+ * Slots are claimed with a compare-and-swap, since backends connect on
+ * their own device worker threads.
+ *
+ * @return The slot index, or -1 if all slots are in use
+ */
+int LibraryBackend::claimCallbackSlot()
+{
+    for (int slot = 0; slot < MaxConnections; ++slot) {
+        LibraryBackend* expected = nullptr;
+        if (s_backends[slot].compare_exchange_strong(expected, this)) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Releases a callback slot.
+ *
+ * Called after the slot's connection has been deleted, so no further
+ * callbacks can arrive for it.
+ *
+ * @param slot The slot index, or -1 for none
+ */
+void LibraryBackend::releaseCallbackSlot(int slot)
+{
+    if (slot >= 0) {
+        s_backends[slot].store(nullptr);
+    }
+}
+
+/**
+ * @brief Creates the native connection and registers the callbacks.
+ *
+ * @param companyName The merchant/company identifier
+ * @throws std::runtime_error if the connection fails or the platform is unsupported
+ */
+void LibraryBackend::open(const QString& companyName)
+{
+#ifdef Q_OS_WIN
+    if (!m_createCommunication) {
+        throw std::runtime_error("IntegrationHub library not loaded");
+    }
+
+    // Route DLL callbacks of the new connection to this backend
+    m_callbackSlot = claimCallbackSlot();
+    if (m_callbackSlot < 0) {
+        throw std::runtime_error(QString("No free callback slot, at most %1 terminals can be connected at once")
+                                     .arg(MaxConnections).toStdString());
+    }
+
+    POS_LOG(lcPosConnection, QtDebugMsg, "Creating communication instance...");
+
+    // Create communication instance
+    m_connection = m_createCommunication(reinterpret_cast<const wchar_t*>(companyName.utf16()));
+    if (m_connection == nullptr) {
+        releaseCallbackSlot(m_callbackSlot);
+        m_callbackSlot = -1;
+        throw std::runtime_error("Failed to create communication instance");
+    }
+
+    POS_LOG(lcPosConnection, QtDebugMsg, "Setting up callbacks...");
+
+    // Set callbacks
+    m_setSerialInCallback(m_connection, s_serialInThunks[m_callbackSlot]);
+    m_setDeviceStateCallback(m_connection, s_deviceStateThunks[m_callbackSlot]);
+
+    POS_LOG(lcPosConnection, QtDebugMsg, "Connection setup complete");
+#else
+    Q_UNUSED(companyName);
+    POS_LOG(lcPosConnection, QtWarningMsg, "Windows-specific functionality not available on this platform");
+    throw std::runtime_error("Windows-specific functionality not available");
+#endif
+}
+
+/**
+ * @brief Deletes the native connection and releases its callback slot.
+ */
+void LibraryBackend::close()
+{
+#ifdef Q_OS_WIN
+    if (m_connection != nullptr) {
+        m_deleteCommunication(m_connection);
+    }
+#endif
+    m_connection = nullptr;
+    releaseCallbackSlot(m_callbackSlot);
+    m_callbackSlot = -1;
+}
+
+/**
+ * @brief Gives up a connection whose DLL call has hung.
+ *
+ * Deleting the handle while the DLL is still using it would crash the
+ * process, so a busy handle is only forgotten here and deleted by endCall()
+ * once the hung call returns, which also releases its callback slot. If it
+ * never returns the handle and its slot are leaked.
+ */
+void LibraryBackend::abandon()
+{
+    QMutexLocker locker(&m_callMutex);
+    if (m_connection == nullptr) {
+        return;
+    }
+    if (m_busyConnection != m_connection) {
+        locker.unlock();
+        close();
+        return;
+    }
+
+    POS_LOG(lcPosConnection, QtWarningMsg, "Abandoning connection with a hung call");
+    m_abandoned.append(AbandonedConnection{m_connection, m_callbackSlot});
+    m_busyConnection = nullptr;
+    m_connection = nullptr;
+    m_callbackSlot = -1;
+}
+
+/**
+ * @brief Stops calls from returning to the destroyed owner.
+ *
+ * Counted under the call lock, so every call either is included in the
+ * result and parks when it returns, or had already returned before.
+ *
+ * @return Threads inside a DLL call or parked
+ */
+int LibraryBackend::orphan()
+{
+    QMutexLocker locker(&m_callMutex);
+    m_orphaned = true;
+    return m_parked + m_abandoned.size() + (m_busyConnection ? 1 : 0);
+}
+
+/**
+ * @brief Blocks the calling thread for good.
+ *
+ * The owning POSCommunication and its device worker are destroyed, so the
+ * thread has nothing left to return to.
+ *
+ * @param locker Holds m_callMutex
+ */
+void LibraryBackend::park(QMutexLocker& locker)
+{
+    ++m_parked;
+    locker.unlock();
+    qCWarning(lcPosConnection) << "Parking a device thread whose owner was destroyed during a hung call";
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+}
+
+/**
+ * @brief Marks the connection as in use by a DLL call.
+ *
+ * @return The connection to pass to the DLL
+ */
+void* LibraryBackend::beginCall()
+{
+    QMutexLocker locker(&m_callMutex);
+    if (m_orphaned) {
+        park(locker);
+    }
+    m_busyConnection = m_connection;
+    return m_connection;
+}
+
+/**
+ * @brief Ends a DLL call.
+ *
+ * Runs on the thread that made the call, which may by now be an abandoned
+ * worker thread; in that case the connection is deleted here. After
+ * orphan() the thread parks instead of returning to the destroyed owner.
+ *
+ * @param connection Value returned by beginCall()
+ */
+void LibraryBackend::endCall(void* connection)
+{
+    QMutexLocker locker(&m_callMutex);
+    const auto it = std::find_if(m_abandoned.begin(), m_abandoned.end(),
+                                 [connection](const AbandonedConnection& entry) { return entry.connection == connection; });
+    const bool abandoned = it != m_abandoned.end();
+    int callbackSlot = -1;
+    if (abandoned) {
+        callbackSlot = it->callbackSlot;
+        m_abandoned.erase(it);
+    } else if (m_busyConnection == connection) {
+        m_busyConnection = nullptr;
+    }
+    if (m_orphaned) {
+        park(locker);
+    }
+    if (!abandoned) {
+        return;
+    }
+    locker.unlock();
+
+#ifdef Q_OS_WIN
+    POS_LOG(lcPosConnection, QtInfoMsg, "Hung call returned; deleting its abandoned connection");
+    m_deleteCommunication(connection);
+#endif
+    releaseCallbackSlot(callbackSlot);
+}
+
+/**
+ * @brief Checks if a native connection exists.
+ *
+ * @return true if connected, false otherwise
+ */
+bool LibraryBackend::isOpen() const
+{
+    return m_connection != nullptr;
+}
+
+/**
+ * @brief Asks the DLL to re-establish the existing connection.
+ */
+void LibraryBackend::reconnect()
+{
+#ifdef Q_OS_WIN
+    void* const connection = beginCall();
+    m_reconnect(connection);
+    endCall(connection);
+#endif
+}
+
+/**
+ * @brief Gets the index of the currently active device.
+ *
+ * @return The index of the active device
+ * @throws std::runtime_error if the platform is unsupported
+ */
+int LibraryBackend::activeDeviceIndex()
+{
+#ifdef Q_OS_WIN
+    void* const connection = beginCall();
+    const int index = m_getActiveDeviceIndex(connection);
+    endCall(connection);
+    return index;
+#else
+    throw std::runtime_error("Function not available on this platform");
+#endif
+}
+
+/**
+ * @brief Sends the basket data in JSON format to the communication instance.
+ *
+ * @param jsonData The basket data in JSON format
+ * @return The result code from the send operation
+ * @throws std::runtime_error if the platform is unsupported
+ */
+int LibraryBackend::sendBasket(const QString& jsonData)
+{
+#ifdef Q_OS_WIN
+    void* const connection = beginCall();
+    const int result = m_sendBasket(connection, reinterpret_cast<const wchar_t*>(jsonData.utf16()));
+    endCall(connection);
+    return result;
+#else
+    Q_UNUSED(jsonData);
+    throw std::runtime_error("Function not available on this platform");
+#endif
+}
+
+/**
+ * @brief Sends the payment data in JSON format to the communication instance.
+ *
+ * @param jsonData The payment data in JSON format
+ * @return The result code from the send operation
+ * @throws std::runtime_error if the platform is unsupported
+ */
+int LibraryBackend::sendPayment(const QString& jsonData)
+{
+#ifdef Q_OS_WIN
+    void* const connection = beginCall();
+    const int result = m_sendPayment(connection, reinterpret_cast<const wchar_t*>(jsonData.utf16()));
+    endCall(connection);
+    return result;
+#else
+    Q_UNUSED(jsonData);
+    throw std::runtime_error("Function not available on this platform");
+#endif
+}
+
+/**
+ * @brief Gets the fiscal information as a string from the communication instance.
+ *
+ * @return The fiscal information as a QString
+ * @throws std::runtime_error if the platform is unsupported
+ */
+QString LibraryBackend::fiscalInfo()
+{
+#ifdef Q_OS_WIN
+    void* const connection = beginCall();
+    BSTR result = m_getFiscalInfo(connection);
+    endCall(connection);
+    QString info = bstrView(result).toString();
+    SysFreeString(result);
+    return info;
+#else
+    throw std::runtime_error("Function not available on this platform");
+#endif
+}
+
+#ifdef Q_OS_WIN
+/**
+ * @brief Finds the directory that holds the IntegrationHub DLL.
+ *
+ * The directory found on the previous run is tried first, so a normal start
+ * costs a single file probe. Otherwise the application and working
+ * directories are searched and the result is remembered in QSettings.
+ *
+ * @return The directory, or an empty string if the DLL was not found
+ */
+QString LibraryBackend::resolveLibraryDir()
+{
+    QSettings settings;
+    const QString cachedDir = settings.value(LibraryDirSetting).toString();
+
+    QStringList searchPaths;
+    if (!cachedDir.isEmpty()) {
+        searchPaths << cachedDir;
+    }
+    for (const QString& path : {QCoreApplication::applicationDirPath(), QDir::currentPath()}) {
+        if (!searchPaths.contains(path)) {
+            searchPaths << path;
+        }
+    }
+
+    for (const QString& path : searchPaths) {
+        if (QFile::exists(path + "/" + MainDll)) {
+            if (path != cachedDir) {
+                settings.setValue(LibraryDirSetting, path);
+            }
+            return path;
+        }
+    }
+
+    if (!cachedDir.isEmpty()) {
+        settings.remove(LibraryDirSetting);
+    }
+    return QString();
+}
+
+/**
+ * @brief Loads one library from the given directory.
+ *
+ * Safe to call from several threads at once; the loader serializes the
+ * parts that must not overlap.
+ *
+ * @param path Full path of the library
+ * @return The loaded library, or nullptr on failure
+ */
+QLibrary* LibraryBackend::loadLibrary(const QString& path)
+{
+    QLibrary* lib = new QLibrary(path);
+    if (!lib->load()) {
+        POS_LOG(lcPosLibrary, QtWarningMsg, "Failed to load " + path + ": " + lib->errorString());
+        delete lib;
+        return nullptr;
+    }
+    POS_LOG(lcPosLibrary, QtDebugMsg, "Successfully loaded " + path);
+    return lib;
+}
+#endif
+
+/**
+ * @brief Loads the required libraries for communication.
+ *
+ * This method is platform-specific and only implemented for Windows. The
+ * dependency DLLs are loaded concurrently, since on slow disks reading them
+ * dominates startup; the IntegrationHub DLL, which imports them, is loaded
+ * once they are all in memory.
+ *
+ * @return true if all required libraries are loaded successfully, false otherwise
+ */
+bool LibraryBackend::loadLibraries()
+{
+#ifdef Q_OS_WIN
+    const QStringList dependencyDlls = {
+        "libcrypto-3.dll",
+        "libusb-1.0.dll",
+        "zlib1.dll"
+    };
+
+    const QString dir = resolveLibraryDir();
+    if (dir.isEmpty()) {
+        POS_LOG(lcPosLibrary, QtWarningMsg, "Failed to load required DLL: " + QString(MainDll));
+        return false;
+    }
+    POS_LOG(lcPosLibrary, QtDebugMsg, "Loading DLLs from " + dir + "...");
+
+    // Dependencies are independent of each other, so read them in parallel
+    std::vector<std::future<QLibrary*>> pending;
+    for (const QString& dllName : dependencyDlls) {
+        pending.push_back(std::async(std::launch::async, &LibraryBackend::loadLibrary, this, dir + "/" + dllName));
+    }
+
+    bool loaded = true;
+    for (std::future<QLibrary*>& future : pending) {
+        if (QLibrary* lib = future.get()) {
+            m_libraries.append(lib);
+        } else {
+            loaded = false;
+        }
+    }
+
+    if (loaded) {
+        if (QLibrary* lib = loadLibrary(dir + "/" + MainDll)) {
+            m_libraries.append(lib);
+        } else {
+            loaded = false;
+        }
+    }
+
+    if (!loaded) {
+        return false;
+    }
+
+    POS_LOG(lcPosLibrary, QtInfoMsg, QString("Successfully loaded %1 DLLs").arg(m_libraries.size()));
+    return true;
+#else
+    POS_LOG(lcPosLibrary, QtInfoMsg, "IntegrationHub library is only supported on Windows. Functionality will be limited.");
+    return false;
+#endif
+}
+
+/**
+ * @brief Initializes function pointers to the IntegrationHub DLL functions.
+ *
+ * This method is platform-specific and only implemented for Windows. It resolves
+ * the function pointers from the loaded IntegrationHub DLL and logs the results.
+ *
+ * @return true if every function was resolved, false otherwise
+ */
+bool LibraryBackend::initializeFunctions()
+{
+#ifdef Q_OS_WIN
+    // Find the main DLL in our loaded libraries
+    QLibrary* mainDll = nullptr;
+    for (QLibrary* lib : m_libraries) {
+        if (lib->fileName().contains(MainDll, Qt::CaseInsensitive)) {
+            mainDll = lib;
+            break;
+        }
+    }
+
+    if (!mainDll) {
+        POS_LOG(lcPosLibrary, QtWarningMsg, "Failed to find main DLL in loaded libraries");
+        return false;
+    }
+
+    // Get function pointers
+    m_createCommunication = reinterpret_cast<CreateCommunication>(mainDll->resolve("createCommunication"));
+    m_deleteCommunication = reinterpret_cast<DeleteCommunication>(mainDll->resolve("deleteCommunication"));
+    m_reconnect = reinterpret_cast<Reconnect>(mainDll->resolve("reconnect"));
+    m_getActiveDeviceIndex = reinterpret_cast<GetActiveDeviceIndex>(mainDll->resolve("getActiveDeviceIndex"));
+    m_sendBasket = reinterpret_cast<SendBasket>(mainDll->resolve("sendBasket"));
+    m_sendPayment = reinterpret_cast<SendPayment>(mainDll->resolve("sendPayment"));
+    m_getFiscalInfo = reinterpret_cast<GetFiscalInfo>(mainDll->resolve("getFiscalInfo"));
+    m_setSerialInCallback = reinterpret_cast<SetSerialInCallback>(mainDll->resolve("setSerialInCallback"));
+    m_setDeviceStateCallback = reinterpret_cast<SetDeviceStateCallback>(mainDll->resolve("setDeviceStateCallback"));
+
+    // Check that all functions were resolved
+    if (!m_createCommunication || !m_deleteCommunication || !m_reconnect ||
+        !m_getActiveDeviceIndex || !m_sendBasket || !m_sendPayment ||
+        !m_getFiscalInfo || !m_setSerialInCallback || !m_setDeviceStateCallback) {
+        POS_LOG(lcPosLibrary, QtWarningMsg, "Failed to resolve one or more functions from DLL");
+        m_createCommunication = nullptr;
+        return false;
+    }
+
+    POS_LOG(lcPosLibrary, QtInfoMsg, "Successfully initialized all DLL functions");
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef Q_OS_WIN
+/**
+ * @brief Callback trampoline for serial input events.
+ *
+ * This static method is called by the IntegrationHub library when a serial input
+ * event occurs on the connection registered for callback slot Slot. It forwards
+ * the event to the listener of the backend that owns the slot without copying
+ * the payload.
+ *
+ * @param typeCode The type code of the serial input event
+ * @param value The value of the serial input event as a BSTR
+ */
+template <int Slot>
+void __stdcall LibraryBackend::serialInThunk(int typeCode, BSTR value)
+{
+    if (LibraryBackend* backend = s_backends[Slot].load(std::memory_order_acquire)) {
+        backend->m_listener->onSerialIn(typeCode, bstrView(value));
+    }
+}
+
+/**
+ * @brief Callback trampoline for device state changes.
+ *
+ * This static method is called by the IntegrationHub library when the device state
+ * of the connection registered for callback slot Slot changes. It forwards the
+ * event to the listener of the backend that owns the slot.
+ *
+ * @param isConnected true if the device is connected, false otherwise
+ * @param deviceId The ID of the device as a BSTR
+ */
+template <int Slot>
+void __stdcall LibraryBackend::deviceStateThunk(bool isConnected, BSTR deviceId)
+{
+    if (LibraryBackend* backend = s_backends[Slot].load(std::memory_order_acquire)) {
+        backend->m_listener->onDeviceState(isConnected, bstrView(deviceId));
+    }
+}
+
+static_assert(LibraryBackend::MaxConnections == 8, "Update the trampoline tables below");
+
+const LibraryBackend::SerialInCallback LibraryBackend::s_serialInThunks[MaxConnections] = {
+    &serialInThunk<0>, &serialInThunk<1>, &serialInThunk<2>, &serialInThunk<3>,
+    &serialInThunk<4>, &serialInThunk<5>, &serialInThunk<6>, &serialInThunk<7>
+};
+
+const LibraryBackend::DeviceStateCallback LibraryBackend::s_deviceStateThunks[MaxConnections] = {
+    &deviceStateThunk<0>, &deviceStateThunk<1>, &deviceStateThunk<2>, &deviceStateThunk<3>,
+    &deviceStateThunk<4>, &deviceStateThunk<5>, &deviceStateThunk<6>, &deviceStateThunk<7>
+};
+#endif
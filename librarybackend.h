@@ -0,0 +1,199 @@
+#ifndef LIBRARYBACKEND_H
+#define LIBRARYBACKEND_H
+
+/**
+ * @file librarybackend.h
+ * @brief POSBackend implementation on top of the IntegrationHub DLL
+ *
+ * This header declares the LibraryBackend class which loads IntegrationHubCpp.dll
+ * and its dependencies through QLibrary, resolves the exported functions and
+ * routes the DLL callbacks back to the owning listener.
+ *
+ * Platform: Windows; on other platforms the backend reports itself unavailable
+ */
+
+#include "posbackend.h"
+#include <QList>
+#include <QLibrary>
+#include <QMutex>
+#include <atomic>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <comdef.h>
+#include <comutil.h>
+#endif
+
+/**
+ * @class LibraryBackend
+ * @brief Connection to a terminal through the IntegrationHub DLL
+ */
+class LibraryBackend : public POSBackend
+{
+public:
+    /**
+     * @brief Maximum number of backends that can be connected at the same time
+     *
+     * Each open connection needs one of these callback slots because the DLL
+     * callbacks cannot carry a per-connection context pointer. open() claims
+     * a slot and close() releases it; a connection abandoned to a hung call
+     * keeps its slot until the call returns.
+     */
+    static constexpr int MaxConnections = 8;
+
+    LibraryBackend();
+
+    /**
+     * @brief Destructor
+     *
+     * Closes the connection, which releases its callback slot, and unloads the libraries.
+     */
+    ~LibraryBackend() override;
+
+    QString name() const override;
+    void initialize(Listener* listener) override;
+    bool load() override;
+    void open(const QString& companyName) override;
+    void close() override;
+    void abandon() override;
+    int orphan() override;
+    bool isOpen() const override;
+    void reconnect() override;
+    int activeDeviceIndex() override;
+    int sendBasket(const QString& jsonData) override;
+    int sendPayment(const QString& jsonData) override;
+    QString fiscalInfo() override;
+
+private:
+#ifdef Q_OS_WIN
+    /**
+     * @brief Windows-specific function pointer types for dynamic library loading
+     *
+     * These typedefs define the function signatures used to interface with
+     * the native Windows libraries that provide the actual device communication.
+     */
+    typedef void* (__cdecl* CreateCommunication)(const wchar_t*);
+    typedef void (__cdecl* DeleteCommunication)(void*);
+    typedef void (__cdecl* Reconnect)(void*);
+    typedef int (__cdecl* GetActiveDeviceIndex)(void*);
+    typedef int (__cdecl* SendBasket)(void*, const wchar_t*);
+    typedef int (__cdecl* SendPayment)(void*, const wchar_t*);
+    typedef BSTR (__cdecl* GetFiscalInfo)(void*);
+    typedef void (__stdcall* SerialInCallback)(int, BSTR);
+    typedef void (__stdcall* DeviceStateCallback)(bool, BSTR);
+    typedef void (__cdecl* SetSerialInCallback)(void*, SerialInCallback);
+    typedef void (__cdecl* SetDeviceStateCallback)(void*, DeviceStateCallback);
+
+    // DLL function pointers
+    CreateCommunication m_createCommunication = nullptr;
+    DeleteCommunication m_deleteCommunication = nullptr;
+    Reconnect m_reconnect = nullptr;
+    GetActiveDeviceIndex m_getActiveDeviceIndex = nullptr;
+    SendBasket m_sendBasket = nullptr;
+    SendPayment m_sendPayment = nullptr;
+    GetFiscalInfo m_getFiscalInfo = nullptr;
+    SetSerialInCallback m_setSerialInCallback = nullptr;
+    SetDeviceStateCallback m_setDeviceStateCallback = nullptr;
+
+    /**
+     * @brief Per-slot callback trampolines
+     *
+     * The DLL callbacks carry no user-data pointer, so each backend registers
+     * the trampoline of its own callback slot. The trampoline looks up the
+     * backend in s_backends and forwards the event to its listener.
+     */
+    template <int Slot>
+    static void __stdcall serialInThunk(int typeCode, BSTR value);
+    template <int Slot>
+    static void __stdcall deviceStateThunk(bool isConnected, BSTR deviceId);
+
+    static const SerialInCallback s_serialInThunks[MaxConnections];        ///< Trampoline per callback slot
+    static const DeviceStateCallback s_deviceStateThunks[MaxConnections];  ///< Trampoline per callback slot
+
+    /**
+     * @brief Finds the directory holding the IntegrationHub DLL, cached across runs
+     * @return The directory, or an empty string if the DLL was not found
+     */
+    QString resolveLibraryDir();
+
+    /**
+     * @brief Loads one library (any thread)
+     * @param path Full path of the library
+     * @return The loaded library, or nullptr on failure
+     */
+    QLibrary* loadLibrary(const QString& path);
+#endif
+
+    /**
+     * @brief Forwards an enabled log message to the listener
+     *
+     * Used through the POS_LOG macro so that disabled messages are never formatted.
+     */
+    void log(const QLoggingCategory& category, QtMsgType level, const QString& message);
+
+    /**
+     * @brief Marks the connection as in use by a DLL call
+     * @return The connection to pass to the DLL
+     */
+    void* beginCall();
+
+    /**
+     * @brief Ends a DLL call; deletes the connection if it was abandoned meanwhile
+     * @param connection Value returned by beginCall()
+     */
+    void endCall(void* connection);
+
+    /**
+     * @brief Blocks the calling thread for good after the owner is gone
+     * @param locker Holds m_callMutex; released before blocking
+     */
+    [[noreturn]] void park(QMutexLocker& locker);
+
+    /**
+     * @brief Claims a free callback slot for this backend
+     * @return The slot index, or -1 if all MaxConnections slots are in use
+     */
+    int claimCallbackSlot();
+
+    /**
+     * @brief Releases a callback slot once its connection has been deleted
+     * @param slot The slot index, or -1 for none
+     */
+    static void releaseCallbackSlot(int slot);
+
+    /**
+     * @brief Connection given up while a DLL call was still using it
+     */
+    struct AbandonedConnection
+    {
+        void* connection;  ///< The native connection
+        int callbackSlot;  ///< Slot its callbacks are routed through
+    };
+
+    /**
+     * @brief Loads required DLL libraries for device communication
+     * @return true if all libraries were loaded successfully, false otherwise
+     */
+    bool loadLibraries();
+
+    /**
+     * @brief Initializes function pointers from loaded libraries
+     * @return true if every function was resolved, false otherwise
+     */
+    bool initializeFunctions();
+
+    Listener* m_listener;            ///< Receiver of events and log messages
+    QList<QLibrary*> m_libraries;    ///< List of dynamically loaded libraries
+    void* m_connection;              ///< Pointer to the native connection object
+    QMutex m_callMutex;              ///< Guards m_busyConnection, m_abandoned, m_orphaned and m_parked
+    void* m_busyConnection;          ///< Connection a DLL call is running on, or nullptr
+    QList<AbandonedConnection> m_abandoned;  ///< Connections left to hung calls, deleted when they return
+    bool m_orphaned;                 ///< Whether orphan() was called; returning calls park
+    int m_parked;                    ///< Threads blocked by park()
+    int m_callbackSlot;              ///< Slot of m_connection in s_backends, or -1 while closed
+
+    // Backends whose connections currently own a callback slot
+    static std::atomic<LibraryBackend*> s_backends[MaxConnections];  ///< Callback routing table
+};
+
+#endif // LIBRARYBACKEND_H
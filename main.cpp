@@ -4,7 +4,8 @@
  * 
  * This file contains the main function that initializes and launches the Qt-based
  * POS Communication Demo application. It sets up the application environment,
- * creates the main window, and handles top-level exception management.
+ * starts warming up the terminal connection, creates the main window, and
+ * handles top-level exception management.
  * 
  * Platform: Qt C++ cross-platform framework
  * This application demonstrates integration between point-of-sale systems
@@ -12,7 +13,13 @@
  */
 
 #include "mainwindow.h"
+#include "metricsserver.h"
+#include "poscommunication.h"
+#include "poscommunicationpool.h"
+#include "threadpolicy.h"
+#include "trafficcapture.h"
 #include <QApplication>
+#include <QDebug>
 #include <QMessageBox>
 
 /**
@@ -35,16 +42,51 @@ int main(int argc, char *argv[])
     QApplication::setApplicationName("POS Communication Demo");
     QApplication::setOrganizationName("YourCompanyName");
     QApplication::setApplicationVersion("1.0.0");
+
+    // Optionally override thread priorities and cores, e.g. POS_THREAD_POLICY="device=highest@1;journal=low@0"
+    QString threadPolicyError;
+    if (!ThreadPolicy::configure(qEnvironmentVariable("POS_THREAD_POLICY"), &threadPolicyError)) {
+        qWarning() << "Invalid POS_THREAD_POLICY:" << threadPolicyError;
+    }
+
+    // Optionally expose terminal metrics to Prometheus, e.g. POS_METRICS_PORT=9464
+    MetricsServer metricsServer(POSCommunicationPool::instance());
+    const int metricsPort = qEnvironmentVariableIntValue("POS_METRICS_PORT");
+    if (metricsPort > 0 && !metricsServer.listen(quint16(metricsPort))) {
+        qWarning() << "Failed to start metrics endpoint:" << metricsServer.errorString();
+    }
     
+    // Optionally record terminal traffic for POSReplay, e.g. POS_CAPTURE=peak.postraf
+    TrafficCapture capture;
+    const QString capturePath = qEnvironmentVariable("POS_CAPTURE");
+    if (!capturePath.isEmpty() && !capture.open(capturePath)) {
+        qWarning() << "Failed to open traffic capture:" << capture.errorString();
+    }
+
+    POSCommunication* communication = nullptr;
     try {
+        communication = POSCommunication::getInstance("YourCompanyName");
+        if (capture.isOpen()) {
+            communication->setCapture(&capture);
+        }
+
+        // Connect and probe the terminal while the window is being built, so
+        // the first transaction finds a hot connection
+        communication->warmUp();
+
         // Create and display the main application window
         MainWindow mainWindow;
         mainWindow.show();
         
         // Start the Qt event loop
         // This will block until the application is closed
+        // The pool destroys the terminal on aboutToQuit, before the capture goes away
         return app.exec();
     } catch (const std::exception& e) {
+        if (communication) {
+            communication->setCapture(nullptr);
+        }
+
         // Global exception handler for unhandled exceptions
         // Displays a message box with the exception details
         QMessageBox::critical(nullptr, "Critical Error", 
@@ -17,6 +17,7 @@
 #include <QApplication>
 #include <QScreen>
 #include <QTimer>
+#include <QUuid>
 
 /**
  * @brief Constructor for the MainWindow class
@@ -32,6 +33,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_btnSendPayment(nullptr)
     , m_btnGetFiscalInfo(nullptr)
     , m_textLog(nullptr)
+    , m_timestampSecond(-1)
     , m_posComm(nullptr)
 {
     setupUi();
@@ -43,19 +45,23 @@ MainWindow::MainWindow(QWidget *parent)
         
         // Connect signals
         connect(m_posComm, &POSCommunication::logMessage, this, &MainWindow::onLogMessage);
-        connect(m_posComm, &POSCommunication::connectionStatusChanged, this, &MainWindow::onConnectionStatusChanged);
+        connect(m_posComm, &POSCommunication::stateChanged, this, &MainWindow::onStateChanged);
         connect(m_posComm, &POSCommunication::serialInReceived, this, &MainWindow::onSerialInReceived);
         connect(m_posComm, &POSCommunication::deviceStateChanged, this, &MainWindow::onDeviceStateChanged);
+        connect(m_posComm, &POSCommunication::basketCompleted, this, &MainWindow::onBasketCompleted);
+        connect(m_posComm, &POSCommunication::paymentCompleted, this, &MainWindow::onPaymentCompleted);
+        connect(m_posComm, &POSCommunication::fiscalInfoReady, this, &MainWindow::onFiscalInfoReady);
+        connect(m_posComm, &POSCommunication::requestFailed, this, &MainWindow::onRequestFailed);
         
-#ifdef Q_OS_WIN
-        // Attempt initial connection on Windows
-        log("Attempting initial connection...");
-        m_posComm->connect();
-#else
-        // On non-Windows platforms, just disable the buttons
-        log("IntegrationHub library is only supported on Windows. Buttons will be disabled.");
-        updateButtons();
-#endif
+        connect(m_posComm, &POSCommunication::librariesReady, this, &MainWindow::onLibrariesReady);
+
+        // The backend loads in the background; the window is usable meanwhile
+        if (m_posComm->isReady()) {
+            onLibrariesReady(m_posComm->isAvailable());
+        } else {
+            log("Loading libraries...");
+            updateButtons();
+        }
     } catch (const std::exception& e) {
         log(QString("Error initializing: %1").arg(e.what()));
         QMessageBox::critical(this, "Initialization Error", 
@@ -67,12 +73,12 @@ MainWindow::MainWindow(QWidget *parent)
 /**
  * @brief Destructor for the MainWindow class
  * 
- * Since POSCommunication is implemented as a singleton pattern,
- * no explicit deletion is required here.
+ * The default POSCommunication instance is owned by POSCommunicationPool,
+ * so no explicit deletion is required here.
  */
 MainWindow::~MainWindow()
 {
-    // POSCommunication is a singleton, no need to delete it here
+    // POSCommunication is owned by the pool, no need to delete it here
 }
 
 /**
@@ -81,7 +87,7 @@ MainWindow::~MainWindow()
  * This method creates and arranges all UI elements including:
  * - Window title and size
  * - Button controls for POS operations
- * - Text area for logging
+ * - Bounded plain-text area for logging
  * It also centers the window on the screen and connects button signals to their handlers.
  */
 void MainWindow::setupUi()
@@ -116,9 +122,16 @@ void MainWindow::setupUi()
     buttonLayout->addWidget(m_btnGetFiscalInfo);
     buttonLayout->addStretch();
     
-    // Create log text area
-    m_textLog = new QTextEdit(this);
+    // Create log text area; plain text with a block limit keeps memory bounded
+    m_textLog = new QPlainTextEdit(this);
     m_textLog->setReadOnly(true);
+    m_textLog->setMaximumBlockCount(MaxLogLines);
+    m_textLog->setUndoRedoEnabled(false);
+
+    // Coalesce log appends into one document update per interval
+    m_logFlushTimer.setSingleShot(true);
+    m_logFlushTimer.setInterval(LogFlushIntervalMs);
+    connect(&m_logFlushTimer, &QTimer::timeout, this, &MainWindow::flushLog);
     
     // Add layouts to main layout
     mainLayout->addLayout(buttonLayout);
@@ -137,12 +150,43 @@ void MainWindow::setupUi()
  * @brief Adds a timestamped message to the log display
  * @param message The message text to be logged
  * 
- * Formats the message with a timestamp and appends it to the text log area.
+ * Formats the message with a timestamp and queues it for the next flush.
+ * The timestamp string is only rebuilt when the second changes, and the
+ * pending buffer never holds more than MaxLogLines lines.
  */
 void MainWindow::log(const QString& message)
 {
-    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    m_textLog->append(QString("[%1] %2").arg(timestamp).arg(message));
+    const qint64 second = QDateTime::currentMSecsSinceEpoch() / 1000;
+    if (second != m_timestampSecond) {
+        m_timestampSecond = second;
+        m_timestamp = QDateTime::fromSecsSinceEpoch(second).toString("yyyy-MM-dd hh:mm:ss");
+    }
+
+    m_pendingLog.append(QString("[%1] %2").arg(m_timestamp, message));
+    if (m_pendingLog.size() > MaxLogLines) {
+        m_pendingLog.erase(m_pendingLog.begin(), m_pendingLog.end() - MaxLogLines);
+    }
+
+    if (!m_logFlushTimer.isActive()) {
+        m_logFlushTimer.start();
+    }
+}
+
+/**
+ * @brief Appends all queued log lines to the log view
+ * 
+ * Called by the flush timer. All lines collected since the last flush are
+ * inserted with a single append, so the document is laid out once per
+ * interval instead of once per message.
+ */
+void MainWindow::flushLog()
+{
+    if (m_pendingLog.isEmpty()) {
+        return;
+    }
+
+    m_textLog->appendPlainText(m_pendingLog.join('\n'));
+    m_pendingLog.clear();
 }
 
 /**
@@ -150,73 +194,78 @@ void MainWindow::log(const QString& message)
  * 
  * Enables or disables the action buttons depending on whether the POS device
  * is connected. Also updates the window title to reflect the current connection status.
- * On non-Windows platforms, all POS-related buttons remain disabled.
+ * While the backend is still loading, or if it is not available (e.g. the DLL
+ * on non-Windows platforms), all POS-related buttons remain disabled.
  */
 void MainWindow::updateButtons()
 {
-#ifdef Q_OS_WIN
-    bool enabled = m_posComm && m_posComm->isConnected() && !m_posComm->isConnecting();
+    if (m_posComm && !m_posComm->isAvailable()) {
+        m_btnSendBasket->setEnabled(false);
+        m_btnSendPayment->setEnabled(false);
+        m_btnGetFiscalInfo->setEnabled(false);
+        if (m_posComm->isReady()) {
+            setWindowTitle("POS Communication Demo - Not Available on this Platform");
+        } else {
+            setWindowTitle("POS Communication Demo - Loading...");
+        }
+        return;
+    }
+
+    const POSCommunication::State state = m_posComm ? m_posComm->state() : POSCommunication::Disconnected;
+    bool enabled = state == POSCommunication::Connected;
     
     m_btnSendBasket->setEnabled(enabled);
     m_btnSendPayment->setEnabled(enabled);
     m_btnGetFiscalInfo->setEnabled(enabled);
     
     if (m_posComm) {
-        if (m_posComm->isConnected()) {
+        switch (state) {
+        case POSCommunication::Connected:
             setWindowTitle("POS Communication Demo - Connected");
-        } else if (m_posComm->isConnecting()) {
+            break;
+        case POSCommunication::Connecting:
             setWindowTitle("POS Communication Demo - Connecting...");
-        } else {
+            break;
+        case POSCommunication::Reconnecting:
+            setWindowTitle("POS Communication Demo - Reconnecting...");
+            break;
+        case POSCommunication::Failed:
+            setWindowTitle("POS Communication Demo - Connection Failed");
+            break;
+        case POSCommunication::Disconnected:
             setWindowTitle("POS Communication Demo - Disconnected");
+            break;
         }
     }
-#else
-    // On non-Windows platforms, disable all buttons
-    m_btnSendBasket->setEnabled(false);
-    m_btnSendPayment->setEnabled(false);
-    m_btnGetFiscalInfo->setEnabled(false);
-    setWindowTitle("POS Communication Demo - Not Available on this Platform");
-#endif
 }
 
 /**
  * @brief Handler for the "Send Basket" button click
  * 
- * Sends a sample basket in JSON format to the POS device.
+ * Queues a sample basket for the POS device without blocking the UI.
  * The sample includes a tax-free transaction with customer information.
- * Logs the result of the operation, including any errors that occur.
+ * The result is logged when the request completes.
  */
 void MainWindow::onSendBasketClicked()
 {
-    const QString sampleBasket = R"({
-        "documentType": 9008,
-        "taxFreeAmount": 5000,
-        "customerInfo": {
-            "taxID": "11111111111"
-        },
-        "paymentItems": [
-            {
-                "amount": 5000,
-                "description": "Nakit",
-                "type": 1
-            }
-        ]
-    })";
+    Basket sampleBasket;
+    sampleBasket.setDocumentType(9008);
+    sampleBasket.setTaxFreeAmount(5000);
+    sampleBasket.setCustomerTaxId(QStringLiteral("11111111111"));
+    sampleBasket.addPaymentItem({5000, QStringLiteral("Nakit"), 1});
     
-    try {
-        int response = m_posComm->sendBasket(sampleBasket);
-        log(QString("Basket sent successfully. Response: %1").arg(response));
-    } catch (const std::exception& e) {
-        log(QString("Error sending basket: %1").arg(e.what()));
-    }
+    // The result arrives through basketCompleted or requestFailed
+    m_posComm->sendBasketAsync(sampleBasket);
+    log("Sending basket...");
 }
 
 /**
  * @brief Handler for the "Send Payment" button click
  * 
- * Sends a sample payment request in JSON format to the POS device.
+ * Queues a sample payment request in JSON format for the POS device without blocking the UI.
  * The sample includes an amount and payment type.
- * Logs the result of the operation, including any errors that occur.
+ * The result is logged when the request completes. Clicks while the payment
+ * is in flight reuse its idempotency key, so they do not charge again.
  */
 void MainWindow::onSendPaymentClicked()
 {
@@ -225,27 +274,73 @@ void MainWindow::onSendPaymentClicked()
         "type": "credit"
     })";
     
-    try {
-        int response = m_posComm->sendPayment(samplePayment);
-        log(QString("Payment sent successfully. Response: %1").arg(response));
-    } catch (const std::exception& e) {
-        log(QString("Error sending payment: %1").arg(e.what()));
+    const bool inFlight = !m_payment.isFinished();
+    if (!inFlight) {
+        m_paymentKey = QUuid::createUuid().toString(QUuid::WithoutBraces);
     }
+
+    // The result arrives through paymentCompleted or requestFailed, once per key
+    m_payment = m_posComm->sendPaymentAsync(samplePayment, m_paymentKey);
+    log(inFlight ? "Payment already in progress..." : "Sending payment...");
 }
 
 /**
  * @brief Handler for the "Get Fiscal Info" button click
  * 
- * Requests fiscal information from the connected POS device.
- * Logs the received information or any errors that occur during the request.
+ * Requests fiscal information from the connected POS device without blocking the UI.
+ * The received information or any error is logged when the request completes.
  */
 void MainWindow::onGetFiscalInfoClicked()
 {
-    try {
-        QString info = m_posComm->getFiscalInfo();
-        log("Fiscal Info: " + info);
-    } catch (const std::exception& e) {
-        log(QString("Error getting fiscal info: %1").arg(e.what()));
+    // The result arrives through fiscalInfoReady or requestFailed
+    m_posComm->getFiscalInfoAsync();
+    log("Requesting fiscal info...");
+}
+
+/**
+ * @brief Slot handler for completed basket sends
+ * @param result The result code returned by the POS device
+ */
+void MainWindow::onBasketCompleted(int result)
+{
+    log(QString("Basket sent successfully. Response: %1").arg(result));
+}
+
+/**
+ * @brief Slot handler for completed payment sends
+ * @param result The result code returned by the POS device
+ */
+void MainWindow::onPaymentCompleted(int result)
+{
+    log(QString("Payment sent successfully. Response: %1").arg(result));
+}
+
+/**
+ * @brief Slot handler for received fiscal information
+ * @param info The fiscal information returned by the POS device
+ */
+void MainWindow::onFiscalInfoReady(const QString& info)
+{
+    log("Fiscal Info: " + info);
+}
+
+/**
+ * @brief Slot handler for failed asynchronous requests
+ * @param request The name of the request that failed
+ * @param error Description of the failure
+ * 
+ * Logs the failure using the same wording as the former blocking handlers.
+ */
+void MainWindow::onRequestFailed(const QString& request, const QString& error)
+{
+    if (request == "sendBasket") {
+        log(QString("Error sending basket: %1").arg(error));
+    } else if (request == "sendPayment") {
+        log(QString("Error sending payment: %1").arg(error));
+    } else if (request == "getFiscalInfo") {
+        log(QString("Error getting fiscal info: %1").arg(error));
+    } else {
+        log(QString("Error in %1: %2").arg(request, error));
     }
 }
 
@@ -262,16 +357,40 @@ void MainWindow::onLogMessage(const QString& message)
 }
 
 /**
- * @brief Slot handler for connection status changes
- * @param isConnected Boolean indicating whether the device is now connected
+ * @brief Slot handler for connection state changes
+ * @param state The new connection state
  * 
- * Updates the UI in response to changes in the connection status of the POS device.
+ * Updates the UI in response to changes in the connection state of the POS device.
  */
-void MainWindow::onConnectionStatusChanged(bool isConnected)
+void MainWindow::onStateChanged(POSCommunication::State state)
 {
+    Q_UNUSED(state);
     updateButtons();
 }
 
+/**
+ * @brief Slot handler for the end of background library loading
+ * @param available Boolean indicating whether the backend can be used
+ * 
+ * Attempts the initial connection once the backend is loaded, unless the
+ * warm-up started by main() is already connecting. Without a usable backend,
+ * e.g. the DLL on non-Windows platforms, the buttons stay disabled.
+ */
+void MainWindow::onLibrariesReady(bool available)
+{
+    if (available) {
+        if (m_posComm->isConnected() || m_posComm->isConnecting()) {
+            updateButtons();
+            return;
+        }
+        log("Attempting initial connection...");
+        m_posComm->connect();
+    } else {
+        log(QString("The %1 backend is not available. Buttons will be disabled.").arg(m_posComm->backendName()));
+        updateButtons();
+    }
+}
+
 /**
  * @brief Slot handler for serial input received from the POS device
  * @param typeCode The type code of the received data
@@ -289,12 +408,12 @@ void MainWindow::onSerialInReceived(int typeCode, const QString& value)
  * @param isConnected Boolean indicating whether the device is now connected
  * @param deviceId The identifier of the device that changed state
  * 
- * Updates the UI in response to changes in the state of the connected POS device.
- * Also logs the device state change with its ID for diagnostic purposes.
+ * Logs the device state change with its ID for diagnostic purposes. The buttons
+ * are refreshed by onStateChanged, which POSCommunication only emits when the
+ * connection state actually changes.
  */
 void MainWindow::onDeviceStateChanged(bool isConnected, const QString& deviceId)
 {
     log(QString("Device State - Connected: %1, ID: %2")
         .arg(isConnected ? "Yes" : "No").arg(deviceId));
-    updateButtons();
 }
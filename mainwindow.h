@@ -17,10 +17,13 @@
 
 #include <QMainWindow>
 #include <QPushButton>
-#include <QTextEdit>
+#include <QPlainTextEdit>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QDateTime>
+#include <QFuture>
+#include <QStringList>
+#include <QTimer>
 #include "poscommunication.h"
 
 /**
@@ -87,12 +90,21 @@ private slots:
     void onLogMessage(const QString& message);
     
     /**
-     * @brief Handles connection status changes
-     * @param isConnected True if connected, false otherwise
+     * @brief Handles connection state changes
+     * @param state The new connection state
      * 
-     * Updates the UI based on the connection status with the POS device.
+     * Updates the UI based on the connection state of the POS device.
      */
-    void onConnectionStatusChanged(bool isConnected);
+    void onStateChanged(POSCommunication::State state);
+
+    /**
+     * @brief Handles the end of background library loading
+     * @param available True if the backend can be used, false otherwise
+     * 
+     * Starts the initial connection, or disables the buttons if the backend
+     * could not be loaded.
+     */
+    void onLibrariesReady(bool available);
     
     /**
      * @brief Handles serial data received from the POS device
@@ -108,10 +120,35 @@ private slots:
      * @param isConnected True if the device is connected, false otherwise
      * @param deviceId The identifier of the device that changed state
      * 
-     * Updates the UI and internal state based on device connection changes.
+     * Logs the device connection change.
      */
     void onDeviceStateChanged(bool isConnected, const QString& deviceId);
 
+    /**
+     * @brief Handles completion of an asynchronous basket send
+     * @param result The result code returned by the POS device
+     */
+    void onBasketCompleted(int result);
+
+    /**
+     * @brief Handles completion of an asynchronous payment send
+     * @param result The result code returned by the POS device
+     */
+    void onPaymentCompleted(int result);
+
+    /**
+     * @brief Handles fiscal information received asynchronously
+     * @param info The fiscal information returned by the POS device
+     */
+    void onFiscalInfoReady(const QString& info);
+
+    /**
+     * @brief Handles failure of an asynchronous request
+     * @param request The name of the request that failed
+     * @param error Description of the failure
+     */
+    void onRequestFailed(const QString& request, const QString& error);
+
 private:
     /**
      * @brief Sets up the user interface
@@ -124,9 +161,14 @@ private:
      * @brief Logs a message to the application's log window
      * @param message The message to be logged
      * 
-     * Formats and displays a message in the log window with a timestamp.
+     * Timestamps the message and queues it for the next log flush.
      */
     void log(const QString& message);
+
+    /**
+     * @brief Appends all queued log lines to the log view in one update
+     */
+    void flushLog();
     
     /**
      * @brief Updates the enabled/disabled state of buttons
@@ -152,9 +194,41 @@ private:
     QPushButton* m_btnGetFiscalInfo;
     
     /**
-     * @brief Text area for displaying log messages
+     * @brief Plain-text area for displaying log messages
+     * 
+     * Limited to MaxLogLines blocks; the oldest lines are discarded first.
+     */
+    QPlainTextEdit* m_textLog;
+
+    /**
+     * @brief Log lines waiting for the next flush
+     */
+    QStringList m_pendingLog;
+
+    /**
+     * @brief Timer that coalesces log appends into periodic flushes
+     */
+    QTimer m_logFlushTimer;
+
+    /**
+     * @brief Second of the cached timestamp (msecs since epoch / 1000)
+     */
+    qint64 m_timestampSecond;
+
+    /**
+     * @brief Formatted timestamp reused for all lines within the same second
+     */
+    QString m_timestamp;
+
+    /**
+     * @brief Maximum number of lines kept in the log view
+     */
+    static constexpr int MaxLogLines = 5000;
+
+    /**
+     * @brief Interval in milliseconds between log view flushes
      */
-    QTextEdit* m_textLog;
+    static constexpr int LogFlushIntervalMs = 50;
 
     // POS Communication
     /**
@@ -163,6 +237,16 @@ private:
      * Manages all communication between the application and connected POS devices.
      */
     POSCommunication* m_posComm;
+
+    /**
+     * @brief Latest payment request, finished unless one is in flight
+     */
+    QFuture<int> m_payment;
+
+    /**
+     * @brief Idempotency key of m_payment, reused by clicks while it is in flight
+     */
+    QString m_paymentKey;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,358 @@
+/**
+ * @file metricsserver.cpp
+ * @brief Implementation of the MetricsServer class
+ *
+ * Only the request line is parsed; headers are ignored and every response
+ * closes the connection, which is all a Prometheus scraper needs. Latency
+ * buckets are derived from the log-linear POSMetrics histograms: a duration
+ * is counted below a bound once its whole histogram bucket is, so cumulative
+ * counts are exact at the bucket edges and conservative in between.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "metricsserver.h"
+#include "poscommunication.h"
+#include "poscommunicationpool.h"
+#include <QMetaEnum>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+
+namespace {
+
+/**
+ * @brief Counter metric exported for one POSMetrics::Counter
+ */
+struct CounterMetric
+{
+    POSMetrics::Counter counter;  ///< Source counter
+    const char* name;             ///< Prometheus metric name
+    const char* help;             ///< HELP text
+};
+
+const CounterMetric CounterMetrics[] = {
+    {POSMetrics::SerialInEvents, "pos_serial_in_events_total", "Serial-in callbacks received from the terminal."},
+    {POSMetrics::DeviceStateEvents, "pos_device_state_events_total", "Device state callbacks received from the terminal."},
+    {POSMetrics::ReconnectAttempts, "pos_reconnect_attempts_total", "Automatic reconnection attempts."},
+    {POSMetrics::ConnectionsLost, "pos_connections_lost_total", "Times the device was reported disconnected."},
+    {POSMetrics::CallTimeouts, "pos_call_timeouts_total", "Backend calls that exceeded their deadline."},
+    {POSMetrics::WorkerRestarts, "pos_worker_restarts_total", "Device worker threads replaced after a hung call."},
+    {POSMetrics::DuplicatePayments, "pos_duplicate_payments_total", "Payments answered by an earlier request with the same idempotency key."},
+};
+
+/// Upper bounds of the exported latency buckets, in seconds
+const double LatencyBoundsSeconds[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30,
+};
+
+/**
+ * @brief Metrics of one terminal collected for a scrape
+ */
+struct TerminalMetrics
+{
+    QByteArray label;                      ///< Escaped terminal name
+    POSCommunication::State state;         ///< Connection state
+    bool available;                        ///< Whether the backend loaded
+    DeviceWorker::QueueStats queue;        ///< Command queue statistics
+    POSMetrics::Snapshot metrics;          ///< Latency histograms and counters
+};
+
+/**
+ * @brief Escapes a label value as required by the text exposition format.
+ *
+ * @param value The raw value
+ * @return UTF-8 value with backslash, double quote and newline escaped
+ */
+QByteArray escapeLabel(const QString& value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\");
+    escaped.replace('"', "\\\"");
+    escaped.replace('\n', "\\n");
+    return escaped;
+}
+
+/**
+ * @brief Appends the HELP and TYPE lines of a metric.
+ *
+ * @param out Buffer to append to
+ * @param name Metric name
+ * @param type Prometheus metric type
+ * @param help HELP text
+ */
+void appendHeader(QByteArray& out, const char* name, const char* type, const char* help)
+{
+    out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+    out.append("# TYPE ").append(name).append(' ').append(type).append('\n');
+}
+
+/**
+ * @brief Appends one sample line.
+ *
+ * @param out Buffer to append to
+ * @param name Metric name including any suffix
+ * @param labels Label list without braces
+ * @param value Sample value
+ */
+void appendSample(QByteArray& out, const QByteArray& name, const QByteArray& labels, const QByteArray& value)
+{
+    out.append(name).append('{').append(labels).append("} ").append(value).append('\n');
+}
+
+/**
+ * @brief Formats a floating-point sample value.
+ *
+ * @param value The value
+ * @return Shortest representation that round-trips typical values
+ */
+QByteArray number(double value)
+{
+    return QByteArray::number(value, 'g', 12);
+}
+
+} // namespace
+
+/**
+ * @brief Constructor for the MetricsServer class.
+ *
+ * @param pool Terminals whose metrics are served
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+MetricsServer::MetricsServer(POSCommunicationPool* pool, QObject* parent)
+    : QObject(parent)
+    , m_pool(pool)
+{
+    QObject::connect(&m_server, &QTcpServer::newConnection, this, &MetricsServer::onNewConnection);
+}
+
+/**
+ * @brief Starts accepting connections.
+ *
+ * @param port TCP port to listen on
+ * @param address Interface to bind to
+ * @return true if the server is listening, false otherwise
+ */
+bool MetricsServer::listen(quint16 port, const QHostAddress& address)
+{
+    return m_server.listen(address, port);
+}
+
+/**
+ * @brief Stops accepting connections.
+ */
+void MetricsServer::close()
+{
+    m_server.close();
+}
+
+/**
+ * @brief Checks if the server is accepting connections.
+ *
+ * @return true if listening
+ */
+bool MetricsServer::isListening() const
+{
+    return m_server.isListening();
+}
+
+/**
+ * @brief Returns the port the server listens on.
+ *
+ * @return The port, or 0 if not listening
+ */
+quint16 MetricsServer::serverPort() const
+{
+    return m_server.serverPort();
+}
+
+/**
+ * @brief Returns a description of the last listen() error.
+ *
+ * @return Human-readable error text
+ */
+QString MetricsServer::errorString() const
+{
+    return m_server.errorString();
+}
+
+/**
+ * @brief Renders the metrics of all terminals in the pool.
+ *
+ * All values of one terminal are read once up front, so the samples of a
+ * scrape are consistent with each other.
+ *
+ * @return Metrics in the Prometheus text exposition format
+ */
+QByteArray MetricsServer::render() const
+{
+    QVector<TerminalMetrics> terminals;
+    if (m_pool) {
+        const QStringList names = m_pool->terminals();
+        terminals.reserve(names.size());
+        for (const QString& name : names) {
+            POSCommunication* terminal = m_pool->find(name);
+            if (!terminal) {
+                continue;
+            }
+            terminals.append({escapeLabel(name), terminal->state(), terminal->isAvailable(),
+                              terminal->queueStats(), terminal->metricsSnapshot()});
+        }
+    }
+
+    QByteArray out;
+    out.reserve(4096 + terminals.size() * 8192);
+
+    appendHeader(out, "pos_backend_available", "gauge", "Whether the terminal's backend is loaded and usable.");
+    for (const TerminalMetrics& t : terminals) {
+        appendSample(out, "pos_backend_available", "terminal=\"" + t.label + '"', t.available ? "1" : "0");
+    }
+
+    const QMetaEnum states = QMetaEnum::fromType<POSCommunication::State>();
+    appendHeader(out, "pos_connection_state", "gauge", "Connection state of the terminal; 1 for the current state.");
+    for (const TerminalMetrics& t : terminals) {
+        for (int i = 0; i < states.keyCount(); ++i) {
+            const QByteArray labels = "terminal=\"" + t.label + "\",state=\"" + QByteArray(states.key(i)).toLower() + '"';
+            appendSample(out, "pos_connection_state", labels, states.value(i) == t.state ? "1" : "0");
+        }
+    }
+
+    appendHeader(out, "pos_queue_depth", "gauge", "Device commands waiting to run.");
+    for (const TerminalMetrics& t : terminals) {
+        appendSample(out, "pos_queue_depth", "terminal=\"" + t.label + '"', QByteArray::number(t.queue.depth));
+    }
+    appendHeader(out, "pos_queue_peak_depth", "gauge", "Highest command queue depth since start.");
+    for (const TerminalMetrics& t : terminals) {
+        appendSample(out, "pos_queue_peak_depth", "terminal=\"" + t.label + '"', QByteArray::number(t.queue.peakDepth));
+    }
+    appendHeader(out, "pos_queue_submitted_total", "counter", "Device commands accepted into the queue.");
+    for (const TerminalMetrics& t : terminals) {
+        appendSample(out, "pos_queue_submitted_total", "terminal=\"" + t.label + '"', QByteArray::number(t.queue.submitted));
+    }
+    appendHeader(out, "pos_queue_rejected_total", "counter", "Device commands rejected because the queue was full.");
+    for (const TerminalMetrics& t : terminals) {
+        appendSample(out, "pos_queue_rejected_total", "terminal=\"" + t.label + '"', QByteArray::number(t.queue.rejected));
+    }
+
+    for (const CounterMetric& metric : CounterMetrics) {
+        appendHeader(out, metric.name, "counter", metric.help);
+        for (const TerminalMetrics& t : terminals) {
+            appendSample(out, metric.name, "terminal=\"" + t.label + '"',
+                         QByteArray::number(t.metrics.counters[metric.counter]));
+        }
+    }
+
+    appendHeader(out, "pos_request_failures_total", "counter", "Backend calls that failed, by operation.");
+    for (const TerminalMetrics& t : terminals) {
+        for (int op = 0; op < POSMetrics::OperationCount; ++op) {
+            const QByteArray labels = "terminal=\"" + t.label + "\",operation=\""
+                + POSMetrics::operationName(POSMetrics::Operation(op)).toUtf8() + '"';
+            appendSample(out, "pos_request_failures_total", labels,
+                         QByteArray::number(t.metrics.operations[op].failures));
+        }
+    }
+
+    appendHeader(out, "pos_request_duration_seconds", "histogram", "Duration of backend calls, by operation.");
+    for (const TerminalMetrics& t : terminals) {
+        for (int op = 0; op < POSMetrics::OperationCount; ++op) {
+            const LatencyHistogram::Summary& latency = t.metrics.operations[op].latency;
+            const QByteArray labels = "terminal=\"" + t.label + "\",operation=\""
+                + POSMetrics::operationName(POSMetrics::Operation(op)).toUtf8() + '"';
+
+            int bucket = 0;
+            quint64 cumulative = 0;
+            for (const double bound : LatencyBoundsSeconds) {
+                const double boundUs = bound * 1e6;
+                while (bucket < LatencyHistogram::BucketCount
+                       && LatencyHistogram::bucketUpperBound(bucket) <= boundUs) {
+                    cumulative += latency.buckets[bucket++];
+                }
+                appendSample(out, "pos_request_duration_seconds_bucket",
+                             labels + ",le=\"" + number(bound) + '"', QByteArray::number(cumulative));
+            }
+            appendSample(out, "pos_request_duration_seconds_bucket", labels + ",le=\"+Inf\"",
+                         QByteArray::number(latency.count));
+            appendSample(out, "pos_request_duration_seconds_sum", labels,
+                         number(latency.meanUs * latency.count / 1e6));
+            appendSample(out, "pos_request_duration_seconds_count", labels, QByteArray::number(latency.count));
+        }
+    }
+
+    return out;
+}
+
+/**
+ * @brief Accepts pending connections.
+ *
+ * Each client gets RequestTimeoutMs to send its request line before the
+ * connection is aborted.
+ */
+void MetricsServer::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        QTimer::singleShot(RequestTimeoutMs, socket, &QTcpSocket::abort);
+    }
+}
+
+/**
+ * @brief Answers a request once its request line has been received.
+ *
+ * @param socket The client connection
+ */
+void MetricsServer::onReadyRead(QTcpSocket* socket)
+{
+    if (socket->property("answered").toBool()) {
+        socket->readAll();
+        return;
+    }
+
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > MaxRequestSize) {
+            socket->abort();
+        }
+        return;
+    }
+
+    const QList<QByteArray> requestLine = socket->readLine(MaxRequestSize).trimmed().split(' ');
+    socket->setProperty("answered", true);
+
+    if (requestLine.size() != 3 || !requestLine.at(2).startsWith("HTTP/")) {
+        respond(socket, "400 Bad Request", "text/plain", "Bad request\n");
+        return;
+    }
+
+    const QByteArray& method = requestLine.at(0);
+    const QByteArray path = requestLine.at(1).split('?').first();
+    if (path != "/metrics") {
+        respond(socket, "404 Not Found", "text/plain", "Not found; metrics are served at /metrics\n");
+    } else if (method != "GET") {
+        respond(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    } else {
+        respond(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8", render());
+    }
+}
+
+/**
+ * @brief Writes a response and closes the connection.
+ *
+ * @param socket The client connection
+ * @param status Status line text
+ * @param contentType Value of the Content-Type header
+ * @param body Response body
+ */
+void MetricsServer::respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& contentType,
+                            const QByteArray& body)
+{
+    QByteArray response;
+    response.reserve(128 + body.size());
+    response.append("HTTP/1.0 ").append(status).append("\r\n");
+    response.append("Content-Type: ").append(contentType).append("\r\n");
+    response.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n");
+    response.append("Connection: close\r\n\r\n");
+    response.append(body);
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,114 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+/**
+ * @file metricsserver.h
+ * @brief Embedded HTTP endpoint serving terminal metrics to Prometheus
+ *
+ * This header declares the MetricsServer class. It answers GET /metrics with
+ * the connection state, command queue statistics, event counters and request
+ * latency histograms of every terminal in a POSCommunicationPool, in the
+ * Prometheus text exposition format, so lanes can be monitored without remote
+ * access to the till.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QObject>
+#include <QPointer>
+#include <QTcpServer>
+
+class POSCommunicationPool;
+class QTcpSocket;
+
+/**
+ * @class MetricsServer
+ * @brief Minimal HTTP/1.0 server for the Prometheus /metrics endpoint
+ *
+ * Every connection serves exactly one request and is then closed. Requests
+ * larger than MaxRequestSize or slower than RequestTimeoutMs are dropped, so a
+ * misbehaving client cannot hold resources on the till. The server lives on
+ * the thread of the pool's terminals and never blocks it.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MaxRequestSize = 8192;     ///< Largest accepted request head in bytes
+    static constexpr int RequestTimeoutMs = 5000;   ///< Time a client has to send its request
+
+    /**
+     * @brief Constructor for MetricsServer
+     * @param pool Terminals whose metrics are served
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit MetricsServer(POSCommunicationPool* pool, QObject* parent = nullptr);
+
+    /**
+     * @brief Starts accepting connections
+     * @param port TCP port to listen on
+     * @param address Interface to bind to; all interfaces by default
+     * @return true if the server is listening, false otherwise (see errorString())
+     */
+    bool listen(quint16 port, const QHostAddress& address = QHostAddress::Any);
+
+    /**
+     * @brief Stops accepting connections
+     */
+    void close();
+
+    /**
+     * @brief Checks if the server is accepting connections
+     * @return true if listening
+     */
+    bool isListening() const;
+
+    /**
+     * @brief Returns the port the server listens on
+     * @return The port, or 0 if not listening
+     */
+    quint16 serverPort() const;
+
+    /**
+     * @brief Returns a description of the last listen() error
+     * @return Human-readable error text
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Renders the metrics of all terminals in the pool
+     * @return Metrics in the Prometheus text exposition format (version 0.0.4)
+     */
+    QByteArray render() const;
+
+private slots:
+    /**
+     * @brief Accepts pending connections
+     */
+    void onNewConnection();
+
+private:
+    /**
+     * @brief Answers a request once its head has been received
+     * @param socket The client connection
+     */
+    void onReadyRead(QTcpSocket* socket);
+
+    /**
+     * @brief Writes a response and closes the connection
+     * @param socket The client connection
+     * @param status Status line text, e.g. "200 OK"
+     * @param contentType Value of the Content-Type header
+     * @param body Response body
+     */
+    static void respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& contentType,
+                        const QByteArray& body);
+
+    QPointer<POSCommunicationPool> m_pool;  ///< Terminals whose metrics are served
+    QTcpServer m_server;                    ///< Listening socket
+};
+
+#endif // METRICSSERVER_H
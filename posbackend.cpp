@@ -0,0 +1,28 @@
+/**
+ * @file posbackend.cpp
+ * @brief Backend selection for POSCommunication
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "posbackend.h"
+#include "librarybackend.h"
+#include "simulatedbackend.h"
+
+/**
+ * @brief Creates the backend selected for this process.
+ *
+ * The POS_BACKEND environment variable picks the implementation, so the same
+ * binary can run against the DLL on a till and against the simulation on a
+ * load-testing node. Unknown values fall back to the library backend.
+ *
+ * @return The new backend
+ */
+std::unique_ptr<POSBackend> POSBackend::create()
+{
+    const QByteArray selected = qgetenv("POS_BACKEND").trimmed().toLower();
+    if (selected == "simulated") {
+        return std::unique_ptr<POSBackend>(new SimulatedBackend());
+    }
+    return std::unique_ptr<POSBackend>(new LibraryBackend());
+}
@@ -0,0 +1,181 @@
+#ifndef POSBACKEND_H
+#define POSBACKEND_H
+
+/**
+ * @file posbackend.h
+ * @brief Transport interface between POSCommunication and a payment terminal
+ *
+ * This header declares the POSBackend interface that POSCommunication drives.
+ * A backend owns the native connection to one terminal and knows how to send
+ * requests over it; everything above it (the device worker, queueing,
+ * reconnection and signal delivery) is shared by all backends.
+ *
+ * Available backends:
+ * - LibraryBackend: the IntegrationHub DLL loaded through QLibrary (Windows)
+ * - SimulatedBackend: an in-process terminal with configurable latency (all platforms)
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QLoggingCategory>
+#include <QString>
+#include <QStringView>
+#include <memory>
+
+/**
+ * @class POSBackend
+ * @brief Abstract connection to one payment terminal
+ *
+ * Apart from initialize(), every method is called on the device worker thread
+ * of the owning POSCommunication, so implementations need no locking of their
+ * own. The exception is a call that exceeded its deadline: it keeps running
+ * on the abandoned thread while abandon() and open() run on the new one.
+ * Failures are reported by throwing std::runtime_error.
+ */
+class POSBackend
+{
+public:
+    /**
+     * @class Listener
+     * @brief Receives events and log messages from a backend
+     *
+     * Events may arrive on any thread, including threads owned by the backend.
+     * String arguments are only valid for the duration of the call.
+     */
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        /**
+         * @brief Called when serial data is received from the device
+         * @param typeCode Code indicating the type of received data
+         * @param value The data value
+         */
+        virtual void onSerialIn(int typeCode, QStringView value) = 0;
+
+        /**
+         * @brief Called when the connection state of a device changes
+         * @param isConnected Whether the device is now connected
+         * @param deviceId Identifier of the affected device
+         */
+        virtual void onDeviceState(bool isConnected, QStringView deviceId) = 0;
+
+        /**
+         * @brief Called for log messages whose category and level are enabled
+         * @param category The logging category of the message
+         * @param level The severity of the message
+         * @param message The formatted message text
+         */
+        virtual void onLog(const QLoggingCategory& category, QtMsgType level, const QString& message) = 0;
+    };
+
+    virtual ~POSBackend() = default;
+
+    /**
+     * @brief Creates the backend selected for this process
+     * @return The backend named by the POS_BACKEND environment variable
+     *
+     * POS_BACKEND may be "library" (the default) or "simulated".
+     */
+    static std::unique_ptr<POSBackend> create();
+
+    /**
+     * @brief Returns a short name identifying the backend (e.g. "library")
+     * @return The backend name
+     */
+    virtual QString name() const = 0;
+
+    /**
+     * @brief Attaches the listener
+     * @param listener Receiver of events and log messages; outlives the backend
+     *
+     * Called once on the thread that creates the owning POSCommunication, so
+     * it must return quickly. Expensive preparation belongs in load().
+     */
+    virtual void initialize(Listener* listener) = 0;
+
+    /**
+     * @brief Loads whatever the backend needs before it can open connections
+     * @return true if the backend can open connections, false otherwise
+     *
+     * Called once on the device worker thread before any other request, so
+     * the user interface is not blocked while e.g. DLLs are read from disk.
+     */
+    virtual bool load() = 0;
+
+    /**
+     * @brief Opens the connection to the terminal
+     * @param companyName The merchant/company identifier
+     * @throws std::runtime_error if the connection cannot be created
+     */
+    virtual void open(const QString& companyName) = 0;
+
+    /**
+     * @brief Closes the connection; does nothing if it is not open
+     */
+    virtual void close() = 0;
+
+    /**
+     * @brief Gives up the open connection after a call on it has hung
+     *
+     * Called on a replacement device worker thread while the hung call is
+     * still running on the old one. Afterwards isOpen() returns false and
+     * open() creates a new connection. Backends whose connection must not
+     * be released under a running call free it once that call returns; the
+     * default simply closes it.
+     */
+    virtual void abandon() { close(); }
+
+    /**
+     * @brief Stops calls from returning to an owner that is being destroyed
+     * @return Number of threads the backend now holds: calls still running
+     *         and threads already parked
+     *
+     * Called from the owner's destructor, on its own thread, while device
+     * threads are stranded in calls. From then on a call that returns, and
+     * any new call, blocks its thread for good instead of returning into
+     * the destroyed owner; the backend itself is leaked. The default holds
+     * nothing, so the owner waits for its stranded threads to return.
+     */
+    virtual int orphan() { return 0; }
+
+    /**
+     * @brief Checks if a connection is open
+     * @return true if open() succeeded and close() has not been called since
+     */
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief Asks the transport to re-establish the open connection
+     */
+    virtual void reconnect() = 0;
+
+    /**
+     * @brief Gets the index of the currently active device
+     * @return The device index or a negative value if no device is active
+     */
+    virtual int activeDeviceIndex() = 0;
+
+    /**
+     * @brief Sends basket data to the terminal
+     * @param jsonData JSON-formatted basket details
+     * @return Result code from the terminal
+     */
+    virtual int sendBasket(const QString& jsonData) = 0;
+
+    /**
+     * @brief Sends payment data to the terminal
+     * @param jsonData JSON-formatted payment details
+     * @return Result code from the terminal
+     */
+    virtual int sendPayment(const QString& jsonData) = 0;
+
+    /**
+     * @brief Queries fiscal information from the terminal
+     * @return JSON-formatted fiscal details
+     */
+    virtual QString fiscalInfo() = 0;
+};
+
+#endif // POSBACKEND_H
@@ -4,99 +4,232 @@
  *
  * This file contains the implementation of the POSCommunication class, which provides
  * a Qt-based interface for communicating with POS (Point of Sale) payment terminals
- * through the IntegrationHub library. The class is designed primarily for Windows
- * platforms where the necessary DLLs are available, but includes platform checks
- * to provide graceful degradation on other operating systems.
+ * through a POSBackend, normally the IntegrationHub library.
  *
  * The implementation handles:
- * - Dynamic loading of required libraries
  * - Connection management with payment terminals
  * - Transaction processing (sending baskets and payments)
- * - Callback handling for device state changes and serial communications
- * - Thread-safe asynchronous operations
+ * - Event handling for device state changes and serial communications
+ * - Thread-safe asynchronous operations on a single device worker thread
  *
- * Platform: Windows (primary), with limited functionality on other platforms
+ * Platform: Qt C++ cross-platform framework
  */
 
 #include "poscommunication.h"
-#include <QDir>
-#include <QCoreApplication>
-#include <QThread>
+#include "librarybackend.h"
+#include "poscommunicationpool.h"
+#include "poslogging.h"
+#include "reconnectscheduler.h"
+#include "threadpolicy.h"
+#include <QJsonDocument>
+#include <QMetaMethod>
 #include <QTimer>
+#include <QWaitCondition>
+#include <algorithm>
+#include <limits>
+#include <utility>
 
 // Initialize static instance
 POSCommunication* POSCommunication::m_instance = nullptr;
 
+static_assert(POSCommunication::MaxInstances == LibraryBackend::MaxConnections,
+              "MaxInstances must match the library backend's callback slots");
+
 /**
  * @brief Constructor for the POSCommunication class.
  *
  * Initializes a new instance of the POSCommunication class with the specified
- * company name. Attempts to load required libraries and initialize function
- * pointers to the IntegrationHub DLL functions.
+ * company name and the backend selected by POSBackend::create().
  *
  * @param companyName The name of the company using the integration, used for identification
  * @param parent The parent QObject for memory management (can be nullptr)
  */
 POSCommunication::POSCommunication(const QString& companyName, QObject* parent)
+    : POSCommunication(companyName, POSBackend::create(), parent)
+{
+}
+
+/**
+ * @brief Constructor for the POSCommunication class with an explicit backend.
+ *
+ * Starts the device worker and loads the backend on it, which for the library
+ * backend loads the IntegrationHub DLL and resolves its functions. Returns
+ * before loading has finished; librariesReady is emitted once it has.
+ *
+ * @param companyName The name of the company using the integration, used for identification
+ * @param backend The transport used to reach the terminal
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+POSCommunication::POSCommunication(const QString& companyName, std::unique_ptr<POSBackend> backend, QObject* parent)
     : QObject(parent)
     , m_companyName(companyName)
-    , m_connection(nullptr)
-    , m_isConnected(false)
-    , m_isConnecting(false)
+    , m_backend(std::move(backend))
+    , m_backendAvailable(false)
+    , m_librariesReady(false)
+    , m_state(Disconnected)
+    , m_publishedState(Disconnected)
+    , m_worker("POSDeviceWorker " + companyName)
+    , m_metricsDumpTimer(nullptr)
+    , m_deviceStateFlushScheduled(false)
+    , m_reconnectScheduler(nullptr)
+    , m_nextSubscriberId(1)
+    , m_fiscalInfoParsed(false)
+    , m_fiscalInfoGeneration(0)
+    , m_fiscalInfoTtlMs(DefaultFiscalInfoTtlMs)
+    , m_paymentKeySequence(0)
+    , m_paymentKeyTtlMs(DefaultPaymentKeyTtlMs)
+    , m_journal(nullptr)
+    , m_capture(nullptr)
 {
-    // Load required libraries
-    if (!loadLibraries()) {
-        emit logMessage("Failed to load required libraries");
-        return;
+    // Needed to deliver stateChanged through queued connections
+    qRegisterMetaType<POSCommunication::State>("POSCommunication::State");
+
+    for (std::atomic<int>& timeout : m_callTimeoutMs) {
+        timeout.store(DefaultCallTimeoutMs);
     }
+    m_callTimeoutMs[POSMetrics::SendPayment].store(DefaultPaymentTimeoutMs);
 
-    // Initialize function pointers
-    initializeFunctions();
+    // Start the device worker that serializes every backend call
+    m_worker.setStallHandler([this]() { onCallTimedOut(); });
+    m_worker.start();
+
+    // The reconnect timer has to live on the worker thread, so create it there
+    m_worker.post([this]() { createReconnectScheduler(); });
+
+    m_backend->initialize(this);
+
+    // Load the transport, e.g. the IntegrationHub DLL, without blocking the
+    // caller; requests queued meanwhile run once loading has finished
+    m_worker.post([this]() {
+        const bool available = m_backend->load();
+        m_backendAvailable.store(available);
+        if (!available) {
+            POS_LOG(lcPosLibrary, QtWarningMsg, "Backend " + m_backend->name() + " is not available");
+        }
+        QMetaObject::invokeMethod(this, [this, available]() {
+            m_librariesReady = true;
+            emit librariesReady(available);
+        });
+    });
 }
 
 /**
  * @brief Destructor for the POSCommunication class.
  *
  * Cleans up resources by disconnecting from any active connections,
- * unloading and freeing libraries, and clearing the singleton instance
- * if this object is the current singleton.
+ * stopping the device worker, destroying the backend, and clearing the
+ * default instance if this object is it. If a device thread is stranded in
+ * a hung call, the backend is orphaned and leaked, so that thread never
+ * returns into this object.
  */
 POSCommunication::~POSCommunication()
 {
-    // Clean up connection
-    disconnect();
+    // Clean up connection; the command queue may reject the request when full
+    try {
+        disconnect();
+    } catch (const std::exception& e) {
+        qWarning() << "Failed to disconnect:" << e.what();
+    }
 
-    // Free libraries
-    for (QLibrary* lib : m_libraries) {
-        lib->unload();
-        delete lib;
+    // No backend calls may run once the backend is destroyed
+    m_worker.setStallHandler(nullptr);
+    m_worker.stop();
+    if (m_worker.strandedThreads() > 0) {
+        // Calls still inside the backend park instead of returning into this
+        // object; a stranded thread whose call returned just before is waited for
+        while (m_worker.runningStrandedThreads() > m_backend->orphan()) {
+            QThread::msleep(OrphanPollMs);
+        }
+        // Unloading the DLL would crash the parked threads
+        qWarning() << "Leaking backend" << m_backend->name() << "because a device call never returned";
+        (void)m_backend.release();
     }
-    m_libraries.clear();
+    m_backend.reset();
 
-    // Clear singleton instance if this is it
+    // Clear default instance if this is it
     if (m_instance == this) {
         m_instance = nullptr;
     }
 }
 
 /**
- * @brief Gets or creates the singleton instance of POSCommunication.
+ * @brief Gets or creates the default instance of POSCommunication.
  *
- * This method implements the singleton pattern, ensuring only one instance
- * of POSCommunication exists. If no instance exists, it creates one with
- * the specified company name.
+ * Single-terminal applications use this instance. It is created through the
+ * process-wide POSCommunicationPool, so asking the pool for the same company
+ * name returns the same object.
  *
  * @param companyName The name of the company using the integration
- * @return A pointer to the singleton POSCommunication instance
+ * @return A pointer to the default POSCommunication instance, or nullptr once
+ *         the application is quitting and the pool has been torn down
  */
 POSCommunication* POSCommunication::getInstance(const QString& companyName)
 {
     if (!m_instance) {
-        m_instance = new POSCommunication(companyName);
+        if (POSCommunicationPool* pool = POSCommunicationPool::instance()) {
+            m_instance = pool->terminal(companyName);
+        }
     }
     return m_instance;
 }
 
+/**
+ * @brief Returns the company name this instance was created for.
+ *
+ * @return The merchant/company identifier
+ */
+QString POSCommunication::companyName() const
+{
+    return m_companyName;
+}
+
+/**
+ * @brief Returns the name of the backend this instance drives.
+ *
+ * @return The backend name
+ */
+QString POSCommunication::backendName() const
+{
+    return m_backend->name();
+}
+
+/**
+ * @brief Checks if the backend has been loaded successfully.
+ *
+ * Safe to call from any thread.
+ *
+ * @return true if the backend is usable, false if it failed or is still loading
+ */
+bool POSCommunication::isAvailable() const
+{
+    return m_backendAvailable.load();
+}
+
+/**
+ * @brief Checks if librariesReady has already been emitted.
+ *
+ * Intended for the instance's thread: a false result guarantees that the
+ * signal is still to come for receivers connected now.
+ *
+ * @return true if loading has finished and been reported, false otherwise
+ */
+bool POSCommunication::isReady() const
+{
+    return m_librariesReady;
+}
+
+/**
+ * @brief Returns the current connection state.
+ *
+ * Lock-free and safe to call from any thread.
+ *
+ * @return The current state
+ */
+POSCommunication::State POSCommunication::state() const
+{
+    return m_state.load(std::memory_order_acquire);
+}
+
 /**
  * @brief Checks if a connection to a payment terminal is established.
  *
@@ -104,379 +237,1383 @@ POSCommunication* POSCommunication::getInstance(const QString& companyName)
  */
 bool POSCommunication::isConnected() const
 {
-    return m_isConnected;
+    return state() == Connected;
 }
 
 /**
  * @brief Checks if a connection attempt is currently in progress.
  *
- * @return true if a connection attempt is in progress, false otherwise
+ * @return true if connecting or reconnecting, false otherwise
  */
 bool POSCommunication::isConnecting() const
 {
-    return m_isConnecting;
+    const State current = state();
+    return current == Connecting || current == Reconnecting;
+}
+
+/**
+ * @brief Stores a new connection state and schedules its publication.
+ *
+ * May be called from any thread. The stateChanged signal is emitted on the
+ * instance's own thread; rapid transitions may be folded into one emission
+ * carrying the latest state.
+ *
+ * @param state The new state
+ */
+void POSCommunication::setState(State state)
+{
+    if (m_state.exchange(state, std::memory_order_acq_rel) != state) {
+        QMetaObject::invokeMethod(this, [this]() { publishState(); }, Qt::AutoConnection);
+    }
+}
+
+/**
+ * @brief Emits stateChanged if the state differs from the last published one.
+ *
+ * Runs on the instance's thread. Also emits connectionStatusChanged whenever
+ * the connected/not-connected distinction flips.
+ */
+void POSCommunication::publishState()
+{
+    const State current = state();
+    if (current == m_publishedState) {
+        return;
+    }
+
+    const bool wasConnected = m_publishedState == Connected;
+    m_publishedState = current;
+    emit stateChanged(current);
+
+    if ((current == Connected) != wasConnected) {
+        emit connectionStatusChanged(current == Connected);
+    }
 }
 
 /**
  * @brief Initiates a connection to the payment terminal.
  *
- * This method starts a new thread to handle the connection process asynchronously.
- * It sets the connection status flags and emits relevant signals to update the UI.
+ * This method queues the connection process on the device worker thread, so
+ * repeated attempts reuse the same thread instead of creating a new one.
+ * The state moves to Connecting immediately and to Connected or Failed once
+ * the attempt has finished.
  */
 void POSCommunication::connect()
 {
-    if (m_connection != nullptr) {
-        emit logMessage("Already connected");
-        return;
+    State current = state();
+    do {
+        if (current == Connecting) {
+            POS_LOG(lcPosConnection, QtInfoMsg, "Connection attempt already in progress...");
+            return;
+        }
+    } while (!m_state.compare_exchange_weak(current, Connecting, std::memory_order_acq_rel));
+
+    QMetaObject::invokeMethod(this, [this]() { publishState(); }, Qt::AutoConnection);
+    POS_LOG(lcPosConnection, QtInfoMsg, "Connecting...");
+
+    m_worker.post([this]() {
+        // A manual attempt starts a fresh backoff cycle
+        m_reconnectScheduler->reset();
+
+        if (m_backend->isOpen()) {
+            POS_LOG(lcPosConnection, QtInfoMsg, "Already connected");
+            setState(Connected);
+            return;
+        }
+
+        try {
+            doConnect();
+            POS_LOG(lcPosConnection, QtInfoMsg, "Connected successfully");
+            setState(Connected);
+        } catch (const std::exception& e) {
+            POS_LOG(lcPosConnection, QtWarningMsg, "Error connecting: " + QString(e.what()));
+            setState(Failed);
+        }
+    });
+}
+
+/**
+ * @brief Sets the backoff parameters used for automatic reconnection.
+ *
+ * @param policy Fast retry delay, growth, jitter and attempt limit
+ */
+void POSCommunication::setReconnectPolicy(const ReconnectScheduler::Policy& policy)
+{
+    {
+        QMutexLocker locker(&m_reconnectPolicyMutex);
+        m_reconnectPolicy = policy;
     }
+    m_worker.post([this, policy]() {
+        m_reconnectScheduler->setPolicy(policy);
+    });
+}
 
-    if (m_isConnecting) {
-        emit logMessage("Connection attempt already in progress...");
-        return;
+/**
+ * @brief Creates the reconnect timer on the current device worker thread.
+ *
+ * Called once at startup and again whenever the worker thread is replaced,
+ * since timers cannot move off a thread that is blocked. The previous
+ * scheduler belongs to the replaced thread and may already be deleted, so
+ * the policy comes from m_reconnectPolicy.
+ */
+void POSCommunication::createReconnectScheduler()
+{
+    ReconnectScheduler::Policy policy;
+    {
+        QMutexLocker locker(&m_reconnectPolicyMutex);
+        policy = m_reconnectPolicy;
     }
+    m_reconnectScheduler = new ReconnectScheduler(m_worker.context());
+    m_reconnectScheduler->setPolicy(policy);
+    QObject::connect(m_reconnectScheduler, &ReconnectScheduler::attemptDue,
+                     m_reconnectScheduler, [this](int attempt) { performReconnectAttempt(attempt); });
+    QObject::connect(m_reconnectScheduler, &ReconnectScheduler::exhausted,
+                     m_reconnectScheduler, [this](int attempts) {
+        POS_LOG(lcPosConnection, QtWarningMsg,
+                QString("Giving up reconnecting after %1 attempts").arg(attempts));
+        setState(Failed);
+    });
+}
+
+/**
+ * @brief Recovers from a backend call that exceeded its deadline.
+ *
+ * Runs on the device worker's watchdog thread after the waiting callers have
+ * been failed. The blocked thread cannot be interrupted, so a new worker
+ * thread takes over: it abandons the old connection, whose hung call still
+ * holds it, and creates a new one before running any further request.
+ */
+void POSCommunication::onCallTimedOut()
+{
+    m_metrics.increment(POSMetrics::CallTimeouts);
+    POS_LOG(lcPosConnection, QtWarningMsg, "Device call exceeded its deadline; recreating the connection");
+    emit callTimedOut();
 
-    m_isConnecting = true;
-    emit logMessage("Connecting...");
-    emit connectionStatusChanged(false);
+    invalidateFiscalInfo();
+    setState(Reconnecting);
 
-    // Create a new thread for connection
-    QThread* thread = QThread::create([this]() {
+    const bool restarted = m_worker.restart([this]() {
+        createReconnectScheduler();
+        m_backend->abandon();
         try {
             doConnect();
-            QMetaObject::invokeMethod(this, [this]() {
-                emit logMessage("Connected successfully");
-                m_isConnecting = false;
-                emit connectionStatusChanged(true);
-            });
+            POS_LOG(lcPosConnection, QtInfoMsg, "Connection recreated after a hung call");
+            setState(Connected);
         } catch (const std::exception& e) {
-            QMetaObject::invokeMethod(this, [this, error = QString(e.what())]() {
-                emit logMessage("Error connecting: " + error);
-                m_isConnecting = false;
-                emit connectionStatusChanged(false);
-            });
+            POS_LOG(lcPosConnection, QtWarningMsg, "Error recreating the connection: " + QString(e.what()));
+            m_reconnectScheduler->schedule();
         }
     });
+    if (restarted) {
+        m_metrics.increment(POSMetrics::WorkerRestarts);
+    }
+}
+
+/**
+ * @brief Performs one scheduled reconnection attempt.
+ *
+ * Runs on the device worker thread when the reconnect scheduler fires. If a
+ * connection is open the backend's own reconnect is used and the next attempt is
+ * scheduled until the device reports itself connected again. Otherwise a new
+ * handle is created, which ends the cycle on success.
+ *
+ * @param attempt One-based number of the attempt
+ */
+void POSCommunication::performReconnectAttempt(int attempt)
+{
+    POS_LOG(lcPosConnection, QtInfoMsg, QString("Reconnect attempt %1...").arg(attempt));
+    m_metrics.increment(POSMetrics::ReconnectAttempts);
 
-    thread->start(QThread::LowPriority);
-    // Thread will self-delete when finished
-    QObject::connect(thread, &QThread::finished, thread, &QThread::deleteLater);
+    try {
+        if (m_backend->isOpen()) {
+            doReconnect();
+        } else {
+            doConnect();
+            POS_LOG(lcPosConnection, QtInfoMsg, "Connected successfully");
+            m_reconnectScheduler->reset();
+            setState(Connected);
+            return;
+        }
+    } catch (const std::exception& e) {
+        POS_LOG(lcPosConnection, QtWarningMsg, QString("Reconnect attempt %1 failed: %2").arg(attempt).arg(e.what()));
+    }
+
+    m_reconnectScheduler->schedule();
 }
 
 /**
  * @brief Performs the actual connection logic to the payment terminal.
  *
- * This method is platform-specific and only implemented for Windows. It creates
- * the communication instance, sets up callbacks, and updates the connection status.
+ * Opens the backend connection; the backend registers its callbacks and
+ * reports device events through the Listener interface. It must be called
+ * on the device worker thread.
  *
- * @throws std::runtime_error if the connection fails or the platform is unsupported
+ * @throws std::runtime_error if the connection fails or the backend is unavailable
  */
 void POSCommunication::doConnect()
 {
-#ifdef Q_OS_WIN
-    emit logMessage("Creating communication instance...");
-    
-    // Create communication instance
-    m_connection = m_createCommunication(reinterpret_cast<const wchar_t*>(m_companyName.utf16()));
-    if (m_connection == nullptr) {
-        throw std::runtime_error("Failed to create communication instance");
-    }
+    m_metrics.measure(POSMetrics::Open, [this]() { m_backend->open(m_companyName); });
+}
 
-    emit logMessage("Setting up callbacks...");
-    
-    // Set callbacks
-    m_setSerialInCallback(m_connection, serialInCallbackHandler);
-    m_setDeviceStateCallback(m_connection, deviceStateCallbackHandler);
-    
-    emit logMessage("Connection setup complete");
-#else
-    emit logMessage("Windows-specific functionality not available on this platform");
-    throw std::runtime_error("Windows-specific functionality not available");
-#endif
+/**
+ * @brief Asks the backend to re-establish the existing connection.
+ *
+ * It must be called on the device worker thread with an open connection.
+ */
+void POSCommunication::doReconnect()
+{
+    m_metrics.measure(POSMetrics::Reconnect, [this]() { m_backend->reconnect(); });
 }
 
 /**
  * @brief Disconnects from the payment terminal.
  *
- * This method is platform-specific and only implemented for Windows. It deletes
- * the communication instance, updates the connection status, and emits relevant signals.
+ * Stops any reconnection cycle and closes the backend connection. The state
+ * always ends up as Disconnected.
  */
 void POSCommunication::disconnect()
 {
-#ifdef Q_OS_WIN
-    if (m_connection != nullptr) {
-        m_deleteCommunication(m_connection);
-        m_connection = nullptr;
-        m_isConnected = false;
-        emit connectionStatusChanged(false);
-        emit logMessage("Disconnected");
+    m_worker.invoke([this]() { doDisconnect(); });
+}
+
+/**
+ * @brief Disconnects from the payment terminal without blocking.
+ *
+ * @return Future that finishes once the connection is closed
+ */
+QFuture<void> POSCommunication::disconnectAsync()
+{
+    return m_worker.submit([this]() { doDisconnect(); });
+}
+
+/**
+ * @brief Stops reconnecting and closes the backend connection.
+ *
+ * It must be called on the device worker thread.
+ */
+void POSCommunication::doDisconnect()
+{
+    m_reconnectScheduler->reset();
+    const bool disconnected = m_backend->isOpen();
+    if (disconnected) {
+        m_backend->close();
+    }
+
+    invalidateFiscalInfo();
+    setState(Disconnected);
+    if (disconnected) {
+        POS_LOG(lcPosConnection, QtInfoMsg, "Disconnected");
     }
-#endif
 }
 
 /**
  * @brief Reconnects to the payment terminal.
  *
- * This method is platform-specific and only implemented for Windows. It either
- * initiates a new connection or calls the reconnect function on the existing connection.
+ * Either initiates a new connection or asks the backend to re-establish the
+ * existing one.
  */
 void POSCommunication::reconnect()
 {
-#ifdef Q_OS_WIN
-    if (m_connection == nullptr) {
+    m_worker.invoke([this]() { doReconnectOrConnect(); });
+}
+
+/**
+ * @brief Reconnects to the payment terminal without blocking.
+ *
+ * The backend's reconnect is limited by the Reconnect call timeout.
+ *
+ * @return Future that finishes once the reconnection has been initiated
+ */
+QFuture<void> POSCommunication::reconnectAsync()
+{
+    return m_worker.submit([this]() { doReconnectOrConnect(); }, callTimeout(POSMetrics::Reconnect));
+}
+
+/**
+ * @brief Re-establishes an open connection, or initiates a new one.
+ *
+ * It must be called on the device worker thread.
+ */
+void POSCommunication::doReconnectOrConnect()
+{
+    if (!m_backend->isOpen()) {
+        connect();
+        return;
+    }
+    doReconnect();
+    setState(Reconnecting);
+    POS_LOG(lcPosConnection, QtInfoMsg, "Reconnection initiated");
+}
+
+/**
+ * @brief Connects and probes the terminal ahead of the first transaction.
+ *
+ * The connection attempt is posted before the probe, so on an idle worker
+ * the probe runs on the freshly opened connection. Both wait for the
+ * library load that the constructor queued.
+ *
+ * @return Future holding the active device index reported by the probe
+ */
+QFuture<int> POSCommunication::warmUp()
+{
+    if (!isConnected()) {
         connect();
-    } else {
-        m_reconnect(m_connection);
-        emit logMessage("Reconnection initiated");
     }
-#endif
+
+    return m_worker.submit([this]() {
+        if (!m_backendAvailable.load()) {
+            throw std::runtime_error("Backend " + m_backend->name().toStdString() + " is not available");
+        }
+        if (!m_backend->isOpen()) {
+            throw DeviceException("Not connected", DeviceException::NotConnected);
+        }
+        const int index = m_backend->activeDeviceIndex();
+        POS_LOG(lcPosConnection, QtInfoMsg, QString("Warm-up complete, active device index %1").arg(index));
+        return index;
+    }, WarmUpProbeTimeoutMs);
 }
 
 /**
  * @brief Gets the index of the currently active device.
  *
- * This method is platform-specific and only implemented for Windows. It retrieves
- * the active device index from the communication instance.
+ * Queues the query on the device worker thread and waits for the answer.
  *
  * @return The index of the active device
- * @throws std::runtime_error if not connected or the platform is unsupported
+ * @throws DeviceException if not connected, the command queue is full or the backend is unavailable
  */
 int POSCommunication::getActiveDeviceIndex()
 {
-#ifdef Q_OS_WIN
-    if (m_connection == nullptr) {
-        throw std::runtime_error("Not connected");
-    }
-    return m_getActiveDeviceIndex(m_connection);
-#else
-    throw std::runtime_error("Function not available on this platform");
-#endif
+    return m_worker.invoke([this]() {
+        if (!m_backend->isOpen()) {
+            throw DeviceException("Not connected", DeviceException::NotConnected);
+        }
+        return m_backend->activeDeviceIndex();
+    });
 }
 
 /**
  * @brief Sends a basket of items to the payment terminal.
  *
- * This method is platform-specific and only implemented for Windows. It sends
- * the basket data in JSON format to the communication instance.
+ * Queues the send on the device worker thread behind any earlier commands
+ * and blocks until the terminal has answered.
  *
  * @param jsonData The basket data in JSON format
  * @return The result code from the send operation
- * @throws std::runtime_error if not connected or the platform is unsupported
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
  */
 int POSCommunication::sendBasket(const QString& jsonData)
 {
-#ifdef Q_OS_WIN
-    if (m_connection == nullptr) {
-        throw std::runtime_error("Not connected");
-    }
-    return m_sendBasket(m_connection, reinterpret_cast<const wchar_t*>(jsonData.utf16()));
-#else
-    throw std::runtime_error("Function not available on this platform");
-#endif
+    return m_worker.invoke([this, &jsonData]() {
+        return doSendBasket(jsonData);
+    }, callTimeout(POSMetrics::SendBasket));
 }
 
 /**
- * @brief Sends a payment request to the payment terminal.
- *
- * This method is platform-specific and only implemented for Windows. It sends
- * the payment data in JSON format to the communication instance.
+ * @brief Sends a typed basket to the payment terminal.
  *
- * @param jsonData The payment data in JSON format
+ * @param basket The basket to send
  * @return The result code from the send operation
- * @throws std::runtime_error if not connected or the platform is unsupported
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
  */
-int POSCommunication::sendPayment(const QString& jsonData)
+int POSCommunication::sendBasket(const Basket& basket)
 {
-#ifdef Q_OS_WIN
-    if (m_connection == nullptr) {
-        throw std::runtime_error("Not connected");
-    }
-    return m_sendPayment(m_connection, reinterpret_cast<const wchar_t*>(jsonData.utf16()));
-#else
-    throw std::runtime_error("Function not available on this platform");
-#endif
+    return sendBasket(basket.toJson());
 }
 
 /**
- * @brief Retrieves fiscal information from the payment terminal.
+ * @brief Sends a basket of items to the payment terminal without blocking.
  *
- * This method is platform-specific and only implemented for Windows. It gets
- * the fiscal information as a string from the communication instance.
+ * The request is queued on the device worker thread. Completion is reported
+ * through the returned future and the basketCompleted or requestFailed signals.
  *
- * @return The fiscal information as a QString
- * @throws std::runtime_error if not connected or the platform is unsupported
+ * @param jsonData The basket data in JSON format
+ * @return Future holding the result code from the send operation
  */
-QString POSCommunication::getFiscalInfo()
+QFuture<int> POSCommunication::sendBasketAsync(const QString& jsonData)
 {
-#ifdef Q_OS_WIN
-    if (m_connection == nullptr) {
-        throw std::runtime_error("Not connected");
-    }
-    BSTR result = m_getFiscalInfo(m_connection);
-    QString info = QString::fromWCharArray(result);
-    SysFreeString(result);
-    return info;
-#else
-    throw std::runtime_error("Function not available on this platform");
-#endif
-}
-
-/**
- * @brief Loads the required libraries for communication.
- *
- * This method is platform-specific and only implemented for Windows. It attempts
- * to load the necessary DLLs from predefined search paths and logs the results.
- *
- * @return true if all required libraries are loaded successfully, false otherwise
- */
-bool POSCommunication::loadLibraries()
-{
-#ifdef Q_OS_WIN
-    const QStringList requiredDlls = {
-        "libcrypto-3.dll",
-        "libusb-1.0.dll",
-        "zlib1.dll",
-        "IntegrationHubCpp.dll"
-    };
-
-    // Search paths
-    QStringList searchPaths = {
-        QCoreApplication::applicationDirPath(),
-        QDir::currentPath()
-    };
-
-    int loadedCount = 0;
-    for (const QString& dllName : requiredDlls) {
-        bool loaded = false;
-        
-        for (const QString& path : searchPaths) {
-            QString dllPath = path + "/" + dllName;
-            if (QFile::exists(dllPath)) {
-                emit logMessage("Loading " + dllName + " from " + path + "...");
-                
-                QLibrary* lib = new QLibrary(dllPath);
-                if (lib->load()) {
-                    m_libraries.append(lib);
-                    loadedCount++;
-                    emit logMessage("Successfully loaded " + dllName);
-                    loaded = true;
-                    break;
-                } else {
-                    emit logMessage("Failed to load " + dllName + ": " + lib->errorString());
-                    delete lib;
-                }
-            }
+    return m_worker.submit([this, jsonData]() {
+        try {
+            const int result = doSendBasket(jsonData);
+            emit basketCompleted(result);
+            return result;
+        } catch (const std::exception& e) {
+            emit requestFailed("sendBasket", QString::fromUtf8(e.what()));
+            throw;
         }
+    }, callTimeout(POSMetrics::SendBasket));
+}
+
+/**
+ * @brief Sends a typed basket to the payment terminal without blocking.
+ *
+ * The serialized document is shared with the queued request, so the basket
+ * can be edited again immediately; its next toJson() detaches the buffer.
+ *
+ * @param basket The basket to send
+ * @return Future holding the result code from the send operation
+ */
+QFuture<int> POSCommunication::sendBasketAsync(const Basket& basket)
+{
+    return sendBasketAsync(basket.toJson());
+}
+
+namespace {
+
+/**
+ * @brief Hands serialized baskets from the submitting thread to the worker
+ */
+class BasketFeed
+{
+public:
+    /**
+     * @brief Appends the next document
+     * @param document Serialized basket
+     */
+    void push(const QString& document)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_documents.append(document);
+        m_pushed.wakeOne();
+    }
 
-        if (!loaded) {
-            emit logMessage("Failed to load required DLL: " + dllName);
-            return false;
+    /**
+     * @brief Returns document i, waiting until it has been pushed
+     * @param index Position in the batch
+     * @return The document
+     */
+    QString take(int index)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_documents.size() <= index) {
+            m_pushed.wait(&m_mutex);
         }
+        // Documents are only read once; release the basket's buffer early
+        return std::exchange(m_documents[index], QString());
     }
 
-    emit logMessage(QString("Successfully loaded %1 DLLs").arg(loadedCount));
-    return true;
-#else
-    emit logMessage("IntegrationHub library is only supported on Windows. Functionality will be limited.");
-    return false;
-#endif
-}
+private:
+    QMutex m_mutex;                ///< Guards m_documents
+    QWaitCondition m_pushed;       ///< Signaled by push()
+    QVector<QString> m_documents;  ///< Documents pushed so far
+};
+
+} // namespace
 
 /**
- * @brief Initializes function pointers to the IntegrationHub DLL functions.
+ * @brief Sends many typed baskets in order as one device command.
+ *
+ * The batch is queued first and the baskets are serialized afterwards, so
+ * the terminal starts on the first basket while the rest are encoded.
  *
- * This method is platform-specific and only implemented for Windows. It resolves
- * the function pointers from the loaded IntegrationHub DLL and logs the results.
+ * @param baskets The baskets to send
+ * @return One result per basket
+ * @throws DeviceException if the command queue is full or the worker is stopped
  */
-void POSCommunication::initializeFunctions()
+QVector<POSCommunication::BatchResult> POSCommunication::sendBaskets(const QVector<Basket>& baskets)
 {
-#ifdef Q_OS_WIN
-    // Find the main DLL in our loaded libraries
-    QLibrary* mainDll = nullptr;
-    for (QLibrary* lib : m_libraries) {
-        if (lib->fileName().contains("IntegrationHubCpp.dll", Qt::CaseInsensitive)) {
-            mainDll = lib;
-            break;
-        }
+    if (m_worker.isCurrentThread()) {
+        return doSendBaskets(baskets.size(), [&baskets](int index) { return baskets.at(index).toJson(); });
     }
 
-    if (!mainDll) {
-        emit logMessage("Failed to find main DLL in loaded libraries");
-        return;
+    auto feed = std::make_shared<BasketFeed>();
+    QFuture<QVector<BatchResult>> future = m_worker.submit([this, feed, count = baskets.size()]() {
+        return doSendBaskets(count, [&feed](int index) { return feed->take(index); });
+    }, batchTimeout(baskets.size()));
+    for (const Basket& basket : baskets) {
+        feed->push(basket.toJson());
     }
+    return future.result();
+}
 
-    // Get function pointers
-    m_createCommunication = reinterpret_cast<CreateCommunication>(mainDll->resolve("createCommunication"));
-    m_deleteCommunication = reinterpret_cast<DeleteCommunication>(mainDll->resolve("deleteCommunication"));
-    m_reconnect = reinterpret_cast<Reconnect>(mainDll->resolve("reconnect"));
-    m_getActiveDeviceIndex = reinterpret_cast<GetActiveDeviceIndex>(mainDll->resolve("getActiveDeviceIndex"));
-    m_sendBasket = reinterpret_cast<SendBasket>(mainDll->resolve("sendBasket"));
-    m_sendPayment = reinterpret_cast<SendPayment>(mainDll->resolve("sendPayment"));
-    m_getFiscalInfo = reinterpret_cast<GetFiscalInfo>(mainDll->resolve("getFiscalInfo"));
-    m_setSerialInCallback = reinterpret_cast<SetSerialInCallback>(mainDll->resolve("setSerialInCallback"));
-    m_setDeviceStateCallback = reinterpret_cast<SetDeviceStateCallback>(mainDll->resolve("setDeviceStateCallback"));
+/**
+ * @brief Sends many baskets in order as one device command.
+ *
+ * @param jsonData JSON-formatted basket details, one document per basket
+ * @return One result per basket
+ * @throws DeviceException if the command queue is full or the worker is stopped
+ */
+QVector<POSCommunication::BatchResult> POSCommunication::sendBaskets(const QStringList& jsonData)
+{
+    return m_worker.invoke([this, &jsonData]() {
+        return doSendBaskets(jsonData.size(), [&jsonData](int index) { return jsonData.at(index); });
+    }, batchTimeout(jsonData.size()));
+}
 
-    // Check that all functions were resolved
-    if (!m_createCommunication || !m_deleteCommunication || !m_reconnect || 
-        !m_getActiveDeviceIndex || !m_sendBasket || !m_sendPayment || 
-        !m_getFiscalInfo || !m_setSerialInCallback || !m_setDeviceStateCallback) {
-        emit logMessage("Failed to resolve one or more functions from DLL");
-    } else {
-        emit logMessage("Successfully initialized all DLL functions");
-    }
-#endif
+/**
+ * @brief Sends many baskets in order without blocking the calling thread.
+ *
+ * @param jsonData JSON-formatted basket details, one document per basket
+ * @return Future holding one result per basket
+ */
+QFuture<QVector<POSCommunication::BatchResult>> POSCommunication::sendBasketsAsync(const QStringList& jsonData)
+{
+    return m_worker.submit([this, jsonData]() {
+        return doSendBaskets(jsonData.size(), [&jsonData](int index) { return jsonData.at(index); });
+    }, batchTimeout(jsonData.size()));
 }
 
-#ifdef Q_OS_WIN
 /**
- * @brief Callback handler for serial input events.
+ * @brief Sends a payment request to the payment terminal.
  *
- * This static method is called by the IntegrationHub library when a serial input
- * event occurs. It forwards the event to the singleton instance of POSCommunication.
+ * Queues the send on the device worker thread behind any earlier commands
+ * and blocks until the terminal has answered.
  *
- * @param typeCode The type code of the serial input event
- * @param value The value of the serial input event as a BSTR
+ * @param jsonData The payment data in JSON format
+ * @return The result code from the send operation
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
+ */
+int POSCommunication::sendPayment(const QString& jsonData)
+{
+    return m_worker.invoke([this, &jsonData]() {
+        return doSendPayment(jsonData);
+    }, callTimeout(POSMetrics::SendPayment));
+}
+
+/**
+ * @brief Sends a payment request to the payment terminal at most once per key.
+ *
+ * @param jsonData The payment data in JSON format
+ * @param idempotencyKey Identifies the payment; empty to send unconditionally
+ * @return The result code from the original send operation
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
  */
-void __stdcall POSCommunication::serialInCallbackHandler(int typeCode, BSTR value)
+int POSCommunication::sendPayment(const QString& jsonData, const QString& idempotencyKey)
 {
-    if (m_instance) {
-        QString valueStr = QString::fromWCharArray(value);
-        QMetaObject::invokeMethod(m_instance, "serialInReceived", Qt::QueuedConnection,
-                                 Q_ARG(int, typeCode), Q_ARG(QString, valueStr));
-        QMetaObject::invokeMethod(m_instance, "logMessage", Qt::QueuedConnection,
-                                 Q_ARG(QString, QString("Serial In - Type: %1, Value: %2").arg(typeCode).arg(valueStr)));
+    if (idempotencyKey.isEmpty() || m_worker.isCurrentThread()) {
+        return sendPayment(jsonData);
     }
+    return sendPaymentAsync(jsonData, idempotencyKey).result();
 }
 
 /**
- * @brief Callback handler for device state changes.
+ * @brief Sends a payment request to the payment terminal without blocking.
  *
- * This static method is called by the IntegrationHub library when the device state
- * changes (e.g., connected or disconnected). It forwards the event to the singleton
- * instance of POSCommunication and handles auto-reconnection if necessary.
+ * The request is queued on the device worker thread. Completion is reported
+ * through the returned future and the paymentCompleted or requestFailed signals.
  *
- * @param isConnected true if the device is connected, false otherwise
- * @param deviceId The ID of the device as a BSTR
- */
-void __stdcall POSCommunication::deviceStateCallbackHandler(bool isConnected, BSTR deviceId)
-{
-    if (m_instance) {
-        QString deviceIdStr = QString::fromWCharArray(deviceId);
-        m_instance->m_isConnected = isConnected;
-        
-        QMetaObject::invokeMethod(m_instance, "deviceStateChanged", Qt::QueuedConnection,
-                                 Q_ARG(bool, isConnected), Q_ARG(QString, deviceIdStr));
-        QMetaObject::invokeMethod(m_instance, "connectionStatusChanged", Qt::QueuedConnection,
-                                 Q_ARG(bool, isConnected));
-        QMetaObject::invokeMethod(m_instance, "logMessage", Qt::QueuedConnection,
-                                 Q_ARG(QString, QString("Device State - Connected: %1, ID: %2")
-                                      .arg(isConnected ? "Yes" : "No").arg(deviceIdStr)));
-        
-        // Auto-reconnect if disconnected
-        if (!isConnected && !m_instance->m_isConnecting) {
-            QMetaObject::invokeMethod(m_instance, "logMessage", Qt::QueuedConnection,
-                                     Q_ARG(QString, "Connection lost. Attempting to reconnect..."));
-            QMetaObject::invokeMethod(m_instance, "connect", Qt::QueuedConnection);
+ * @param jsonData The payment data in JSON format
+ * @return Future holding the result code from the send operation
+ */
+QFuture<int> POSCommunication::sendPaymentAsync(const QString& jsonData)
+{
+    return m_worker.submit([this, jsonData]() {
+        try {
+            const int result = doSendPayment(jsonData);
+            emit paymentCompleted(result);
+            return result;
+        } catch (const std::exception& e) {
+            emit requestFailed("sendPayment", QString::fromUtf8(e.what()));
+            throw;
         }
+    }, callTimeout(POSMetrics::SendPayment));
+}
+
+/**
+ * @brief Sends a payment request to the payment terminal at most once per key.
+ *
+ * The table lookup and the submission happen under one lock, so of two
+ * concurrent requests with the same key exactly one is queued.
+ *
+ * @param jsonData The payment data in JSON format
+ * @param idempotencyKey Identifies the payment; empty to send unconditionally
+ * @return Future holding the result code of the original send operation
+ */
+QFuture<int> POSCommunication::sendPaymentAsync(const QString& jsonData, const QString& idempotencyKey)
+{
+    if (idempotencyKey.isEmpty()) {
+        return sendPaymentAsync(jsonData);
+    }
+
+    QMutexLocker locker(&m_paymentKeyMutex);
+    prunePaymentKeysLocked();
+
+    const auto existing = m_paymentKeys.constFind(idempotencyKey);
+    if (existing != m_paymentKeys.constEnd()
+        && (!existing->future.isFinished() || existing->dispatched->load())) {
+        m_metrics.increment(POSMetrics::DuplicatePayments);
+        POS_LOG(lcPosRequest, QtInfoMsg, "Duplicate payment " + idempotencyKey + " answered by the original request");
+        return existing->future;
     }
+
+    PaymentRecord record;
+    record.dispatched = std::make_shared<std::atomic<bool>>(false);
+    record.expiry = QDeadlineTimer(m_paymentKeyTtlMs.load());
+    record.sequence = ++m_paymentKeySequence;
+    record.future = m_worker.submit([this, jsonData, dispatched = record.dispatched]() {
+        try {
+            const int result = doSendPayment(jsonData, dispatched.get());
+            emit paymentCompleted(result);
+            return result;
+        } catch (const std::exception& e) {
+            emit requestFailed("sendPayment", QString::fromUtf8(e.what()));
+            throw;
+        }
+    }, callTimeout(POSMetrics::SendPayment));
+
+    m_paymentKeyOrder.enqueue(qMakePair(record.sequence, idempotencyKey));
+    m_paymentKeys.insert(idempotencyKey, record);
+    return record.future;
+}
+
+/**
+ * @brief Sets how long idempotency keys of payments are remembered.
+ *
+ * @param ms Time to live in milliseconds
+ */
+void POSCommunication::setPaymentKeyTtl(int ms)
+{
+    m_paymentKeyTtlMs.store(std::max(0, ms));
+}
+
+/**
+ * @brief Returns how long idempotency keys of payments are remembered.
+ *
+ * @return Time to live in milliseconds
+ */
+int POSCommunication::paymentKeyTtl() const
+{
+    return m_paymentKeyTtlMs.load();
+}
+
+/**
+ * @brief Drops expired idempotency keys of finished payments.
+ *
+ * Keys are visited oldest first and the scan stops at the first live one,
+ * so each call costs only the keys it removes. A key reused after a failed
+ * dispatch leaves a stale order entry behind, recognised by its sequence.
+ */
+void POSCommunication::prunePaymentKeysLocked()
+{
+    while (!m_paymentKeyOrder.isEmpty()) {
+        const QPair<quint64, QString>& oldest = m_paymentKeyOrder.head();
+        const auto record = m_paymentKeys.find(oldest.second);
+        if (record != m_paymentKeys.end() && record->sequence == oldest.first) {
+            if (!record->expiry.hasExpired() || !record->future.isFinished()) {
+                return;
+            }
+            m_paymentKeys.erase(record);
+        }
+        m_paymentKeyOrder.dequeue();
+    }
+}
+
+/**
+ * @brief Retrieves fiscal information from the payment terminal.
+ *
+ * Queues the query on the device worker thread behind any earlier commands
+ * and blocks until the terminal has answered.
+ *
+ * @return The fiscal information as a QString
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
+ */
+QString POSCommunication::getFiscalInfo()
+{
+    QString info;
+    if (cachedFiscalInfo(info)) {
+        return info;
+    }
+    return m_worker.invoke([this]() {
+        return fetchFiscalInfo();
+    }, callTimeout(POSMetrics::FiscalInfo));
+}
+
+/**
+ * @brief Retrieves fiscal information parsed into a JSON object.
+ *
+ * The parsed object is stored next to the cached string, so repeated calls
+ * within the TTL neither reach the terminal nor re-parse the document.
+ *
+ * @return The fiscal details, or an empty object if they are not valid JSON
+ * @throws DeviceException if not connected, the command queue is full or the platform is unsupported
+ */
+QJsonObject POSCommunication::getFiscalInfoObject()
+{
+    {
+        QMutexLocker locker(&m_fiscalInfoMutex);
+        if (m_fiscalInfoParsed && !m_fiscalInfoExpiry.hasExpired()) {
+            return m_fiscalInfoObject;
+        }
+    }
+
+    const QString info = getFiscalInfo();
+
+    QJsonParseError error;
+    const QJsonObject object = QJsonDocument::fromJson(info.toUtf8(), &error).object();
+    if (error.error != QJsonParseError::NoError) {
+        POS_LOG(lcPosRequest, QtWarningMsg, "Fiscal info is not valid JSON: " + error.errorString());
+    }
+
+    // Only attach the object if the cache still holds the string it came from
+    QMutexLocker locker(&m_fiscalInfoMutex);
+    if (!m_fiscalInfoExpiry.hasExpired() && m_fiscalInfo == info) {
+        m_fiscalInfoObject = object;
+        m_fiscalInfoParsed = true;
+    }
+    return object;
+}
+
+/**
+ * @brief Sets how long fiscal information is served from the cache.
+ *
+ * @param ms Time to live in milliseconds; 0 disables the cache
+ */
+void POSCommunication::setFiscalInfoTtl(int ms)
+{
+    m_fiscalInfoTtlMs.store(std::max(0, ms));
+    invalidateFiscalInfo();
+}
+
+/**
+ * @brief Returns how long fiscal information is served from the cache.
+ *
+ * @return Time to live in milliseconds
+ */
+int POSCommunication::fiscalInfoTtl() const
+{
+    return m_fiscalInfoTtlMs.load();
+}
+
+/**
+ * @brief Sets which serial-in events carry a payment's outcome.
+ *
+ * @param filter Returns true for outcome events; empty for none
+ */
+void POSCommunication::setOutcomeFilter(TransactionJournal::OutcomeFilter filter)
+{
+    std::shared_ptr<const TransactionJournal::OutcomeFilter> published;
+    if (filter) {
+        published = std::make_shared<const TransactionJournal::OutcomeFilter>(std::move(filter));
+    }
+    std::atomic_store(&m_outcomeFilter, std::move(published));
+}
+
+/**
+ * @brief Discards cached fiscal information.
+ *
+ * Bumps the generation so a query already running on the worker does not
+ * store its now outdated result.
+ */
+void POSCommunication::invalidateFiscalInfo()
+{
+    QMutexLocker locker(&m_fiscalInfoMutex);
+    ++m_fiscalInfoGeneration;
+    m_fiscalInfoExpiry = QDeadlineTimer();
+    m_fiscalInfo.clear();
+    m_fiscalInfoObject = QJsonObject();
+    m_fiscalInfoParsed = false;
+}
+
+/**
+ * @brief Retrieves fiscal information from the payment terminal without blocking.
+ *
+ * The request is queued on the device worker thread. Completion is reported
+ * through the returned future and the fiscalInfoReady or requestFailed signals.
+ *
+ * @return Future holding the fiscal information
+ */
+QFuture<QString> POSCommunication::getFiscalInfoAsync()
+{
+    QString cached;
+    if (cachedFiscalInfo(cached)) {
+        QMetaObject::invokeMethod(this, [this, cached]() {
+            emit fiscalInfoReady(cached);
+        }, Qt::QueuedConnection);
+
+        QFutureInterface<QString> promise;
+        promise.reportStarted();
+        promise.reportResult(cached);
+        promise.reportFinished();
+        return promise.future();
+    }
+
+    return m_worker.submit([this]() {
+        try {
+            const QString info = fetchFiscalInfo();
+            emit fiscalInfoReady(info);
+            return info;
+        } catch (const std::exception& e) {
+            emit requestFailed("getFiscalInfo", QString::fromUtf8(e.what()));
+            throw;
+        }
+    }, callTimeout(POSMetrics::FiscalInfo));
+}
+
+/**
+ * @brief Sets how long a backend call may take before it is abandoned.
+ *
+ * @param operation The call to limit
+ * @param ms Deadline in milliseconds; 0 lets the call run indefinitely
+ */
+void POSCommunication::setCallTimeout(POSMetrics::Operation operation, int ms)
+{
+    if (operation >= 0 && operation < POSMetrics::OperationCount) {
+        m_callTimeoutMs[operation].store(std::max(0, ms));
+    }
+}
+
+/**
+ * @brief Returns how long a backend call may take.
+ *
+ * @param operation The call
+ * @return Deadline in milliseconds, 0 if unlimited
+ */
+int POSCommunication::callTimeout(POSMetrics::Operation operation) const
+{
+    if (operation < 0 || operation >= POSMetrics::OperationCount) {
+        return 0;
+    }
+    return m_callTimeoutMs[operation].load();
+}
+
+/**
+ * @brief Returns the deadline of a batch of baskets.
+ *
+ * @param count Number of baskets
+ * @return The per-basket deadline times count, 0 if unlimited
+ */
+int POSCommunication::batchTimeout(int count) const
+{
+    const qint64 ms = qint64(callTimeout(POSMetrics::SendBasket)) * std::max(1, count);
+    return int(std::min<qint64>(ms, std::numeric_limits<int>::max()));
+}
+
+/**
+ * @brief Sets the maximum number of device commands waiting to run.
+ *
+ * Commands submitted beyond this depth fail immediately with
+ * DeviceException::QueueFull, so producers are never stalled by a busy terminal.
+ *
+ * @param depth Queue depth limit
+ */
+void POSCommunication::setMaxQueueDepth(int depth)
+{
+    m_worker.setMaxQueueDepth(depth);
+}
+
+/**
+ * @brief Returns metrics of the device command queue.
+ *
+ * @return Current depth, peak depth and accepted/rejected counters
+ */
+DeviceWorker::QueueStats POSCommunication::queueStats() const
+{
+    return m_worker.queueStats();
+}
+
+/**
+ * @brief Returns latency and event statistics of this terminal.
+ *
+ * @return Per-operation statistics and event counters
+ */
+POSMetrics::Snapshot POSCommunication::metricsSnapshot() const
+{
+    return m_metrics.snapshot();
+}
+
+/**
+ * @brief Periodically logs the metrics as JSON to the pos.metrics category.
+ *
+ * Must be called on the instance's thread.
+ *
+ * @param ms Interval in milliseconds; 0 stops the dumps
+ */
+void POSCommunication::setMetricsDumpInterval(int ms)
+{
+    if (ms <= 0) {
+        if (m_metricsDumpTimer) {
+            m_metricsDumpTimer->stop();
+        }
+        return;
+    }
+
+    if (!m_metricsDumpTimer) {
+        m_metricsDumpTimer = new QTimer(this);
+        QObject::connect(m_metricsDumpTimer, &QTimer::timeout, this, &POSCommunication::dumpMetrics);
+    }
+    m_metricsDumpTimer->start(ms);
+}
+
+/**
+ * @brief Logs the current metrics as one JSON line.
+ */
+void POSCommunication::dumpMetrics()
+{
+    if (!lcPosMetrics().isInfoEnabled()) {
+        return;
+    }
+
+    const DeviceWorker::QueueStats stats = queueStats();
+    QJsonObject queue;
+    queue.insert("depth", stats.depth);
+    queue.insert("peakDepth", stats.peakDepth);
+    queue.insert("submitted", double(stats.submitted));
+    queue.insert("rejected", double(stats.rejected));
+
+    QJsonObject object = metricsSnapshot().toJson();
+    object.insert("terminal", m_companyName);
+    object.insert("queue", queue);
+
+    log(lcPosMetrics(), QtInfoMsg, QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact)));
+}
+
+/**
+ * @brief Performs the basket send on the device worker thread.
+ *
+ * Sends the basket data in JSON format through the backend.
+ *
+ * @param jsonData The basket data in JSON format
+ * @return The result code from the send operation
+ * @throws DeviceException with NotConnected if not connected
+ * @throws std::runtime_error if the backend is unavailable or the call fails
+ */
+int POSCommunication::doSendBasket(const QString& jsonData)
+{
+    if (!m_backend->isOpen()) {
+        throw DeviceException("Not connected", DeviceException::NotConnected);
+    }
+    // Cached info cannot be refilled until this returns, since queries also run here
+    invalidateFiscalInfo();
+    if (TrafficCapture* capture = m_capture.load(std::memory_order_acquire)) {
+        capture->record(TrafficCapture::SendBasket, 0, jsonData);
+    }
+    return journaled(TransactionJournal::SendBasket, jsonData, [&]() {
+        return m_metrics.measure(POSMetrics::SendBasket, [&]() { return m_backend->sendBasket(jsonData); });
+    });
+}
+
+/**
+ * @brief Performs the payment send on the device worker thread.
+ *
+ * Sends the payment data in JSON format through the backend.
+ *
+ * @param jsonData The payment data in JSON format
+ * @param dispatched Set once the payment is handed to the backend, may be nullptr
+ * @return The result code from the send operation
+ * @throws DeviceException with NotConnected if not connected
+ * @throws std::runtime_error if the backend is unavailable or the call fails
+ */
+int POSCommunication::doSendPayment(const QString& jsonData, std::atomic<bool>* dispatched)
+{
+    if (!m_backend->isOpen()) {
+        throw DeviceException("Not connected", DeviceException::NotConnected);
+    }
+    if (dispatched) {
+        dispatched->store(true);
+    }
+    invalidateFiscalInfo();
+    if (TrafficCapture* capture = m_capture.load(std::memory_order_acquire)) {
+        capture->record(TrafficCapture::SendPayment, 0, jsonData);
+    }
+    return journaled(TransactionJournal::SendPayment, jsonData, [&]() {
+        return m_metrics.measure(POSMetrics::SendPayment, [&]() { return m_backend->sendPayment(jsonData); });
+    });
+}
+
+/**
+ * @brief Sends a batch of baskets on the device worker thread.
+ *
+ * Each basket goes through doSendBasket(), so it is journaled and measured
+ * like a single send. Failures are recorded and the batch continues.
+ *
+ * @param count Number of baskets
+ * @param document Returns the JSON of basket i
+ * @return One result per basket
+ */
+QVector<POSCommunication::BatchResult> POSCommunication::doSendBaskets(int count,
+                                                                       const std::function<QString(int index)>& document)
+{
+    QVector<BatchResult> results(count);
+    int failures = 0;
+    for (int i = 0; i < count; ++i) {
+        const QString jsonData = document(i);
+        try {
+            results[i].result = doSendBasket(jsonData);
+        } catch (const std::exception& e) {
+            results[i].error = QString::fromUtf8(e.what());
+            ++failures;
+        }
+    }
+
+    POS_LOG(lcPosRequest, QtInfoMsg, QString("Sent batch of %1 baskets, %2 failed").arg(count).arg(failures));
+    return results;
+}
+
+/**
+ * @brief Runs a basket or payment call and journals it.
+ *
+ * The command is journaled before the call, so a crash inside the DLL leaves
+ * it open for TransactionJournal::reconcile().
+ *
+ * @param command Kind of command, for the journal
+ * @param jsonData JSON sent to the terminal
+ * @param call Performs the DLL call
+ * @return The result code from the call
+ */
+int POSCommunication::journaled(TransactionJournal::Command command, const QString& jsonData,
+                                const std::function<int()>& call)
+{
+    TransactionJournal* journal = m_journal.load(std::memory_order_acquire);
+    const quint64 id = journal ? journal->beginTransaction(command, jsonData) : 0;
+    if (id == 0) {
+        return call();
+    }
+
+    int result;
+    try {
+        result = call();
+    } catch (const std::exception& e) {
+        journal->recordFailure(id, QString::fromUtf8(e.what()));
+        throw;
+    }
+    journal->recordResult(id, result);
+    return result;
+}
+
+/**
+ * @brief Performs the fiscal information query on the device worker thread.
+ *
+ * Gets the fiscal information as a string through the backend.
+ *
+ * @return The fiscal information as a QString
+ * @throws DeviceException with NotConnected if not connected
+ * @throws std::runtime_error if the backend is unavailable or the call fails
+ */
+QString POSCommunication::doGetFiscalInfo()
+{
+    if (!m_backend->isOpen()) {
+        throw DeviceException("Not connected", DeviceException::NotConnected);
+    }
+    if (TrafficCapture* capture = m_capture.load(std::memory_order_acquire)) {
+        capture->record(TrafficCapture::GetFiscalInfo);
+    }
+    return m_metrics.measure(POSMetrics::FiscalInfo, [this]() { return m_backend->fiscalInfo(); });
+}
+
+/**
+ * @brief Returns cached fiscal information or queries and caches it.
+ *
+ * Runs on the device worker thread. Several queries queued behind each other
+ * are answered by the first one that reaches the terminal.
+ *
+ * @return The fiscal information as a QString
+ * @throws DeviceException with NotConnected if not connected
+ * @throws std::runtime_error if the backend is unavailable or the call fails
+ */
+QString POSCommunication::fetchFiscalInfo()
+{
+    QString info;
+    if (cachedFiscalInfo(info)) {
+        return info;
+    }
+
+    quint64 generation;
+    {
+        QMutexLocker locker(&m_fiscalInfoMutex);
+        generation = m_fiscalInfoGeneration;
+    }
+
+    info = doGetFiscalInfo();
+
+    const int ttl = m_fiscalInfoTtlMs.load();
+    QMutexLocker locker(&m_fiscalInfoMutex);
+    if (ttl > 0 && generation == m_fiscalInfoGeneration) {
+        m_fiscalInfo = info;
+        m_fiscalInfoObject = QJsonObject();
+        m_fiscalInfoParsed = false;
+        m_fiscalInfoExpiry.setRemainingTime(ttl);
+    }
+    return info;
+}
+
+/**
+ * @brief Looks up unexpired fiscal information in the cache.
+ *
+ * @param info Receives the cached details on a hit
+ * @return true on a cache hit, false otherwise
+ */
+bool POSCommunication::cachedFiscalInfo(QString& info) const
+{
+    QMutexLocker locker(&m_fiscalInfoMutex);
+    if (m_fiscalInfoExpiry.hasExpired()) {
+        return false;
+    }
+    info = m_fiscalInfo;
+    return true;
+}
+
+/**
+ * @brief Delivers an enabled log message.
+ *
+ * Called through the POS_LOG macro, which has already checked that the
+ * category is enabled for the level. The message is written to the Qt message
+ * handler and emitted through logMessage if anything is connected to it.
+ * Safe to call from any thread.
+ *
+ * @param category The logging category of the message
+ * @param level The severity of the message
+ * @param message The formatted message text
+ */
+void POSCommunication::log(const QLoggingCategory& category, QtMsgType level, const QString& message)
+{
+    const QMessageLogger logger(nullptr, 0, nullptr, category.categoryName());
+    switch (level) {
+    case QtDebugMsg:
+        logger.debug(category).noquote() << message;
+        break;
+    case QtInfoMsg:
+        logger.info(category).noquote() << message;
+        break;
+    case QtWarningMsg:
+        logger.warning(category).noquote() << message;
+        break;
+    default:
+        logger.critical(category).noquote() << message;
+        break;
+    }
+
+    if (isLogEnabled()) {
+        emit logMessage(message);
+    }
+}
+
+/**
+ * @brief Checks if anything is connected to the logMessage signal.
+ *
+ * Used to avoid emitting log signals that nobody would receive.
+ *
+ * @return true if logMessage has at least one receiver, false otherwise
+ */
+bool POSCommunication::isLogEnabled() const
+{
+    static const QMetaMethod logSignal = QMetaMethod::fromSignal(&POSCommunication::logMessage);
+    return isSignalConnected(logSignal);
+}
+
+/**
+ * @brief Checks if anything is connected to the serialInReceived signal.
+ *
+ * Lets the callback skip copying the payload when only direct subscribers
+ * are interested in it.
+ *
+ * @return true if serialInReceived has at least one receiver, false otherwise
+ */
+bool POSCommunication::isSerialInConnected() const
+{
+    static const QMetaMethod serialInSignal = QMetaMethod::fromSignal(&POSCommunication::serialInReceived);
+    return isSignalConnected(serialInSignal);
+}
+
+/**
+ * @brief Registers a handler that receives serial input directly.
+ *
+ * The subscriber list is copied on every change and published atomically,
+ * so the callback thread reads it without taking a lock.
+ *
+ * @param handler Called for every serial-in event
+ * @return Subscription ID for unsubscribeSerialIn()
+ */
+int POSCommunication::subscribeSerialIn(SerialInHandler handler)
+{
+    QMutexLocker locker(&m_subscriberMutex);
+    const std::shared_ptr<const SerialInSubscribers> current = std::atomic_load(&m_serialInSubscribers);
+    auto next = current ? std::make_shared<SerialInSubscribers>(*current) : std::make_shared<SerialInSubscribers>();
+    const int id = m_nextSubscriberId++;
+    next->push_back({id, std::move(handler)});
+    std::atomic_store(&m_serialInSubscribers, std::shared_ptr<const SerialInSubscribers>(std::move(next)));
+    return id;
+}
+
+/**
+ * @brief Removes a handler registered with subscribeSerialIn().
+ *
+ * @param id Subscription ID returned by subscribeSerialIn()
+ */
+void POSCommunication::unsubscribeSerialIn(int id)
+{
+    QMutexLocker locker(&m_subscriberMutex);
+    const std::shared_ptr<const SerialInSubscribers> current = std::atomic_load(&m_serialInSubscribers);
+    if (!current) {
+        return;
+    }
+
+    auto next = std::make_shared<SerialInSubscribers>();
+    next->reserve(current->size());
+    for (const SerialInSubscriber& subscriber : *current) {
+        if (subscriber.id != id) {
+            next->push_back(subscriber);
+        }
+    }
+
+    std::shared_ptr<const SerialInSubscribers> published;
+    if (!next->empty()) {
+        published = std::move(next);
+    }
+    std::atomic_store(&m_serialInSubscribers, std::move(published));
+}
+
+/**
+ * @brief Journals every basket and payment sent through this instance.
+ *
+ * @param journal Open journal, or nullptr to stop journaling
+ */
+void POSCommunication::setJournal(TransactionJournal* journal)
+{
+    m_journal.store(journal, std::memory_order_release);
+}
+
+/**
+ * @brief Records all traffic of this instance for later replay.
+ *
+ * @param capture Open capture, or nullptr to stop recording
+ */
+void POSCommunication::setCapture(TrafficCapture* capture)
+{
+    m_capture.store(capture, std::memory_order_release);
+}
+
+/**
+ * @brief Delivers the coalesced device states.
+ *
+ * Runs on the instance's thread once per coalescing window. Emits
+ * deviceStateChanged once per device with its latest state, publishes the
+ * connection state if it changed, and starts the reconnect backoff if the
+ * device ended up disconnected.
+ */
+void POSCommunication::flushDeviceStates()
+{
+    m_deviceStateFlushScheduled.store(false);
+
+    QHash<QString, PendingDeviceState> states;
+    {
+        QMutexLocker locker(&m_deviceStateMutex);
+        states.swap(m_pendingDeviceStates);
+    }
+
+    if (states.isEmpty()) {
+        return;
+    }
+
+    // A state change may mean a different device or a restarted fiscal memory
+    invalidateFiscalInfo();
+
+    for (auto it = states.constBegin(); it != states.constEnd(); ++it) {
+        emit deviceStateChanged(it.value().isConnected, it.key());
+        POS_LOG(lcPosConnection, QtInfoMsg, QString("Device State - Connected: %1, ID: %2 (%3 changes)")
+                .arg(it.value().isConnected ? "Yes" : "No").arg(it.key()).arg(it.value().changes));
+    }
+
+    publishState();
+
+    // Auto-reconnect with backoff if disconnected; stop retrying once back
+    const State current = state();
+    if (current == Connected) {
+        m_worker.post([this]() {
+            m_reconnectScheduler->reset();
+        });
+    } else if (current == Reconnecting) {
+        POS_LOG(lcPosConnection, QtInfoMsg, "Connection lost. Scheduling reconnect...");
+        m_worker.post([this]() {
+            m_reconnectScheduler->schedule();
+        });
+    }
+}
+
+/**
+ * @brief Handles a serial input event for this instance.
+ *
+ * Runs on the backend's callback thread. A payment outcome accepted by the
+ * outcome filter drops the cached fiscal info, since it changes the
+ * terminal's totals; other events leave the cache alone. Direct subscribers
+ * see the backend's buffer first. The payload is then copied at most once,
+ * and only if the signal has receivers; queued receivers share that buffer
+ * through implicit sharing. The log line is only formatted when pos.callback
+ * debug logging is enabled.
+ *
+ * @param typeCode The type code of the serial input event
+ * @param value The value of the serial input event
+ */
+void POSCommunication::onSerialIn(int typeCode, QStringView value)
+{
+    ThreadPolicy::adopt(ThreadPolicy::CallbackLane, QStringLiteral("POSCallback"));
+    m_metrics.increment(POSMetrics::SerialInEvents);
+    if (const std::shared_ptr<const TransactionJournal::OutcomeFilter> outcome = std::atomic_load(&m_outcomeFilter)) {
+        if ((*outcome)(typeCode, value)) {
+            invalidateFiscalInfo();
+        }
+    }
+
+    if (TransactionJournal* journal = m_journal.load(std::memory_order_acquire)) {
+        journal->recordSerialIn(typeCode, value);
+    }
+    if (TrafficCapture* capture = m_capture.load(std::memory_order_acquire)) {
+        capture->record(TrafficCapture::SerialIn, typeCode, value);
+    }
+
+    if (const std::shared_ptr<const SerialInSubscribers> subscribers = std::atomic_load(&m_serialInSubscribers)) {
+        for (const SerialInSubscriber& subscriber : *subscribers) {
+            subscriber.handler(typeCode, value);
+        }
+    }
+
+    if (isSerialInConnected()) {
+        emit serialInReceived(typeCode, value.toString());
+    }
+
+    POS_LOG(lcPosCallback, QtDebugMsg, QString("Serial In - Type: %1, Value: %2").arg(typeCode).arg(value));
+}
+
+/**
+ * @brief Handles a device state change for this instance.
+ *
+ * Runs on the backend's callback thread. The state is recorded as the latest
+ * one for its device and a flush is scheduled unless one is already pending,
+ * so a burst of flaps costs one queued event instead of three per flap.
+ *
+ * @param isConnected true if the device is connected, false otherwise
+ * @param deviceId The ID of the device
+ */
+void POSCommunication::onDeviceState(bool isConnected, QStringView deviceId)
+{
+    ThreadPolicy::adopt(ThreadPolicy::CallbackLane, QStringLiteral("POSCallback"));
+    m_metrics.increment(POSMetrics::DeviceStateEvents);
+    if (!isConnected) {
+        m_metrics.increment(POSMetrics::ConnectionsLost);
+    }
+    if (TrafficCapture* capture = m_capture.load(std::memory_order_acquire)) {
+        capture->record(TrafficCapture::DeviceState, isConnected ? 1 : 0, deviceId);
+    }
+
+    const QString deviceIdStr = deviceId.toString();
+
+    // Update the state lock-free; it is published by the next flush. An
+    // explicit disconnect or a connect in progress is not overridden.
+    State current = state();
+    if (current != Disconnected && current != Connecting) {
+        m_state.compare_exchange_strong(current, isConnected ? Connected : Reconnecting,
+                                        std::memory_order_acq_rel);
+    }
+
+    {
+        QMutexLocker locker(&m_deviceStateMutex);
+        PendingDeviceState& pending = m_pendingDeviceStates[deviceIdStr];
+        pending.isConnected = isConnected;
+        ++pending.changes;
+    }
+
+    if (!m_deviceStateFlushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, [this]() {
+            QTimer::singleShot(StateCoalesceIntervalMs, this, &POSCommunication::flushDeviceStates);
+        }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Delivers a log message emitted by the backend.
+ *
+ * @param category The logging category of the message
+ * @param level The severity of the message
+ * @param message The formatted message text
+ */
+void POSCommunication::onLog(const QLoggingCategory& category, QtMsgType level, const QString& message)
+{
+    log(category, level, message);
 }
-#endif
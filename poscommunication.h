@@ -7,29 +7,43 @@
  *
  * This header file defines the POSCommunication class which serves as an interface
  * between a Point of Sale (POS) application and payment terminal devices. It is designed
- * to work with the Payosy Integration Hub on Windows platforms, providing a Qt-based
- * wrapper around native Windows libraries for payment processing and device communication.
+ * to work with the Payosy Integration Hub, providing a Qt-based wrapper for payment
+ * processing and device communication.
  *
- * The class implements a singleton pattern for system-wide access to payment functionality
- * and handles the dynamic loading of required libraries, callback registration, and
- * asynchronous communication with payment devices.
+ * The class provides a default instance for system-wide access to payment functionality
+ * and handles connection management, reconnection and asynchronous communication with
+ * payment devices. The transport itself is a POSBackend: the IntegrationHub DLL on
+ * Windows, or a simulated terminal on any platform. All backend calls are serialized
+ * on a single long-lived device worker thread.
  *
- * Platform: Windows with Qt framework
+ * Platform: Qt C++ cross-platform framework (library backend: Windows only)
  */
 
 #include <QString>
+#include <QStringView>
 #include <QObject>
-#include <QLibrary>
 #include <QThread>
 #include <QDebug>
+#include <QLoggingCategory>
+#include <QFuture>
+#include <QDeadlineTimer>
+#include <QJsonObject>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
 #include <functional>
 #include <memory>
-
-#ifdef Q_OS_WIN
-#include <Windows.h>
-#include <comdef.h>
-#include <comutil.h>
-#endif
+#include <vector>
+#include "basket.h"
+#include "deviceworker.h"
+#include "posmetrics.h"
+#include "posbackend.h"
+#include "reconnectscheduler.h"
+#include "trafficcapture.h"
+#include "transactionjournal.h"
 
 /**
  * @class POSCommunication
@@ -39,14 +53,29 @@
  * payment terminals. It manages the connection state, handles payment and basket
  * transactions, and provides status information about connected devices.
  *
- * It uses a singleton pattern to ensure only one instance manages device communication
- * throughout the application lifecycle.
+ * Several instances may exist at once, one per terminal, each with its own device
+ * worker thread; POSCommunicationPool manages them by company name. getInstance()
+ * returns the pool's default instance for single-terminal applications.
  */
-class POSCommunication : public QObject
+class POSCommunication : public QObject, private POSBackend::Listener
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Connection lifecycle of an instance
+     *
+     * The state is held in an atomic and may be read from any thread.
+     */
+    enum State {
+        Disconnected,  ///< No connection, and none is being attempted
+        Connecting,    ///< A connection attempt started by connect() is running
+        Connected,     ///< The terminal is connected
+        Reconnecting,  ///< The connection was lost and is being re-established
+        Failed         ///< The last attempt failed or reconnection gave up
+    };
+    Q_ENUM(State)
+
     /**
      * @brief Constructor for POSCommunication
      * @param companyName The merchant/company identifier for the POS system
@@ -56,6 +85,17 @@ public:
      * The company name is used for identification with the payment service provider.
      */
     explicit POSCommunication(const QString& companyName, QObject* parent = nullptr);
+
+    /**
+     * @brief Constructor for POSCommunication with an explicit backend
+     * @param companyName The merchant/company identifier for the POS system
+     * @param backend Transport used to reach the terminal
+     * @param parent The parent QObject (for memory management)
+     *
+     * The first constructor uses POSBackend::create(), which honours the
+     * POS_BACKEND environment variable.
+     */
+    POSCommunication(const QString& companyName, std::unique_ptr<POSBackend> backend, QObject* parent = nullptr);
     
     /**
      * @brief Destructor
@@ -65,32 +105,74 @@ public:
     ~POSCommunication();
 
     /**
-     * @brief Returns the singleton instance of POSCommunication
+     * @brief Returns the default instance of POSCommunication
      * @param companyName Optional company name parameter (used only during first initialization)
-     * @return Pointer to the singleton POSCommunication instance
+     * @return Pointer to the default POSCommunication instance, or nullptr once the
+     *         application is quitting
      *
-     * If the instance doesn't exist, it will be created with the provided company name.
-     * Subsequent calls will return the existing instance regardless of the company name parameter.
+     * If the instance doesn't exist, it will be created through POSCommunicationPool
+     * with the provided company name. Subsequent calls will return the existing
+     * instance regardless of the company name parameter.
      */
     static POSCommunication* getInstance(const QString& companyName = QString());
 
+    /**
+     * @brief Maximum number of instances that can be connected at the same time
+     *
+     * Applies to the library backend, whose DLL callbacks cannot carry a
+     * per-connection context pointer and therefore use a fixed slot table.
+     */
+    static constexpr int MaxInstances = 8;
+
+    /**
+     * @brief Returns the company name this instance was created for
+     * @return The merchant/company identifier
+     */
+    QString companyName() const;
+
+    /**
+     * @brief Returns the name of the backend this instance drives
+     * @return The backend name, e.g. "library" or "simulated"
+     */
+    QString backendName() const;
+
+    /**
+     * @brief Checks if the backend has been loaded successfully
+     * @return true if connect() can succeed, false if e.g. the DLL could not be
+     *         loaded or loading has not finished yet
+     */
+    bool isAvailable() const;
+
+    /**
+     * @brief Checks if backend loading has finished and librariesReady was emitted
+     * @return true once librariesReady has been emitted, false before
+     */
+    bool isReady() const;
+
+    /**
+     * @brief Returns the current connection state
+     * @return The current state; safe to call from any thread
+     */
+    State state() const;
+
     /**
      * @brief Checks if the POS system is currently connected to a payment device
-     * @return true if connected, false otherwise
+     * @return true if the state is Connected, false otherwise
      */
     bool isConnected() const;
     
     /**
      * @brief Checks if the POS system is currently attempting to connect
-     * @return true if connecting, false otherwise
+     * @return true if the state is Connecting or Reconnecting, false otherwise
      */
     bool isConnecting() const;
     
     /**
      * @brief Initiates a connection to the payment device
      *
-     * This method starts an asynchronous connection process. Results are reported
-     * through the connectionStatusChanged and deviceStateChanged signals.
+     * This method queues an asynchronous connection process on the device worker
+     * thread. Results are reported through the stateChanged and
+     * deviceStateChanged signals. Does nothing while an attempt is in progress.
      */
     void connect();
     
@@ -98,16 +180,55 @@ public:
      * @brief Terminates the connection to the payment device
      *
      * Releases resources and closes the connection to any active payment device.
+     * Blocks until the device worker has closed the connection.
      */
     void disconnect();
+
+    /**
+     * @brief Terminates the connection without blocking the calling thread
+     * @return Future that finishes once the connection is closed
+     */
+    QFuture<void> disconnectAsync();
     
     /**
      * @brief Reinitializes the connection to the payment device
      *
      * Attempts to re-establish connection with the payment device. Useful when
      * connection states become inconsistent or after a device timeout.
+     * Blocks until the device worker has initiated the reconnection.
      */
     void reconnect();
+
+    /**
+     * @brief Reinitializes the connection without blocking the calling thread
+     * @return Future that finishes once the reconnection has been initiated
+     *
+     * The backend's reconnect call is limited by callTimeout(POSMetrics::Reconnect).
+     */
+    QFuture<void> reconnectAsync();
+
+    /**
+     * @brief Connects and probes the terminal ahead of the first transaction
+     * @return Future holding the active device index reported by the probe
+     *
+     * Call as early as possible, e.g. before any window is built. The
+     * connection is queued behind the background library load, then a cheap
+     * getActiveDeviceIndex() call runs through the DLL once so its code and
+     * crypto state are hot when the first basket or payment arrives. Does not
+     * block; the future fails if the backend is unavailable or the connection
+     * could not be opened.
+     */
+    QFuture<int> warmUp();
+
+    /**
+     * @brief Sets the backoff parameters used for automatic reconnection
+     * @param policy Fast retry delay, growth, jitter and attempt limit
+     *
+     * After a lost connection the first retry happens after policy.fastRetryMs,
+     * later ones back off exponentially until the device is back or
+     * policy.maxAttempts is reached.
+     */
+    void setReconnectPolicy(const ReconnectScheduler::Policy& policy);
     
     /**
      * @brief Gets the index of the currently active payment device
@@ -123,6 +244,13 @@ public:
      * Transmits basket data to the payment device for processing or display.
      */
     int sendBasket(const QString& jsonData);
+
+    /**
+     * @brief Sends a typed basket to the payment device
+     * @param basket The basket to send
+     * @return Result code indicating success (0) or failure (error code)
+     */
+    int sendBasket(const Basket& basket);
     
     /**
      * @brief Initiates a payment transaction
@@ -133,20 +261,293 @@ public:
      * reported asynchronously through callback signals.
      */
     int sendPayment(const QString& jsonData);
+
+    /**
+     * @brief Initiates a payment transaction at most once per idempotency key
+     * @param jsonData JSON-formatted string containing payment details (amount, currency, etc.)
+     * @param idempotencyKey Identifies the payment; empty to send unconditionally
+     * @return Result code indicating success (0) or failure (error code)
+     *
+     * Blocking counterpart of sendPaymentAsync(const QString&, const QString&).
+     * On the device worker thread, where a queued original could never be
+     * waited for, the key is ignored.
+     */
+    int sendPayment(const QString& jsonData, const QString& idempotencyKey);
     
     /**
      * @brief Retrieves fiscal information from the connected device
      * @return JSON-formatted string containing fiscal details
      *
      * Gets fiscal information such as transaction history, device status, etc.
+     * Answered from the cache without touching the terminal while a result
+     * younger than fiscalInfoTtl() is available.
      */
     QString getFiscalInfo();
 
+    /**
+     * @brief Retrieves fiscal information parsed into a JSON object
+     * @return The fiscal details, or an empty object if they are not valid JSON
+     *
+     * Uses the same cache as getFiscalInfo(); the document is parsed once per
+     * cached result, not once per caller.
+     */
+    QJsonObject getFiscalInfoObject();
+
+    /**
+     * @brief Sets how long fiscal information is served from the cache
+     * @param ms Time to live in milliseconds; 0 disables the cache
+     *
+     * The cache is also invalidated whenever a basket or payment is sent, a
+     * payment outcome arrives (see setOutcomeFilter()), the device state
+     * changes, or the connection is closed.
+     */
+    void setFiscalInfoTtl(int ms);
+
+    /**
+     * @brief Returns how long fiscal information is served from the cache
+     * @return Time to live in milliseconds
+     */
+    int fiscalInfoTtl() const;
+
+    /**
+     * @brief Sets which serial-in events carry a payment's outcome
+     * @param filter Returns true for outcome events, usually the filter given to
+     *               TransactionJournal::setOutcomeFilter(); empty for none
+     *
+     * An outcome invalidates the cached fiscal info, since it changes the
+     * terminal's totals. Other serial-in traffic, such as barcode or keypad
+     * input, leaves the cache alone; without a filter the TTL alone bounds
+     * how long a payment's outcome can go unseen. Safe to call from any thread.
+     */
+    void setOutcomeFilter(TransactionJournal::OutcomeFilter filter);
+
+    /**
+     * @brief Sets how long a backend call may take before it is abandoned
+     * @param operation SendBasket, SendPayment or FiscalInfo
+     * @param ms Deadline in milliseconds; 0 lets the call run indefinitely
+     *
+     * A call still running at its deadline fails with DeviceException::Timeout,
+     * as do the requests queued behind it, and callTimedOut is emitted. The
+     * hung DLL call is left on its own thread while the connection is
+     * recreated on a new device worker thread. The deadline of a batch is the
+     * SendBasket deadline times the number of baskets.
+     */
+    void setCallTimeout(POSMetrics::Operation operation, int ms);
+
+    /**
+     * @brief Returns how long a backend call may take
+     * @param operation The call
+     * @return Deadline in milliseconds, 0 if unlimited
+     */
+    int callTimeout(POSMetrics::Operation operation) const;
+
+    /**
+     * @brief Discards cached fiscal information
+     *
+     * The next query goes to the terminal. Safe to call from any thread.
+     */
+    void invalidateFiscalInfo();
+
+    /**
+     * @brief Handler for serial input registered with subscribeSerialIn()
+     *
+     * The value is only valid for the duration of the call.
+     */
+    using SerialInHandler = std::function<void(int typeCode, QStringView value)>;
+
+    /**
+     * @brief Registers a handler that receives serial input directly
+     * @param handler Called for every serial-in event
+     * @return Subscription ID for unsubscribeSerialIn()
+     *
+     * The handler runs on the backend's callback thread before the
+     * serialInReceived signal is emitted, without copying the payload or
+     * going through the event loop. It must return quickly, must not throw
+     * and must not call back into this instance synchronously; hand work
+     * that takes longer to another thread (e.g. through a BoundedMpscQueue).
+     * Safe to call from any thread.
+     */
+    int subscribeSerialIn(SerialInHandler handler);
+
+    /**
+     * @brief Removes a handler registered with subscribeSerialIn()
+     * @param id Subscription ID returned by subscribeSerialIn()
+     *
+     * An event being delivered while this is called may still reach the
+     * handler; later events do not. Safe to call from any thread.
+     */
+    void unsubscribeSerialIn(int id);
+
+    /**
+     * @brief Journals every basket and payment sent through this instance
+     * @param journal Open journal, or nullptr to stop journaling; not owned
+     *
+     * Each command is journaled before the DLL call, followed by its result
+     * and the serial-in event that completes it. Safe to call from any thread;
+     * the journal must outlive this instance or be detached first.
+     */
+    void setJournal(TransactionJournal* journal);
+
+    /**
+     * @brief Records all traffic of this instance for later replay
+     * @param capture Open capture, or nullptr to stop recording; not owned
+     *
+     * Every basket, payment and fiscal info query that reaches the terminal
+     * and every serial-in and device state callback is recorded with its
+     * time. Safe to call from any thread; the capture must outlive this
+     * instance or be detached first.
+     */
+    void setCapture(TrafficCapture* capture);
+
+    /**
+     * @brief Sends basket information without blocking the calling thread
+     * @param jsonData JSON-formatted string containing basket details (items, prices, etc.)
+     * @return Future holding the result code once the terminal has answered
+     *
+     * The request runs on the device worker thread. Completion is also reported
+     * through the basketCompleted or requestFailed signals.
+     */
+    QFuture<int> sendBasketAsync(const QString& jsonData);
+
+    /**
+     * @brief Sends a typed basket without blocking the calling thread
+     * @param basket The basket to send; may be modified as soon as this returns
+     * @return Future holding the result code once the terminal has answered
+     */
+    QFuture<int> sendBasketAsync(const Basket& basket);
+
+    /**
+     * @brief Outcome of one basket in a batch
+     */
+    struct BatchResult
+    {
+        int result = 0;  ///< Result code from the terminal, valid if ok()
+        QString error;   ///< Error description, null on success
+
+        bool ok() const { return error.isNull(); }
+    };
+
+    /**
+     * @brief Sends many typed baskets in order as one device command
+     * @param baskets The baskets to send
+     * @return One result per basket, in the same order
+     * @throws DeviceException if the command queue is full or the worker is stopped
+     *
+     * Baskets are serialized on the calling thread while the device worker
+     * sends the previous one, so the batch takes as long as the terminal
+     * needs. A failed basket does not stop the batch. Other requests queue
+     * behind the whole batch; the per-basket signals are not emitted.
+     */
+    QVector<BatchResult> sendBaskets(const QVector<Basket>& baskets);
+
+    /**
+     * @brief Sends many baskets in order as one device command
+     * @param jsonData JSON-formatted basket details, one document per basket
+     * @return One result per basket, in the same order
+     * @throws DeviceException if the command queue is full or the worker is stopped
+     */
+    QVector<BatchResult> sendBaskets(const QStringList& jsonData);
+
+    /**
+     * @brief Sends many baskets in order without blocking the calling thread
+     * @param jsonData JSON-formatted basket details, one document per basket
+     * @return Future holding one result per basket once the batch has run
+     */
+    QFuture<QVector<BatchResult>> sendBasketsAsync(const QStringList& jsonData);
+
+    /**
+     * @brief Initiates a payment transaction without blocking the calling thread
+     * @param jsonData JSON-formatted string containing payment details (amount, currency, etc.)
+     * @return Future holding the result code once the terminal has answered
+     *
+     * The request runs on the device worker thread. Completion is also reported
+     * through the paymentCompleted or requestFailed signals.
+     */
+    QFuture<int> sendPaymentAsync(const QString& jsonData);
+
+    /**
+     * @brief Initiates a payment transaction at most once per idempotency key
+     * @param jsonData JSON-formatted string containing payment details (amount, currency, etc.)
+     * @param idempotencyKey Identifies the payment, e.g. a UUID per checkout; empty to send unconditionally
+     * @return Future holding the result code once the terminal has answered
+     *
+     * A request whose key was used within paymentKeyTtl() does not reach the
+     * terminal again: it receives the future of the original, whether that is
+     * still queued, running or finished, and emits no signals of its own.
+     * A failure is shared too, since a payment that timed out or failed in the
+     * DLL may still have been charged. Only an original that failed before
+     * reaching the terminal (not connected, queue full, worker stopped) lets
+     * the key be used again.
+     */
+    QFuture<int> sendPaymentAsync(const QString& jsonData, const QString& idempotencyKey);
+
+    /**
+     * @brief Sets how long idempotency keys of payments are remembered
+     * @param ms Time to live in milliseconds, counted from the original request
+     *
+     * Keys of payments still in flight are kept until they finish.
+     */
+    void setPaymentKeyTtl(int ms);
+
+    /**
+     * @brief Returns how long idempotency keys of payments are remembered
+     * @return Time to live in milliseconds
+     */
+    int paymentKeyTtl() const;
+
+    /**
+     * @brief Retrieves fiscal information without blocking the calling thread
+     * @return Future holding the JSON-formatted fiscal details
+     *
+     * The request runs on the device worker thread. Completion is also reported
+     * through the fiscalInfoReady or requestFailed signals. A cache hit returns
+     * a finished future and still emits fiscalInfoReady.
+     */
+    QFuture<QString> getFiscalInfoAsync();
+
+    /**
+     * @brief Sets the maximum number of device commands waiting to run
+     * @param depth Queue depth limit (clamped to DeviceWorker::MaxQueueCapacity)
+     *
+     * Once the limit is reached further submissions fail immediately with
+     * DeviceException::QueueFull instead of blocking the caller.
+     */
+    void setMaxQueueDepth(int depth);
+
+    /**
+     * @brief Returns metrics of the device command queue
+     * @return Current depth, peak depth and accepted/rejected counters
+     */
+    DeviceWorker::QueueStats queueStats() const;
+
+    /**
+     * @brief Returns latency and event statistics of this terminal
+     * @return Per-operation call counts, failures and latency percentiles,
+     *         and counts of callbacks, reconnect attempts and lost connections
+     *
+     * Every backend call is timed, so the figures show how slow the terminal
+     * itself is. Safe to call from any thread.
+     */
+    POSMetrics::Snapshot metricsSnapshot() const;
+
+    /**
+     * @brief Periodically logs the metrics as JSON to the pos.metrics category
+     * @param ms Interval in milliseconds; 0 stops the dumps
+     *
+     * Each dump is one compact JSON line containing the terminal name, the
+     * metrics snapshot and the command queue statistics.
+     */
+    void setMetricsDumpInterval(int ms);
+
 signals:
     /**
      * @brief Signal emitted when data is received from the device
      * @param typeCode Code indicating the type of received data
      * @param value The data value as a string
+     *
+     * Emitted on the backend's callback thread; receivers in other threads get a
+     * queued call that shares the same string buffer. Latency-sensitive
+     * consumers can use subscribeSerialIn() instead.
      */
     void serialInReceived(int typeCode, const QString& value);
     
@@ -154,86 +555,320 @@ signals:
      * @brief Signal emitted when device connection state changes
      * @param isConnected Whether the device is now connected
      * @param deviceId Identifier of the affected device
+     *
+     * State changes are coalesced: within each 100 ms window only the latest
+     * state per device is delivered.
      */
     void deviceStateChanged(bool isConnected, const QString& deviceId);
     
     /**
      * @brief Signal for debug and information logging
      * @param message The log message text
+     *
+     * Only carries messages whose pos.* logging category is enabled for their level.
      */
     void logMessage(const QString& message);
     
     /**
      * @brief Signal emitted when the overall connection status changes
      * @param isConnected Whether the system is now connected to any device
+     *
+     * Device state callbacks only trigger this signal when the coalesced
+     * state differs from the previously reported one.
      */
     void connectionStatusChanged(bool isConnected);
 
+    /**
+     * @brief Signal emitted when the connection state changes
+     * @param state The new state
+     *
+     * Always emitted on the instance's thread. Transitions that happen in
+     * quick succession may be reported once with the latest state.
+     */
+    void stateChanged(POSCommunication::State state);
+
+    /**
+     * @brief Signal emitted once the backend has finished loading
+     * @param available Whether the backend can be used
+     *
+     * Loading happens on the device worker thread in the background, so the
+     * user interface can be shown before the DLLs are in memory.
+     */
+    void librariesReady(bool available);
+
+    /**
+     * @brief Signal emitted when an asynchronous basket send has completed
+     * @param result Result code returned by the terminal
+     */
+    void basketCompleted(int result);
+
+    /**
+     * @brief Signal emitted when an asynchronous payment send has completed
+     * @param result Result code returned by the terminal
+     */
+    void paymentCompleted(int result);
+
+    /**
+     * @brief Signal emitted when asynchronously requested fiscal information is available
+     * @param info JSON-formatted fiscal details
+     */
+    void fiscalInfoReady(const QString& info);
+
+    /**
+     * @brief Signal emitted when an asynchronous request has failed
+     * @param request Name of the failed request (e.g. "sendBasket")
+     * @param error Description of the failure
+     */
+    void requestFailed(const QString& request, const QString& error);
+
+    /**
+     * @brief Signal emitted when a backend call has exceeded its deadline
+     *
+     * The waiting callers have already received DeviceException::Timeout and
+     * the connection is being recreated. A late result of the hung call is
+     * still delivered through basketCompleted or paymentCompleted.
+     */
+    void callTimedOut();
+
 private:
-#ifdef Q_OS_WIN
-    /**
-     * @brief Windows-specific function pointer types for dynamic library loading
-     *
-     * These typedefs define the function signatures used to interface with
-     * the native Windows libraries that provide the actual device communication.
-     */
-    typedef void* (__cdecl* CreateCommunication)(const wchar_t*);
-    typedef void (__cdecl* DeleteCommunication)(void*);
-    typedef void (__cdecl* Reconnect)(void*);
-    typedef int (__cdecl* GetActiveDeviceIndex)(void*);
-    typedef int (__cdecl* SendBasket)(void*, const wchar_t*);
-    typedef int (__cdecl* SendPayment)(void*, const wchar_t*);
-    typedef BSTR (__cdecl* GetFiscalInfo)(void*);
-    typedef void (__stdcall* SerialInCallback)(int, BSTR);
-    typedef void (__stdcall* DeviceStateCallback)(bool, BSTR);
-    typedef void (__cdecl* SetSerialInCallback)(void*, SerialInCallback);
-    typedef void (__cdecl* SetDeviceStateCallback)(void*, DeviceStateCallback);
-
-    // DLL function pointers
-    CreateCommunication m_createCommunication;
-    DeleteCommunication m_deleteCommunication;
-    Reconnect m_reconnect;
-    GetActiveDeviceIndex m_getActiveDeviceIndex;
-    SendBasket m_sendBasket;
-    SendPayment m_sendPayment;
-    GetFiscalInfo m_getFiscalInfo;
-    SetSerialInCallback m_setSerialInCallback;
-    SetDeviceStateCallback m_setDeviceStateCallback;
-
-    // Static callback handlers
-    static void __stdcall serialInCallbackHandler(int typeCode, BSTR value);
-    static void __stdcall deviceStateCallbackHandler(bool isConnected, BSTR deviceId);
-#endif
-
-    /**
-     * @brief Loads required DLL libraries for device communication
-     * @return true if all libraries were loaded successfully, false otherwise
-     */
-    bool loadLibraries();
-    
+    // POSBackend::Listener; called by the backend on any thread
+    void onSerialIn(int typeCode, QStringView value) override;
+    void onDeviceState(bool isConnected, QStringView deviceId) override;
+    void onLog(const QLoggingCategory& category, QtMsgType level, const QString& message) override;
+
     /**
-     * @brief Initializes function pointers from loaded libraries
+     * @brief Emits the latest coalesced state of every device that changed
      *
-     * Maps function pointers to exported functions in the loaded DLLs.
+     * Runs on the instance's thread at most once per StateCoalesceIntervalMs.
      */
-    void initializeFunctions();
-    
+    void flushDeviceStates();
+
+    /**
+     * @brief Delivers a log message whose category and level are enabled
+     * @param category The logging category of the message
+     * @param level The severity of the message
+     * @param message The formatted message text
+     *
+     * Used through the POS_LOG macro so that disabled messages are never formatted.
+     */
+    void log(const QLoggingCategory& category, QtMsgType level, const QString& message);
+
+    /**
+     * @brief Checks if anything is connected to the logMessage signal
+     * @return true if log lines would be delivered, false otherwise
+     */
+    bool isLogEnabled() const;
+
+    /**
+     * @brief Checks if anything is connected to the serialInReceived signal
+     * @return true if serialInReceived has at least one receiver
+     */
+    bool isSerialInConnected() const;
+
     /**
      * @brief Performs actual connection to the payment device
      *
-     * Internal method that implements the connection logic.
+     * Internal method that implements the connection logic. Runs on the device worker thread.
      */
     void doConnect();
 
+    /**
+     * @brief Asks the backend to re-establish an existing connection (device worker thread only)
+     */
+    void doReconnect();
+
+    /**
+     * @brief Stops reconnecting and closes the connection (device worker thread only)
+     */
+    void doDisconnect();
+
+    /**
+     * @brief Re-establishes an open connection or initiates a new one (device worker thread only)
+     */
+    void doReconnectOrConnect();
+
+    /**
+     * @brief Creates the reconnect timer on the current device worker thread
+     */
+    void createReconnectScheduler();
+
+    /**
+     * @brief Replaces the device worker after a hung call (watchdog thread)
+     */
+    void onCallTimedOut();
+
+    /**
+     * @brief Returns the deadline of a batch of baskets
+     * @param count Number of baskets
+     * @return Deadline in milliseconds, 0 if unlimited
+     */
+    int batchTimeout(int count) const;
+
+    /**
+     * @brief Performs one scheduled reconnection attempt (device worker thread only)
+     * @param attempt One-based number of the attempt
+     */
+    void performReconnectAttempt(int attempt);
+
+    /**
+     * @brief Sends basket data to the device (device worker thread only)
+     * @param jsonData JSON-formatted basket details
+     * @return Result code from the backend
+     */
+    int doSendBasket(const QString& jsonData);
+
+    /**
+     * @brief Sends payment data to the device (device worker thread only)
+     * @param jsonData JSON-formatted payment details
+     * @param dispatched Set once the payment is handed to the backend, may be nullptr
+     * @return Result code from the backend
+     */
+    int doSendPayment(const QString& jsonData, std::atomic<bool>* dispatched = nullptr);
+
+    /**
+     * @brief Drops expired idempotency keys of finished payments (m_paymentKeyMutex held)
+     */
+    void prunePaymentKeysLocked();
+
+    /**
+     * @brief Sends a batch of baskets to the device (device worker thread only)
+     * @param count Number of baskets
+     * @param document Returns the JSON of basket i, waiting for it if necessary
+     * @return One result per basket
+     */
+    QVector<BatchResult> doSendBaskets(int count, const std::function<QString(int index)>& document);
+
+    /**
+     * @brief Queries fiscal information from the device (device worker thread only)
+     * @return JSON-formatted fiscal details
+     */
+    QString doGetFiscalInfo();
+
+    /**
+     * @brief Runs a basket or payment call and journals it (device worker thread only)
+     * @param command Kind of command, for the journal
+     * @param jsonData JSON sent to the terminal
+     * @param call Performs the DLL call
+     * @return Result code from the backend
+     */
+    int journaled(TransactionJournal::Command command, const QString& jsonData, const std::function<int()>& call);
+
+    /**
+     * @brief Returns cached fiscal information or queries and caches it (device worker thread only)
+     * @return JSON-formatted fiscal details
+     */
+    QString fetchFiscalInfo();
+
+    /**
+     * @brief Looks up unexpired fiscal information in the cache (any thread)
+     * @param info Receives the cached details on a hit
+     * @return true on a cache hit, false otherwise
+     */
+    bool cachedFiscalInfo(QString& info) const;
+
+    /**
+     * @brief Stores a new connection state and schedules its publication (any thread)
+     * @param state The new state
+     */
+    void setState(State state);
+
+    /**
+     * @brief Emits stateChanged if the state differs from the last published one
+     *
+     * Runs on the instance's thread.
+     */
+    void publishState();
+
+    /**
+     * @brief Logs the current metrics as one JSON line
+     */
+    void dumpMetrics();
+
     // Member variables
     QString m_companyName;           ///< Company identifier for POS system
-    QList<QLibrary*> m_libraries;    ///< List of dynamically loaded libraries
-    void* m_connection;              ///< Pointer to the native connection object
-    bool m_isConnected;              ///< Current connection state
-    bool m_isConnecting;             ///< Whether connection is in progress
+    std::unique_ptr<POSBackend> m_backend; ///< Transport to the terminal (device worker only)
+    std::atomic<bool> m_backendAvailable; ///< Whether the backend loaded successfully
+    bool m_librariesReady;           ///< Whether librariesReady was emitted (owner thread only)
+    std::atomic<State> m_state;      ///< Current connection state
+    State m_publishedState;          ///< State reported by the last stateChanged (owner thread only)
+    DeviceWorker m_worker;           ///< Persistent thread that executes every backend call
+    POSMetrics m_metrics;            ///< Latency histograms and event counters
+    QTimer* m_metricsDumpTimer;      ///< Drives setMetricsDumpInterval(), created on first use
+
+    /**
+     * @brief Latest state reported for one device within the coalescing window
+     */
+    struct PendingDeviceState
+    {
+        bool isConnected = false;  ///< Most recent connection state
+        int changes = 0;           ///< Number of callbacks folded into this state
+    };
+
+    static constexpr int StateCoalesceIntervalMs = 100;  ///< Window for folding device state flaps
+
+    QMutex m_deviceStateMutex;                               ///< Guards m_pendingDeviceStates
+    QHash<QString, PendingDeviceState> m_pendingDeviceStates; ///< Latest state per device ID
+    std::atomic<bool> m_deviceStateFlushScheduled;          ///< Whether a flush is pending
+    ReconnectScheduler* m_reconnectScheduler;               ///< Backoff timer (device worker thread only)
+    QMutex m_reconnectPolicyMutex;                          ///< Guards m_reconnectPolicy
+    ReconnectScheduler::Policy m_reconnectPolicy;           ///< Policy of every scheduler, also those created after a restart
+
+    /**
+     * @brief Handler registered with subscribeSerialIn()
+     */
+    struct SerialInSubscriber
+    {
+        int id;                   ///< Subscription ID
+        SerialInHandler handler;  ///< Callback
+    };
+    using SerialInSubscribers = std::vector<SerialInSubscriber>;
+
+    QMutex m_subscriberMutex;                                        ///< Serializes changes to the subscriber list
+    std::shared_ptr<const SerialInSubscribers> m_serialInSubscribers; ///< Immutable snapshot; read with std::atomic_load
+    int m_nextSubscriberId;                                          ///< ID for the next subscription (guarded by m_subscriberMutex)
+
+    static constexpr int DefaultFiscalInfoTtlMs = 5000;  ///< Default lifetime of cached fiscal info
+
+    mutable QMutex m_fiscalInfoMutex;          ///< Guards the fiscal info cache below
+    QString m_fiscalInfo;                      ///< Cached fiscal info, valid until m_fiscalInfoExpiry
+    QJsonObject m_fiscalInfoObject;            ///< Parsed m_fiscalInfo, valid if m_fiscalInfoParsed
+    bool m_fiscalInfoParsed;                   ///< Whether m_fiscalInfoObject is up to date
+    QDeadlineTimer m_fiscalInfoExpiry;         ///< Expiry of the cached fiscal info
+    quint64 m_fiscalInfoGeneration;            ///< Incremented by every invalidation
+    std::atomic<int> m_fiscalInfoTtlMs;        ///< Lifetime of cached fiscal info (0 = no caching)
+    std::shared_ptr<const TransactionJournal::OutcomeFilter> m_outcomeFilter; ///< Selects outcome events; read with std::atomic_load
+
+    static constexpr int DefaultCallTimeoutMs = 30000;      ///< Default deadline of basket and fiscal info calls
+    static constexpr int WarmUpProbeTimeoutMs = 10000;      ///< Deadline of the warm-up probe
+    static constexpr int OrphanPollMs = 10;                 ///< Interval at which the destructor checks stranded threads
+    static constexpr int DefaultPaymentTimeoutMs = 300000;  ///< Default deadline of payments, which wait for the customer
+
+    std::atomic<int> m_callTimeoutMs[POSMetrics::OperationCount];  ///< Deadline per operation (0 = unlimited)
+
+    /**
+     * @brief Payment remembered under its idempotency key
+     */
+    struct PaymentRecord
+    {
+        QFuture<int> future;                            ///< Result shared with every duplicate
+        std::shared_ptr<std::atomic<bool>> dispatched;  ///< Whether the payment reached the backend
+        QDeadlineTimer expiry;                          ///< When the key may be forgotten
+        quint64 sequence = 0;                           ///< Matches the record to its m_paymentKeyOrder entry
+    };
+
+    static constexpr int DefaultPaymentKeyTtlMs = 600000;  ///< Default lifetime of payment idempotency keys
+
+    QMutex m_paymentKeyMutex;                          ///< Guards the idempotency table below
+    QHash<QString, PaymentRecord> m_paymentKeys;       ///< Recent payments by idempotency key
+    QQueue<QPair<quint64, QString>> m_paymentKeyOrder; ///< Sequence and key in insertion order, oldest first
+    quint64 m_paymentKeySequence;                      ///< Sequence of the last inserted record
+    std::atomic<int> m_paymentKeyTtlMs;                ///< Lifetime of idempotency keys
+
+    std::atomic<TransactionJournal*> m_journal;  ///< Journal set by setJournal(), nullptr if none
+    std::atomic<TrafficCapture*> m_capture;      ///< Capture set by setCapture(), nullptr if none
     
-    // Singleton instance
-    static POSCommunication* m_instance;  ///< Static pointer to singleton instance
+    // Default instance returned by getInstance()
+    static POSCommunication* m_instance;  ///< Static pointer to the default instance
 };
 
 #endif // POSCOMMUNICATION_H
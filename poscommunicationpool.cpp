@@ -0,0 +1,205 @@
+/**
+ * @file poscommunicationpool.cpp
+ * @brief Implementation of the POSCommunicationPool class.
+ *
+ * The pool keeps one POSCommunication per terminal. Instances are parented to
+ * the pool, and each one claims its own callback slot, so DLL callbacks reach
+ * the terminal they belong to. Calls from other threads hand creation and
+ * destruction to the pool's thread, which must own its children.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "poscommunicationpool.h"
+#include "poscommunication.h"
+#include <QCoreApplication>
+#include <QThread>
+
+namespace {
+
+QBasicMutex s_instanceMutex;                 ///< Guards s_instance and s_instanceTornDown
+POSCommunicationPool* s_instance = nullptr;  ///< The process-wide pool, nullptr until first use
+bool s_instanceTornDown = false;             ///< Set once the application started to quit
+
+} // namespace
+
+/**
+ * @brief Constructor for the POSCommunicationPool class.
+ *
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+POSCommunicationPool::POSCommunicationPool(QObject* parent)
+    : QObject(parent)
+{
+}
+
+/**
+ * @brief Destructor for the POSCommunicationPool class.
+ *
+ * Destroys all terminals; each POSCommunication disconnects in its destructor.
+ */
+POSCommunicationPool::~POSCommunicationPool()
+{
+    QMutexLocker locker(&m_mutex);
+    qDeleteAll(m_terminals);
+    m_terminals.clear();
+}
+
+/**
+ * @brief Returns the process-wide pool.
+ *
+ * The pool is created on first use and moved to the application's thread,
+ * whichever thread asks first, so its terminals always live on the main
+ * thread. It is destroyed on QCoreApplication::aboutToQuit, while the event
+ * loop and the worker threads can still shut down cleanly, and not recreated
+ * afterwards.
+ *
+ * @return Pointer to the shared pool, or nullptr once the application is quitting
+ */
+POSCommunicationPool* POSCommunicationPool::instance()
+{
+    QMutexLocker locker(&s_instanceMutex);
+    if (s_instance || s_instanceTornDown) {
+        return s_instance;
+    }
+
+    QCoreApplication* app = QCoreApplication::instance();
+    Q_ASSERT_X(app, "POSCommunicationPool::instance", "a QCoreApplication must exist");
+    s_instance = new POSCommunicationPool;
+    if (app) {
+        // A parentless object may be pushed from its own thread to any other
+        s_instance->moveToThread(app->thread());
+        QObject::connect(app, &QCoreApplication::aboutToQuit, s_instance, []() {
+            QMutexLocker teardownLocker(&s_instanceMutex);
+            POSCommunicationPool* pool = s_instance;
+            s_instance = nullptr;
+            s_instanceTornDown = true;
+            teardownLocker.unlock();
+            delete pool;
+        });
+    }
+    return s_instance;
+}
+
+/**
+ * @brief Returns the terminal for a company name, creating it if needed.
+ *
+ * @param companyName The merchant/company identifier of the terminal
+ * @return Pointer to the terminal's POSCommunication instance
+ */
+POSCommunication* POSCommunicationPool::terminal(const QString& companyName)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_terminals.constFind(companyName);
+        if (it != m_terminals.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // A QObject belongs to the thread that created it, so construct on the pool's
+    if (QThread::currentThread() == thread()) {
+        return create(companyName);
+    }
+    POSCommunication* terminal = nullptr;
+    QMetaObject::invokeMethod(this, [this, &companyName, &terminal]() {
+        terminal = create(companyName);
+    }, Qt::BlockingQueuedConnection);
+    return terminal;
+}
+
+/**
+ * @brief Creates and registers a terminal on the pool's thread.
+ *
+ * @param companyName The merchant/company identifier of the terminal
+ * @return The new terminal, or the existing one if a call queued earlier created it
+ */
+POSCommunication* POSCommunicationPool::create(const QString& companyName)
+{
+    // Only the pool's thread inserts, so nothing can be added between the check and the insert
+    if (POSCommunication* existing = find(companyName)) {
+        return existing;
+    }
+
+    // Construct outside the lock; loading libraries may take a while
+    POSCommunication* terminal = new POSCommunication(companyName, this);
+
+    QMutexLocker locker(&m_mutex);
+    m_terminals.insert(companyName, terminal);
+    locker.unlock();
+
+    emit terminalAdded(companyName);
+    return terminal;
+}
+
+/**
+ * @brief Returns an existing terminal without creating one.
+ *
+ * @param companyName The merchant/company identifier of the terminal
+ * @return Pointer to the terminal, or nullptr if it does not exist
+ */
+POSCommunication* POSCommunicationPool::find(const QString& companyName) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_terminals.value(companyName, nullptr);
+}
+
+/**
+ * @brief Disconnects and destroys a terminal.
+ *
+ * @param companyName The merchant/company identifier of the terminal
+ * @return true if the terminal existed, false otherwise
+ */
+bool POSCommunicationPool::release(const QString& companyName)
+{
+    QMutexLocker locker(&m_mutex);
+    POSCommunication* terminal = m_terminals.take(companyName);
+    locker.unlock();
+
+    if (!terminal) {
+        return false;
+    }
+
+    if (QThread::currentThread() == thread()) {
+        destroy(companyName, terminal);
+    } else {
+        QMetaObject::invokeMethod(this, [this, &companyName, terminal]() {
+            destroy(companyName, terminal);
+        }, Qt::BlockingQueuedConnection);
+    }
+    return true;
+}
+
+/**
+ * @brief Destroys a terminal taken out of the pool on the pool's thread.
+ *
+ * @param companyName The key of the terminal
+ * @param terminal The terminal
+ */
+void POSCommunicationPool::destroy(const QString& companyName, POSCommunication* terminal)
+{
+    delete terminal;
+    emit terminalRemoved(companyName);
+}
+
+/**
+ * @brief Returns the company names of all terminals in the pool.
+ *
+ * @return List of terminal keys
+ */
+QStringList POSCommunicationPool::terminals() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_terminals.keys();
+}
+
+/**
+ * @brief Returns the number of terminals in the pool.
+ *
+ * @return Terminal count
+ */
+int POSCommunicationPool::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_terminals.size();
+}
@@ -0,0 +1,133 @@
+#ifndef POSCOMMUNICATIONPOOL_H
+#define POSCOMMUNICATIONPOOL_H
+
+/**
+ * @file poscommunicationpool.h
+ * @brief Registry of POSCommunication instances for multi-terminal hosts
+ *
+ * This header declares the POSCommunicationPool class which lets a single
+ * process drive several payment terminals at once. Each terminal gets its own
+ * POSCommunication instance with its own native connection handle and device
+ * worker thread, so terminals do not wait on each other.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QMutex>
+
+class POSCommunication;
+
+/**
+ * @class POSCommunicationPool
+ * @brief Creates and owns one POSCommunication instance per terminal
+ *
+ * Terminals are keyed by the company name passed to createCommunication. The
+ * pool owns every instance it creates; release() disconnects and destroys one.
+ * At most POSCommunication::MaxInstances terminals can be connected at once.
+ *
+ * Thread-safe. Terminals are always created and destroyed on the pool's
+ * thread, which owns them: terminal() and release() called from another
+ * thread block until the pool's thread has done so, which requires that
+ * thread to run an event loop and not to wait for the caller.
+ */
+class POSCommunicationPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructor for POSCommunicationPool
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit POSCommunicationPool(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor
+     *
+     * Disconnects and destroys all terminals owned by the pool.
+     */
+    ~POSCommunicationPool();
+
+    /**
+     * @brief Returns the process-wide pool
+     * @return Pointer to the shared pool, created on first use; nullptr once
+     *         the application is quitting
+     *
+     * Requires a QCoreApplication. The pool lives on the application's thread
+     * whichever thread calls this first, and is destroyed together with its
+     * terminals on QCoreApplication::aboutToQuit.
+     */
+    static POSCommunicationPool* instance();
+
+    /**
+     * @brief Returns the terminal for a company name, creating it if needed
+     * @param companyName The merchant/company identifier of the terminal
+     * @return Pointer to the terminal's POSCommunication instance
+     *
+     * A new terminal is created on the pool's thread, see the class description.
+     */
+    POSCommunication* terminal(const QString& companyName);
+
+    /**
+     * @brief Returns an existing terminal without creating one
+     * @param companyName The merchant/company identifier of the terminal
+     * @return Pointer to the terminal, or nullptr if it does not exist
+     */
+    POSCommunication* find(const QString& companyName) const;
+
+    /**
+     * @brief Disconnects and destroys a terminal
+     * @param companyName The merchant/company identifier of the terminal
+     * @return true if the terminal existed, false otherwise
+     */
+    bool release(const QString& companyName);
+
+    /**
+     * @brief Returns the company names of all terminals in the pool
+     * @return List of terminal keys
+     */
+    QStringList terminals() const;
+
+    /**
+     * @brief Returns the number of terminals in the pool
+     * @return Terminal count
+     */
+    int count() const;
+
+signals:
+    /**
+     * @brief Signal emitted when a terminal has been created
+     * @param companyName The key of the new terminal
+     */
+    void terminalAdded(const QString& companyName);
+
+    /**
+     * @brief Signal emitted when a terminal has been destroyed
+     * @param companyName The key of the removed terminal
+     */
+    void terminalRemoved(const QString& companyName);
+
+private:
+    /**
+     * @brief Creates and registers a terminal (pool thread only)
+     * @param companyName The merchant/company identifier of the terminal
+     * @return The new terminal, or the existing one if a call queued earlier created it
+     */
+    POSCommunication* create(const QString& companyName);
+
+    /**
+     * @brief Destroys a terminal taken out of the pool (pool thread only)
+     * @param companyName The key of the terminal
+     * @param terminal The terminal
+     */
+    void destroy(const QString& companyName, POSCommunication* terminal);
+
+    mutable QMutex m_mutex;                        ///< Guards m_terminals
+    QMap<QString, POSCommunication*> m_terminals;  ///< Terminals keyed by company name
+};
+
+#endif // POSCOMMUNICATIONPOOL_H
@@ -0,0 +1,20 @@
+/**
+ * @file poslogging.cpp
+ * @brief Definitions of the POS communication logging categories.
+ *
+ * Per-event callback traffic is disabled below warning level by default so the
+ * hot callback paths skip message formatting entirely in production.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "poslogging.h"
+
+Q_LOGGING_CATEGORY(lcPosLibrary, "pos.library", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosConnection, "pos.connection", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosCallback, "pos.callback", QtWarningMsg)
+Q_LOGGING_CATEGORY(lcPosRequest, "pos.request", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosMetrics, "pos.metrics", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosJournal, "pos.journal", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosCapture, "pos.capture", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcPosThread, "pos.thread", QtInfoMsg)
@@ -0,0 +1,54 @@
+#ifndef POSLOGGING_H
+#define POSLOGGING_H
+
+/**
+ * @file poslogging.h
+ * @brief Logging categories and the lazy POS_LOG macro
+ *
+ * This header declares the QLoggingCategory instances used by the POS
+ * communication layer. Levels can be changed at runtime through the standard
+ * Qt mechanisms, e.g. QT_LOGGING_RULES="pos.callback.debug=true".
+ *
+ * Categories and their default minimum level:
+ * - pos.library     (info)    DLL loading and symbol resolution
+ * - pos.connection  (info)    Connect, disconnect, reconnect and device state
+ * - pos.callback    (warning) Per-event serial-in traffic from the terminal
+ * - pos.request     (info)    Basket, payment and fiscal info requests
+ * - pos.metrics     (info)    Periodic metrics dumps (see POSCommunication::setMetricsDumpInterval)
+ * - pos.journal     (info)    Transaction journal recovery and I/O errors
+ * - pos.capture     (info)    Traffic capture files and I/O errors
+ * - pos.thread      (info)    Thread policies that could not be applied (see ThreadPolicy)
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(lcPosLibrary)
+Q_DECLARE_LOGGING_CATEGORY(lcPosConnection)
+Q_DECLARE_LOGGING_CATEGORY(lcPosCallback)
+Q_DECLARE_LOGGING_CATEGORY(lcPosRequest)
+Q_DECLARE_LOGGING_CATEGORY(lcPosMetrics)
+Q_DECLARE_LOGGING_CATEGORY(lcPosJournal)
+Q_DECLARE_LOGGING_CATEGORY(lcPosCapture)
+Q_DECLARE_LOGGING_CATEGORY(lcPosThread)
+
+/**
+ * @brief Logs a message only if its category is enabled for the given level
+ * @param category Logging category function (e.g. lcPosConnection)
+ * @param level QtMsgType of the message
+ * @param message Expression producing the QString to log
+ *
+ * The message expression is not evaluated when the level is disabled, so
+ * formatting with arg() costs nothing in that case. Expands to a call of
+ * log(const QLoggingCategory&, QtMsgType, const QString&) in the enclosing
+ * class, which decides where enabled messages are delivered.
+ */
+#define POS_LOG(category, level, message) \
+    do { \
+        if (category().isEnabled(level)) { \
+            log(category(), level, (message)); \
+        } \
+    } while (false)
+
+#endif // POSLOGGING_H
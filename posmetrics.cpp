@@ -0,0 +1,244 @@
+/**
+ * @file posmetrics.cpp
+ * @brief Implementation of the LatencyHistogram and POSMetrics classes
+ *
+ * Durations below 4 us get one bucket each; above that, each power of two is
+ * split into four equal buckets, indexed by the two bits after the leading one.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "posmetrics.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+/**
+ * @brief Constructor for the LatencyHistogram class.
+ */
+LatencyHistogram::LatencyHistogram()
+    : m_sumNs(0)
+    , m_maxNs(0)
+{
+    for (std::atomic<quint64>& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Records one duration.
+ *
+ * @param nanoseconds The measured duration
+ */
+void LatencyHistogram::record(qint64 nanoseconds)
+{
+    const quint64 ns = nanoseconds > 0 ? quint64(nanoseconds) : 0;
+    m_buckets[bucketIndex(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+
+    quint64 max = m_maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !m_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Computes summary statistics of the recorded durations.
+ *
+ * Percentiles are reported as the upper bound of the bucket they fall into,
+ * capped at the maximum, so they never understate the latency.
+ *
+ * @return Count, mean, percentiles and maximum
+ */
+LatencyHistogram::Summary LatencyHistogram::summary() const
+{
+    Summary summary;
+    quint64* const counts = summary.buckets;
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    summary.count = total;
+    if (total == 0) {
+        return summary;
+    }
+
+    summary.maxUs = m_maxNs.load(std::memory_order_relaxed) / 1000.0;
+    summary.meanUs = m_sumNs.load(std::memory_order_relaxed) / 1000.0 / total;
+
+    const auto percentile = [&](double fraction) {
+        const quint64 rank = quint64(fraction * (total - 1)) + 1;
+        quint64 seen = 0;
+        for (int i = 0; i < BucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(double(bucketUpperBound(i)), summary.maxUs);
+            }
+        }
+        return summary.maxUs;
+    };
+    summary.p50Us = percentile(0.50);
+    summary.p90Us = percentile(0.90);
+    summary.p99Us = percentile(0.99);
+    return summary;
+}
+
+/**
+ * @brief Returns the bucket for a duration.
+ *
+ * @param microseconds The duration
+ * @return Bucket index, clamped to the last bucket
+ */
+int LatencyHistogram::bucketIndex(quint64 microseconds)
+{
+    if (microseconds < SubBuckets) {
+        return int(microseconds);
+    }
+
+    const int exponent = 63 - int(qCountLeadingZeroBits(microseconds));  // >= 2
+    if (exponent >= MaxExponent) {
+        return BucketCount - 1;
+    }
+    const int sub = int((microseconds >> (exponent - 2)) & (SubBuckets - 1));
+    return (exponent - 1) * SubBuckets + sub;
+}
+
+/**
+ * @brief Returns the exclusive upper bound of a bucket.
+ *
+ * @param index Bucket index
+ * @return Upper bound in microseconds
+ */
+quint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SubBuckets) {
+        return quint64(index) + 1;
+    }
+
+    const int exponent = index / SubBuckets + 1;
+    const int sub = index % SubBuckets;
+    return quint64(SubBuckets + sub + 1) << (exponent - 2);
+}
+
+/**
+ * @brief Constructor for the POSMetrics class.
+ *
+ * Starts the uptime clock.
+ */
+POSMetrics::POSMetrics()
+{
+    m_uptime.start();
+    for (std::atomic<quint64>& failures : m_failures) {
+        failures.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<quint64>& counter : m_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Returns the name used for an operation in JSON output.
+ *
+ * @param operation The operation
+ * @return The operation name
+ */
+QString POSMetrics::operationName(Operation operation)
+{
+    switch (operation) {
+    case Open:        return QStringLiteral("open");
+    case Reconnect:   return QStringLiteral("reconnect");
+    case SendBasket:  return QStringLiteral("sendBasket");
+    case SendPayment: return QStringLiteral("sendPayment");
+    case FiscalInfo:  return QStringLiteral("fiscalInfo");
+    default:          return QString();
+    }
+}
+
+/**
+ * @brief Returns the name used for a counter in JSON output.
+ *
+ * @param counter The counter
+ * @return The counter name
+ */
+QString POSMetrics::counterName(Counter counter)
+{
+    switch (counter) {
+    case SerialInEvents:    return QStringLiteral("serialInEvents");
+    case DeviceStateEvents: return QStringLiteral("deviceStateEvents");
+    case ReconnectAttempts: return QStringLiteral("reconnectAttempts");
+    case ConnectionsLost:   return QStringLiteral("connectionsLost");
+    case CallTimeouts:      return QStringLiteral("callTimeouts");
+    case WorkerRestarts:    return QStringLiteral("workerRestarts");
+    case DuplicatePayments: return QStringLiteral("duplicatePayments");
+    default:                return QString();
+    }
+}
+
+/**
+ * @brief Records one call of an operation.
+ *
+ * @param operation The operation
+ * @param nanoseconds Duration of the call
+ * @param succeeded Whether the call returned normally
+ */
+void POSMetrics::record(Operation operation, qint64 nanoseconds, bool succeeded)
+{
+    m_latency[operation].record(nanoseconds);
+    if (!succeeded) {
+        m_failures[operation].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Returns a copy of all metrics.
+ *
+ * @return The current statistics
+ */
+POSMetrics::Snapshot POSMetrics::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.uptimeMs = m_uptime.elapsed();
+    for (int i = 0; i < OperationCount; ++i) {
+        snapshot.operations[i].failures = m_failures[i].load(std::memory_order_relaxed);
+        snapshot.operations[i].latency = m_latency[i].summary();
+    }
+    for (int i = 0; i < CounterCount; ++i) {
+        snapshot.counters[i] = m_counters[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Converts the snapshot to JSON.
+ *
+ * Counts are written as doubles, which is exact up to 2^53.
+ *
+ * @return The snapshot as a JSON object
+ */
+QJsonObject POSMetrics::Snapshot::toJson() const
+{
+    QJsonObject operationsObject;
+    for (int i = 0; i < OperationCount; ++i) {
+        const OperationStats& stats = operations[i];
+        QJsonObject object;
+        object.insert("calls", double(stats.latency.count));
+        object.insert("failures", double(stats.failures));
+        object.insert("meanUs", stats.latency.meanUs);
+        object.insert("p50Us", stats.latency.p50Us);
+        object.insert("p90Us", stats.latency.p90Us);
+        object.insert("p99Us", stats.latency.p99Us);
+        object.insert("maxUs", stats.latency.maxUs);
+        operationsObject.insert(operationName(Operation(i)), object);
+    }
+
+    QJsonObject countersObject;
+    for (int i = 0; i < CounterCount; ++i) {
+        countersObject.insert(counterName(Counter(i)), double(counters[i]));
+    }
+
+    QJsonObject object;
+    object.insert("uptimeMs", double(uptimeMs));
+    object.insert("operations", operationsObject);
+    object.insert("counters", countersObject);
+    return object;
+}
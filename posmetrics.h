@@ -0,0 +1,221 @@
+#ifndef POSMETRICS_H
+#define POSMETRICS_H
+
+/**
+ * @file posmetrics.h
+ * @brief Lock-free latency histograms and event counters
+ *
+ * This header declares the LatencyHistogram and POSMetrics classes. Every
+ * backend call made by POSCommunication is timed with a monotonic clock and
+ * recorded into a fixed-bucket histogram, and callbacks, reconnects and
+ * failures are counted. Recording is a handful of relaxed atomic increments,
+ * so the instrumentation can stay enabled in production; snapshot() turns the
+ * raw counts into percentiles when somebody asks for them.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+#include <type_traits>
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram of durations with lock-free recording
+ *
+ * Durations are bucketed in microseconds with four buckets per power of two,
+ * so reported percentiles are accurate to within 25%. record() may be called
+ * from any number of threads at once.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int SubBuckets = 4;                     ///< Buckets per power of two
+    static constexpr int MaxExponent = 33;                   ///< Largest tracked power of two (~2.4 hours in us)
+    static constexpr int BucketCount = MaxExponent * SubBuckets;
+
+    /**
+     * @brief Summary statistics in microseconds
+     */
+    struct Summary
+    {
+        quint64 count = 0;  ///< Number of recorded durations
+        double meanUs = 0;  ///< Arithmetic mean
+        double p50Us = 0;   ///< Median (bucket upper bound)
+        double p90Us = 0;   ///< 90th percentile (bucket upper bound)
+        double p99Us = 0;   ///< 99th percentile (bucket upper bound)
+        double maxUs = 0;   ///< Longest recorded duration
+        quint64 buckets[BucketCount] = {};  ///< Raw count per bucket, see bucketUpperBound()
+    };
+
+    LatencyHistogram();
+
+    /**
+     * @brief Records one duration
+     * @param nanoseconds The measured duration
+     */
+    void record(qint64 nanoseconds);
+
+    /**
+     * @brief Computes summary statistics of the recorded durations
+     * @return Count, mean, percentiles and maximum
+     *
+     * Concurrent record() calls may or may not be included.
+     */
+    Summary summary() const;
+
+    /**
+     * @brief Returns the exclusive upper bound of a bucket
+     * @param index Bucket index
+     * @return Upper bound in microseconds
+     */
+    static quint64 bucketUpperBound(int index);
+
+private:
+    /**
+     * @brief Returns the bucket for a duration
+     * @param microseconds The duration
+     * @return Bucket index
+     */
+    static int bucketIndex(quint64 microseconds);
+
+    std::atomic<quint64> m_buckets[BucketCount];  ///< Count per bucket
+    std::atomic<quint64> m_sumNs;                 ///< Sum of all durations
+    std::atomic<quint64> m_maxNs;                 ///< Longest duration
+};
+
+/**
+ * @class POSMetrics
+ * @brief Per-operation latency and failure statistics plus event counters
+ */
+class POSMetrics
+{
+public:
+    /**
+     * @brief Timed backend operations
+     */
+    enum Operation {
+        Open,          ///< Opening the connection (creating the communication instance)
+        Reconnect,     ///< Asking the transport to re-establish the connection
+        SendBasket,    ///< Sending a basket
+        SendPayment,   ///< Sending a payment
+        FiscalInfo,    ///< Querying fiscal information from the terminal
+        OperationCount
+    };
+
+    /**
+     * @brief Counted events
+     */
+    enum Counter {
+        SerialInEvents,     ///< Serial-in callbacks received
+        DeviceStateEvents,  ///< Device state callbacks received
+        ReconnectAttempts,  ///< Automatic reconnection attempts made
+        ConnectionsLost,    ///< Times the device was reported disconnected
+        CallTimeouts,       ///< Backend calls that exceeded their deadline
+        WorkerRestarts,     ///< Device worker threads replaced after a hung call
+        DuplicatePayments,  ///< Payments answered by an earlier request with the same idempotency key
+        CounterCount
+    };
+
+    /**
+     * @brief Statistics of one operation
+     */
+    struct OperationStats
+    {
+        quint64 failures = 0;               ///< Calls that threw
+        LatencyHistogram::Summary latency;  ///< Duration of all calls, failed ones included
+    };
+
+    /**
+     * @brief Point-in-time copy of all metrics
+     */
+    struct Snapshot
+    {
+        qint64 uptimeMs = 0;                        ///< Time since the metrics were created
+        OperationStats operations[OperationCount];  ///< Indexed by Operation
+        quint64 counters[CounterCount] = {};        ///< Indexed by Counter
+
+        /**
+         * @brief Converts the snapshot to JSON
+         * @return Object with "uptimeMs", "operations" and "counters" members
+         */
+        QJsonObject toJson() const;
+    };
+
+    POSMetrics();
+
+    /**
+     * @brief Returns the name used for an operation in JSON output
+     * @param operation The operation
+     * @return Name such as "sendPayment"
+     */
+    static QString operationName(Operation operation);
+
+    /**
+     * @brief Returns the name used for a counter in JSON output
+     * @param counter The counter
+     * @return Name such as "serialInEvents"
+     */
+    static QString counterName(Counter counter);
+
+    /**
+     * @brief Records one call of an operation
+     * @param operation The operation
+     * @param nanoseconds Duration of the call
+     * @param succeeded Whether the call returned normally
+     */
+    void record(Operation operation, qint64 nanoseconds, bool succeeded);
+
+    /**
+     * @brief Increments a counter
+     * @param counter The counter
+     */
+    void increment(Counter counter)
+    {
+        m_counters[counter].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Runs a callable and records its duration under an operation
+     * @param operation The operation
+     * @param function Callable without arguments
+     * @return The value returned by the callable
+     *
+     * Exceptions are recorded as failures and rethrown.
+     */
+    template <typename Function>
+    auto measure(Operation operation, Function&& function) -> decltype(function())
+    {
+        QElapsedTimer timer;
+        timer.start();
+        try {
+            if constexpr (std::is_void<decltype(function())>::value) {
+                function();
+                record(operation, timer.nsecsElapsed(), true);
+            } else {
+                auto result = function();
+                record(operation, timer.nsecsElapsed(), true);
+                return result;
+            }
+        } catch (...) {
+            record(operation, timer.nsecsElapsed(), false);
+            throw;
+        }
+    }
+
+    /**
+     * @brief Returns a copy of all metrics
+     * @return The current statistics; safe to call from any thread
+     */
+    Snapshot snapshot() const;
+
+private:
+    QElapsedTimer m_uptime;                                ///< Started on construction
+    LatencyHistogram m_latency[OperationCount];            ///< Durations per operation
+    std::atomic<quint64> m_failures[OperationCount];       ///< Failed calls per operation
+    std::atomic<quint64> m_counters[CounterCount];         ///< Event counts
+};
+
+#endif // POSMETRICS_H
@@ -0,0 +1,123 @@
+/**
+ * @file reconnectscheduler.cpp
+ * @brief Implementation of the ReconnectScheduler class.
+ *
+ * Delays follow fastRetryMs, then initialDelayMs * multiplier^(n-1) capped at
+ * maxDelayMs. Each delay is spread by a random jitter so several lanes that
+ * lost their terminals at the same time do not retry in lockstep.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "reconnectscheduler.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Constructor for the ReconnectScheduler class.
+ *
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+ReconnectScheduler::ReconnectScheduler(QObject* parent)
+    : QObject(parent)
+    , m_timer(this)
+    , m_attempts(0)
+    , m_exhausted(false)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, [this]() {
+        emit attemptDue(m_attempts);
+    });
+}
+
+/**
+ * @brief Replaces the backoff parameters.
+ *
+ * @param policy New parameters
+ */
+void ReconnectScheduler::setPolicy(const Policy& policy)
+{
+    m_policy = policy;
+}
+
+/**
+ * @brief Returns the backoff parameters.
+ *
+ * @return Current policy
+ */
+ReconnectScheduler::Policy ReconnectScheduler::policy() const
+{
+    return m_policy;
+}
+
+/**
+ * @brief Arms the timer for the next attempt.
+ *
+ * Attempts already pending are left alone, so repeated disconnect reports do
+ * not shorten the backoff.
+ */
+void ReconnectScheduler::schedule()
+{
+    if (m_timer.isActive() || m_exhausted) {
+        return;
+    }
+
+    if (m_policy.maxAttempts > 0 && m_attempts >= m_policy.maxAttempts) {
+        m_exhausted = true;
+        emit exhausted(m_attempts);
+        return;
+    }
+
+    m_timer.start(delayForAttempt(m_attempts));
+    ++m_attempts;
+}
+
+/**
+ * @brief Ends the current reconnection cycle.
+ */
+void ReconnectScheduler::reset()
+{
+    m_timer.stop();
+    m_attempts = 0;
+    m_exhausted = false;
+}
+
+/**
+ * @brief Checks if a reconnection cycle is in progress.
+ *
+ * @return true if attempts have been made or one is pending
+ */
+bool ReconnectScheduler::isActive() const
+{
+    return m_timer.isActive() || m_attempts > 0;
+}
+
+/**
+ * @brief Returns the number of attempts scheduled in the current cycle.
+ *
+ * @return Attempt count
+ */
+int ReconnectScheduler::attempts() const
+{
+    return m_attempts;
+}
+
+/**
+ * @brief Computes the delay before a given attempt.
+ *
+ * @param attempt Zero-based attempt number
+ * @return Delay in milliseconds including jitter
+ */
+int ReconnectScheduler::delayForAttempt(int attempt) const
+{
+    if (attempt == 0) {
+        return std::max(0, m_policy.fastRetryMs);
+    }
+
+    const double base = m_policy.initialDelayMs * std::pow(m_policy.multiplier, attempt - 1);
+    const double capped = std::min(base, static_cast<double>(m_policy.maxDelayMs));
+    const double jitter = std::clamp(m_policy.jitter, 0.0, 1.0);
+    const double spread = 1.0 + jitter * (QRandomGenerator::global()->generateDouble() * 2.0 - 1.0);
+    return std::max(0, static_cast<int>(capped * spread));
+}
@@ -0,0 +1,119 @@
+#ifndef RECONNECTSCHEDULER_H
+#define RECONNECTSCHEDULER_H
+
+/**
+ * @file reconnectscheduler.h
+ * @brief Exponential backoff timing for automatic reconnection
+ *
+ * This header declares the ReconnectScheduler class which decides when the
+ * next reconnection attempt should happen after a terminal has been lost.
+ * The first retry is fast so a brief USB blip recovers quickly; later retries
+ * back off exponentially with jitter, and the scheduler gives up after a
+ * configurable number of attempts so a dead device costs almost nothing.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QObject>
+#include <QTimer>
+
+/**
+ * @class ReconnectScheduler
+ * @brief Timer-driven backoff for reconnection attempts
+ *
+ * The scheduler lives on the device worker thread. schedule() arms the timer
+ * for the next attempt and attemptDue() fires when it is time to try again.
+ * reset() ends the cycle once the device is back.
+ */
+class ReconnectScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Backoff parameters
+     */
+    struct Policy
+    {
+        int fastRetryMs = 200;       ///< Delay before the first attempt
+        int initialDelayMs = 1000;   ///< Delay before the second attempt
+        int maxDelayMs = 60000;      ///< Upper bound for any delay
+        double multiplier = 2.0;     ///< Growth factor between attempts
+        double jitter = 0.2;         ///< Random spread as a fraction of the delay (0..1)
+        int maxAttempts = 12;        ///< Attempts before giving up (0 = unlimited)
+    };
+
+    /**
+     * @brief Constructor for ReconnectScheduler
+     * @param parent The parent QObject; must live on the same thread
+     */
+    explicit ReconnectScheduler(QObject* parent = nullptr);
+
+    /**
+     * @brief Replaces the backoff parameters
+     * @param policy New parameters; takes effect from the next schedule()
+     */
+    void setPolicy(const Policy& policy);
+
+    /**
+     * @brief Returns the backoff parameters
+     * @return Current policy
+     */
+    Policy policy() const;
+
+    /**
+     * @brief Arms the timer for the next attempt
+     *
+     * Does nothing if an attempt is already pending. Emits exhausted() instead
+     * when the maximum number of attempts has been reached.
+     */
+    void schedule();
+
+    /**
+     * @brief Ends the current reconnection cycle
+     *
+     * Stops the timer and resets the attempt counter so the next loss of
+     * connection starts again with the fast retry.
+     */
+    void reset();
+
+    /**
+     * @brief Checks if a reconnection cycle is in progress
+     * @return true if attempts have been made or one is pending
+     */
+    bool isActive() const;
+
+    /**
+     * @brief Returns the number of attempts scheduled in the current cycle
+     * @return Attempt count
+     */
+    int attempts() const;
+
+    /**
+     * @brief Computes the delay before a given attempt
+     * @param attempt Zero-based attempt number
+     * @return Delay in milliseconds including jitter
+     */
+    int delayForAttempt(int attempt) const;
+
+signals:
+    /**
+     * @brief Signal emitted when the next attempt should be made
+     * @param attempt One-based number of the attempt
+     */
+    void attemptDue(int attempt);
+
+    /**
+     * @brief Signal emitted when the maximum number of attempts is reached
+     * @param attempts Number of attempts that were made
+     */
+    void exhausted(int attempts);
+
+private:
+    QTimer m_timer;    ///< Single-shot timer for the next attempt
+    Policy m_policy;   ///< Backoff parameters
+    int m_attempts;    ///< Attempts scheduled in the current cycle
+    bool m_exhausted;  ///< Whether the current cycle has given up
+};
+
+#endif // RECONNECTSCHEDULER_H
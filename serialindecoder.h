@@ -0,0 +1,414 @@
+#ifndef SERIALINDECODER_H
+#define SERIALINDECODER_H
+
+/**
+ * @file serialindecoder.h
+ * @brief Typed decoding of serial-in events with a compile-time dispatch table
+ *
+ * This header provides the SerialInDecoder template. serialInReceived hands
+ * every consumer a raw type code and string, so each one re-parses the value
+ * and switches on the code. A decoder is instantiated with the event types an
+ * application understands; it maps type codes to those types at compile time,
+ * parses each payload once, and only for events someone subscribed to.
+ *
+ * An event type is a default-constructible struct with:
+ * - static constexpr int TypeCode, the serial-in type code it decodes
+ * - static bool parse(QStringView value, Event& event), returning false for
+ *   payloads it cannot decode (the event is then dropped)
+ *
+ * @code
+ * struct CardRead
+ * {
+ *     static constexpr int TypeCode = 12;  // from the terminal documentation
+ *     QString maskedPan;
+ *     static bool parse(QStringView value, CardRead& event)
+ *     {
+ *         event.maskedPan = value.toString();
+ *         return !event.maskedPan.isEmpty();
+ *     }
+ * };
+ *
+ * SerialInDecoder<CardRead, JsonSerialInEvent<20>> decoder(communication);
+ * decoder.subscribe<CardRead>([](const CardRead& event) { ... });
+ * @endcode
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include <QStringView>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "poscommunication.h"
+
+/**
+ * @brief Compile-time helpers for SerialInDecoder's dispatch table
+ */
+namespace SerialInDispatch {
+
+/**
+ * @brief Maps a type code to the index of its event type
+ */
+struct Slot
+{
+    int typeCode;  ///< Serial-in type code
+    int index;     ///< Position of the event type in the decoder's Events
+};
+
+/**
+ * @brief Builds a dispatch table sorted by type code
+ * @param codes Type code of each event type, in declaration order
+ * @return One slot per event type
+ */
+template <std::size_t N>
+constexpr std::array<Slot, N> sortedTable(const std::array<int, N>& codes)
+{
+    std::array<Slot, N> slots{};
+    for (std::size_t i = 0; i < N; ++i) {
+        slots[i] = Slot{codes[i], int(i)};
+    }
+    for (std::size_t i = 1; i < N; ++i) {
+        const Slot slot = slots[i];
+        std::size_t j = i;
+        for (; j > 0 && slots[j - 1].typeCode > slot.typeCode; --j) {
+            slots[j] = slots[j - 1];
+        }
+        slots[j] = slot;
+    }
+    return slots;
+}
+
+/**
+ * @brief Checks that no type code appears twice in a sorted table
+ * @param table Table built by sortedTable()
+ * @return true if all type codes differ
+ */
+template <std::size_t N>
+constexpr bool isUnique(const std::array<Slot, N>& table)
+{
+    for (std::size_t i = 1; i < N; ++i) {
+        if (table[i - 1].typeCode == table[i].typeCode) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Looks up a type code by binary search
+ * @param table Table built by sortedTable()
+ * @param typeCode Serial-in type code
+ * @return Index of the event type, or -1 if unknown
+ */
+template <std::size_t N>
+constexpr int find(const std::array<Slot, N>& table, int typeCode)
+{
+    std::size_t low = 0;
+    std::size_t high = N;
+    while (low < high) {
+        const std::size_t middle = (low + high) / 2;
+        if (table[middle].typeCode < typeCode) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < N && table[low].typeCode == typeCode ? table[low].index : -1;
+}
+
+} // namespace SerialInDispatch
+
+/**
+ * @struct TextSerialInEvent
+ * @brief Event whose payload is used as plain text
+ * @tparam Code Serial-in type code
+ */
+template <int Code>
+struct TextSerialInEvent
+{
+    static constexpr int TypeCode = Code;  ///< Serial-in type code
+    QString text;                          ///< The payload
+
+    static bool parse(QStringView value, TextSerialInEvent& event)
+    {
+        event.text = value.toString();
+        return true;
+    }
+};
+
+/**
+ * @struct JsonSerialInEvent
+ * @brief Event whose payload is a JSON object
+ * @tparam Code Serial-in type code
+ */
+template <int Code>
+struct JsonSerialInEvent
+{
+    static constexpr int TypeCode = Code;  ///< Serial-in type code
+    QJsonObject object;                    ///< The parsed payload
+
+    static bool parse(QStringView value, JsonSerialInEvent& event)
+    {
+        const QJsonDocument document = QJsonDocument::fromJson(value.toUtf8());
+        event.object = document.object();
+        return document.isObject();
+    }
+};
+
+/**
+ * @class SerialInDecoder
+ * @brief Decodes one terminal's serial input into typed events
+ *
+ * The decoder registers itself with POSCommunication::subscribeSerialIn(),
+ * so handlers run on the backend's callback thread with the same rules as
+ * direct subscribers: return quickly, do not throw, and do not call back into
+ * the POSCommunication synchronously.
+ *
+ * An event with a type code outside the table costs one binary search over
+ * the codes; an event nobody subscribed to additionally costs one bit test.
+ * Only subscribed events are parsed, once for all of their handlers.
+ * subscribe() and unsubscribe() are safe to call from any thread.
+ *
+ * @tparam Events Event types; their type codes must be unique
+ */
+template <typename... Events>
+class SerialInDecoder
+{
+public:
+    static constexpr std::size_t EventCount = sizeof...(Events);  ///< Number of event types
+
+    static_assert(EventCount > 0, "SerialInDecoder needs at least one event type");
+    static_assert(EventCount <= 64, "SerialInDecoder supports at most 64 event types");
+    static_assert((std::is_default_constructible_v<Events> && ...), "Event types must be default-constructible");
+
+    /**
+     * @brief Handler for one event type
+     */
+    template <typename Event>
+    using Handler = std::function<void(const Event& event)>;
+
+    /**
+     * @brief Constructor for SerialInDecoder
+     * @param communication The terminal whose serial input is decoded
+     */
+    explicit SerialInDecoder(POSCommunication* communication)
+        : m_communication(communication)
+        , m_shared(std::make_shared<Shared>())
+    {
+        m_subscription = communication->subscribeSerialIn([shared = m_shared](int typeCode, QStringView value) {
+            shared->decode(typeCode, value);
+        });
+    }
+
+    /**
+     * @brief Destructor
+     *
+     * Stops decoding. An event being delivered meanwhile may still reach the
+     * handlers.
+     */
+    ~SerialInDecoder()
+    {
+        if (m_communication) {
+            m_communication->unsubscribeSerialIn(m_subscription);
+        }
+    }
+
+    SerialInDecoder(const SerialInDecoder&) = delete;
+    SerialInDecoder& operator=(const SerialInDecoder&) = delete;
+
+    /**
+     * @brief Registers a handler for one event type
+     * @tparam Event One of the decoder's event types
+     * @param handler Called with every decoded event of that type
+     * @return Subscription ID for unsubscribe()
+     */
+    template <typename Event>
+    int subscribe(Handler<Event> handler)
+    {
+        constexpr std::size_t index = indexOf<Event>();
+        static_assert(index < EventCount, "Event is not one of the decoder's event types");
+
+        QMutexLocker locker(&m_shared->mutex);
+        const int id = m_shared->nextId++;
+        auto next = copyRegistry();
+        std::get<index>(next->handlers).emplace_back(id, std::move(handler));
+        next->mask |= quint64(1) << index;
+        std::atomic_store(&m_shared->registry, std::shared_ptr<const Registry>(std::move(next)));
+        return id;
+    }
+
+    /**
+     * @brief Removes a handler registered with subscribe()
+     * @param id Subscription ID returned by subscribe()
+     */
+    void unsubscribe(int id)
+    {
+        QMutexLocker locker(&m_shared->mutex);
+        auto next = copyRegistry();
+        std::apply([id](auto&... handlers) { (eraseHandler(handlers, id), ...); }, next->handlers);
+        next->mask = maskOf(next->handlers, std::index_sequence_for<Events...>());
+        std::atomic_store(&m_shared->registry, std::shared_ptr<const Registry>(std::move(next)));
+    }
+
+    /**
+     * @brief Decodes one event and delivers it to its handlers
+     * @param typeCode Code indicating the type of received data
+     * @param value The data value
+     *
+     * Called for every serial-in event of the terminal; call it directly to
+     * feed events from another source.
+     */
+    void decode(int typeCode, QStringView value) const
+    {
+        m_shared->decode(typeCode, value);
+    }
+
+    /**
+     * @brief Checks if a type code belongs to one of the decoder's event types
+     * @param typeCode Serial-in type code
+     * @return true if the code is in the dispatch table
+     */
+    static constexpr bool isKnown(int typeCode)
+    {
+        return find(typeCode) >= 0;
+    }
+
+private:
+    static constexpr std::array<SerialInDispatch::Slot, EventCount> Table =
+        SerialInDispatch::sortedTable(std::array<int, EventCount>{{Events::TypeCode...}});  ///< Type codes in ascending order
+
+    static_assert(SerialInDispatch::isUnique(Table), "Two event types share the same TypeCode");
+
+    /**
+     * @brief Looks up the event type of a type code
+     * @param typeCode Serial-in type code
+     * @return Index of the event type, or -1 if unknown
+     */
+    static constexpr int find(int typeCode)
+    {
+        return SerialInDispatch::find(Table, typeCode);
+    }
+
+    /**
+     * @brief Returns the position of an event type in Events
+     * @return The index, or EventCount if Event is not in Events
+     */
+    template <typename Event>
+    static constexpr std::size_t indexOf()
+    {
+        constexpr bool matches[] = {std::is_same_v<Event, Events>...};
+        for (std::size_t i = 0; i < EventCount; ++i) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return EventCount;
+    }
+
+    using Handlers = std::tuple<std::vector<std::pair<int, Handler<Events>>>...>;
+
+    /**
+     * @brief Immutable set of handlers, replaced on every change
+     */
+    struct Registry
+    {
+        Handlers handlers;  ///< Handlers per event type
+        quint64 mask = 0;   ///< Bit i is set if event type i has handlers
+    };
+
+    /**
+     * @brief Parses an event of type index I and delivers it
+     * @param registry Current handlers
+     * @param value The data value
+     */
+    template <std::size_t I>
+    static void dispatch(const Registry& registry, QStringView value)
+    {
+        using Event = std::tuple_element_t<I, std::tuple<Events...>>;
+        Event event;
+        if (!Event::parse(value, event)) {
+            return;
+        }
+        for (const auto& handler : std::get<I>(registry.handlers)) {
+            handler.second(event);
+        }
+    }
+
+    using DispatchFunction = void (*)(const Registry&, QStringView);
+
+    /**
+     * @brief Builds the parse-and-deliver function of every event type
+     * @return One function per event type, indexed like Events
+     */
+    template <std::size_t... I>
+    static constexpr std::array<DispatchFunction, EventCount> makeDispatchers(std::index_sequence<I...>)
+    {
+        return {{&dispatch<I>...}};
+    }
+
+    /**
+     * @brief State shared with the subscription, which may outlive the decoder briefly
+     */
+    struct Shared
+    {
+        QMutex mutex;                               ///< Serializes changes to the registry
+        std::shared_ptr<const Registry> registry;   ///< Current handlers; read with std::atomic_load
+        int nextId = 1;                             ///< ID for the next subscription (guarded by mutex)
+
+        void decode(int typeCode, QStringView value) const
+        {
+            static constexpr std::array<DispatchFunction, EventCount> dispatchers =
+                makeDispatchers(std::index_sequence_for<Events...>());
+
+            const int index = find(typeCode);
+            if (index < 0) {
+                return;
+            }
+            const std::shared_ptr<const Registry> current = std::atomic_load(&registry);
+            if (current && (current->mask & (quint64(1) << index))) {
+                dispatchers[std::size_t(index)](*current, value);
+            }
+        }
+    };
+
+    template <typename Vector>
+    static void eraseHandler(Vector& handlers, int id)
+    {
+        handlers.erase(std::remove_if(handlers.begin(), handlers.end(),
+                                      [id](const auto& handler) { return handler.first == id; }),
+                       handlers.end());
+    }
+
+    template <std::size_t... I>
+    static quint64 maskOf(const Handlers& handlers, std::index_sequence<I...>)
+    {
+        return ((std::get<I>(handlers).empty() ? quint64(0) : quint64(1) << I) | ...);
+    }
+
+    /**
+     * @brief Copies the current registry for modification (caller holds the mutex)
+     * @return A mutable copy
+     */
+    std::shared_ptr<Registry> copyRegistry() const
+    {
+        const std::shared_ptr<const Registry> current = std::atomic_load(&m_shared->registry);
+        return current ? std::make_shared<Registry>(*current) : std::make_shared<Registry>();
+    }
+
+    QPointer<POSCommunication> m_communication;  ///< Terminal the decoder is subscribed to
+    std::shared_ptr<Shared> m_shared;            ///< Handlers, shared with the subscription
+    int m_subscription;                          ///< ID from POSCommunication::subscribeSerialIn()
+};
+
+#endif // SERIALINDECODER_H
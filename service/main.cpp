@@ -0,0 +1,281 @@
+/**
+ * @file main.cpp
+ * @brief Entry point for the headless POS service
+ *
+ * This file contains the main function of POSService, which runs one terminal
+ * without Qt Widgets for unattended kiosks. The terminal is driven by local
+ * clients through POSService's JSON-lines protocol. The same executable acts
+ * as a command-line client for scripts:
+ *
+ * @code
+ * POSService --company "YourCompanyName"        # run the service
+ * POSService --journal /var/lib/pos/journal     # ... and journal every transaction
+ * POSService --journal ... --outcome-type 20    # ... completing payments on serial-in type 20
+ * POSService --capture peak.postraf             # ... and record traffic for POSReplay
+ * POSService --thread-policy "device=highest@1;callback=high@1;journal=low@0"
+ * POSService --client status                    # query it
+ * POSService --client sendPayment '{"amount":100,"type":1}'
+ * POSService --client subscribe                 # print events until interrupted
+ * POSService --client recovered                 # list transactions a crash left open
+ * POSService --client settle '[17,18]'          # ... and settle the confirmed ones
+ * POSService --client --pipe status             # skip the shared-memory channel
+ * @endcode
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "metricsserver.h"
+#include "poscommunication.h"
+#include "poscommunicationpool.h"
+#include "posservice.h"
+#include "sharedmemorychannel.h"
+#include "threadpolicy.h"
+#include "trafficcapture.h"
+#include "transactionjournal.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTextStream>
+
+namespace {
+
+constexpr int ClientTimeoutMs = 30000;  ///< Time the client waits for the service to answer
+
+/**
+ * @brief Reads lines from a device until the response with the given id arrives
+ *
+ * @param device The connection
+ * @param id The request id
+ * @param timeoutMs Time to wait for each chunk of data
+ * @return The response, or an empty object on timeout
+ */
+QJsonObject waitForResponse(QIODevice* device, int id, int timeoutMs)
+{
+    while (device->canReadLine() || device->waitForReadyRead(timeoutMs)) {
+        while (device->canReadLine()) {
+            const QJsonObject message = QJsonDocument::fromJson(device->readLine().trimmed()).object();
+            if (message.contains("id") && message.value("id").toInt() == id) {
+                return message;
+            }
+        }
+    }
+    return QJsonObject();
+}
+
+/**
+ * @brief Sends one command to a running service and prints the answer
+ *
+ * Unless useSharedMemory is false, the command travels over a shared-memory
+ * channel negotiated on the local socket; if the service cannot provide one,
+ * the socket itself is used.
+ *
+ * @param serverName Name of the service's local socket
+ * @param command Command name
+ * @param data Optional JSON document passed as the command's data
+ * @param useSharedMemory Whether to try a shared-memory channel first
+ * @return 0 if the service reported success, 1 otherwise
+ */
+int runClient(const QString& serverName, const QString& command, const QString& data, bool useSharedMemory)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(ClientTimeoutMs)) {
+        err << "Cannot reach " << serverName << ": " << socket.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QIODevice* device = &socket;
+    SharedMemoryChannel channel;
+    if (useSharedMemory) {
+        socket.write("{\"id\":0,\"command\":\"openChannel\"}\n");
+        const QJsonObject response = waitForResponse(&socket, 0, ClientTimeoutMs);
+        const QString key = response.value("result").toObject().value("key").toString();
+        if (response.value("ok").toBool() && channel.attach(key)) {
+            device = &channel;
+        } else {
+            err << "Shared memory unavailable, using " << serverName << Qt::endl;
+        }
+    }
+
+    QJsonObject request;
+    request.insert("id", 1);
+    request.insert("command", command);
+    if (!data.isEmpty()) {
+        const QJsonDocument document = QJsonDocument::fromJson(data.toUtf8());
+        if (document.isObject()) {
+            request.insert("data", document.object());
+        } else if (document.isArray()) {
+            request.insert("data", document.array());
+        } else {
+            request.insert("data", data);
+        }
+    }
+    device->write(QJsonDocument(request).toJson(QJsonDocument::Compact).append('\n'));
+
+    // subscribe keeps printing events until the service goes away
+    const bool follow = command == "subscribe";
+    bool ok = false;
+    while (device->waitForReadyRead(follow ? -1 : ClientTimeoutMs) || device->canReadLine()) {
+        while (device->canReadLine()) {
+            const QByteArray line = device->readLine().trimmed();
+            out << line << Qt::endl;
+
+            const QJsonObject message = QJsonDocument::fromJson(line).object();
+            if (message.value("id").toInt() == 1) {
+                ok = message.value("ok").toBool();
+                if (!follow) {
+                    return ok ? 0 : 1;
+                }
+            }
+        }
+    }
+
+    if (!follow) {
+        err << "No answer from " << serverName << Qt::endl;
+    }
+    return ok ? 0 : 1;
+}
+
+} // namespace
+
+/**
+ * @brief Service entry point
+ *
+ * @param argc Command line argument count
+ * @param argv Command line argument values
+ * @return 0 on normal exit, 1 if the service could not start or a client command failed
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("POSService");
+    QCoreApplication::setOrganizationName("YourCompanyName");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless POS terminal service");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption companyOption("company", "Merchant/company identifier of the terminal.", "name",
+                                           "YourCompanyName");
+    const QCommandLineOption socketOption("socket", "Name of the local socket or pipe.", "name", "POSService");
+    const QCommandLineOption metricsPortOption("metrics-port", "Serve Prometheus metrics on this TCP port.", "port");
+    const QCommandLineOption journalOption("journal", "Journal baskets and payments to this file.", "path");
+    const QCommandLineOption outcomeTypeOption("outcome-type",
+                                               "Serial-in type code carrying a journaled payment's outcome.", "code");
+    const QCommandLineOption captureOption("capture", "Record terminal traffic to this file for POSReplay.", "path");
+    const QCommandLineOption threadPolicyOption("thread-policy",
+                                                "Thread priorities and cores, e.g. \"device=highest@1;journal=low@0\".",
+                                                "spec");
+    const QCommandLineOption clientOption("client", "Send a command to a running service instead of running one.");
+    const QCommandLineOption pipeOption("pipe", "Client mode: use the local socket only, without shared memory.");
+    parser.addOptions({companyOption, socketOption, metricsPortOption, journalOption, outcomeTypeOption, captureOption,
+                       threadPolicyOption, clientOption, pipeOption});
+    parser.addPositionalArgument("command", "Client mode: command to send (e.g. status).", "[command]");
+    parser.addPositionalArgument("data", "Client mode: JSON data of the command.", "[data]");
+    parser.process(app);
+
+    const QString socketName = parser.value(socketOption);
+
+    if (parser.isSet(clientOption)) {
+        const QStringList arguments = parser.positionalArguments();
+        if (arguments.isEmpty()) {
+            parser.showHelp(1);
+        }
+        return runClient(socketName, arguments.at(0), arguments.value(1), !parser.isSet(pipeOption));
+    }
+
+    QString threadPolicyError;
+    if (!ThreadPolicy::configure(parser.value(threadPolicyOption), &threadPolicyError)) {
+        qCritical() << "Invalid thread policy:" << threadPolicyError;
+        return 1;
+    }
+
+    POSCommunication* communication = POSCommunicationPool::instance()->terminal(parser.value(companyOption));
+    QObject::connect(communication, &POSCommunication::librariesReady, communication, [communication](bool available) {
+        if (!available) {
+            qWarning() << "The" << communication->backendName() << "backend is not available";
+        }
+    });
+
+    TrafficCapture capture;
+    if (parser.isSet(captureOption)) {
+        if (!capture.open(parser.value(captureOption))) {
+            qCritical() << "Failed to open capture" << parser.value(captureOption);
+            return 1;
+        }
+        communication->setCapture(&capture);
+    }
+
+    TransactionJournal journal;
+    if (parser.isSet(journalOption)) {
+        if (!journal.open(parser.value(journalOption))) {
+            qCritical() << "Failed to open journal" << parser.value(journalOption);
+            return 1;
+        }
+        communication->setJournal(&journal);
+
+        if (parser.isSet(outcomeTypeOption)) {
+            bool ok = false;
+            const int outcomeType = parser.value(outcomeTypeOption).toInt(&ok);
+            if (!ok) {
+                qCritical() << "Invalid outcome type" << parser.value(outcomeTypeOption);
+                return 1;
+            }
+            const TransactionJournal::OutcomeFilter isOutcome = [outcomeType](int typeCode, QStringView) {
+                return typeCode == outcomeType;
+            };
+            journal.setOutcomeFilter(isOutcome);
+            communication->setOutcomeFilter(isOutcome);
+        } else {
+            qInfo() << "No --outcome-type: journaled payments stay open until settled";
+        }
+
+        // Fetch the fiscal info for what a previous run left open once the terminal is reachable
+        QObject::connect(communication, &POSCommunication::stateChanged, &journal,
+                         [communication, &journal](POSCommunication::State state) {
+            if (state == POSCommunication::Connected) {
+                journal.reconcile(communication);
+            }
+        });
+        QObject::connect(&journal, &TransactionJournal::reconciliationReady, &journal,
+                         [](const QVector<TransactionJournal::Entry>& entries, const QString& fiscalInfo) {
+            QStringList ids;
+            for (const TransactionJournal::Entry& entry : entries) {
+                ids.append(QString::number(entry.id));
+            }
+            qWarning() << "Transactions" << ids.join(',') << "need settling against fiscal info:" << fiscalInfo;
+        });
+    }
+
+    // Connect and probe while the socket is set up; the journal's handlers are already
+    // connected, so a fast connection cannot slip past reconciliation
+    communication->warmUp();
+
+    POSService service(communication);
+    if (journal.isOpen()) {
+        service.setJournal(&journal);
+    }
+    if (!service.listen(socketName)) {
+        qCritical() << "Failed to listen on" << socketName << ":" << service.errorString();
+        return 1;
+    }
+
+    MetricsServer metricsServer(POSCommunicationPool::instance());
+    if (parser.isSet(metricsPortOption)) {
+        const quint16 port = quint16(parser.value(metricsPortOption).toUInt());
+        if (!metricsServer.listen(port)) {
+            qWarning() << "Failed to start metrics endpoint:" << metricsServer.errorString();
+        }
+    }
+
+    // The pool destroys the terminal on aboutToQuit, before the journal and capture go away
+    return app.exec();
+}
@@ -0,0 +1,454 @@
+/**
+ * @file posservice.cpp
+ * @brief Implementation of the POSService class
+ *
+ * Requests are answered through the asynchronous POSCommunication API and
+ * QFutureWatcher, so the service's single thread only ever parses and writes
+ * JSON. The connect command returns as soon as it is queued and reports its
+ * outcome through state events; disconnect and reconnect are answered once
+ * the device worker has run them. Local sockets and shared-memory channels
+ * are both handled as plain QIODevices.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "posservice.h"
+#include "sharedmemorychannel.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QMetaEnum>
+
+/**
+ * @brief Constructor for the POSService class.
+ *
+ * @param communication The terminal to serve
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+POSService::POSService(POSCommunication* communication, QObject* parent)
+    : QObject(parent)
+    , m_communication(communication)
+    , m_channelCount(0)
+{
+    QObject::connect(&m_server, &QLocalServer::newConnection, this, &POSService::onNewConnection);
+    QObject::connect(communication, &POSCommunication::serialInReceived, this, &POSService::onSerialIn);
+    QObject::connect(communication, &POSCommunication::deviceStateChanged, this, &POSService::onDeviceStateChanged);
+    QObject::connect(communication, &POSCommunication::stateChanged, this, &POSService::onStateChanged);
+}
+
+/**
+ * @brief Serves the recovered and settle commands from a journal.
+ *
+ * @param journal Open journal, or nullptr
+ */
+void POSService::setJournal(TransactionJournal* journal)
+{
+    m_journal = journal;
+}
+
+/**
+ * @brief Starts accepting clients.
+ *
+ * @param name Server name (pipe or socket name)
+ * @return true if listening, false otherwise
+ */
+bool POSService::listen(const QString& name)
+{
+    QLocalServer::removeServer(name);
+    return m_server.listen(name);
+}
+
+/**
+ * @brief Returns a description of the last listen() error.
+ *
+ * @return Human-readable error text
+ */
+QString POSService::errorString() const
+{
+    return m_server.errorString();
+}
+
+/**
+ * @brief Accepts pending clients.
+ */
+void POSService::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+        QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        QObject::connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_subscribers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+/**
+ * @brief Reads and handles all complete request lines of a client.
+ *
+ * @param device The client connection
+ */
+void POSService::onReadyRead(QIODevice* device)
+{
+    while (device->canReadLine()) {
+        // Reads at most MaxRequestSize bytes, so a longer line arrives without its newline
+        const QByteArray line = device->readLine(MaxRequestSize + 1);
+        if (!line.endsWith('\n')) {
+            replyError(device, QJsonValue(), "Request too large");
+            device->close();
+            return;
+        }
+        const QByteArray request = line.trimmed();
+        if (!request.isEmpty()) {
+            handleRequest(device, request);
+        }
+    }
+
+    if (device->bytesAvailable() > MaxRequestSize) {
+        replyError(device, QJsonValue(), "Request too large");
+        device->close();
+    }
+}
+
+/**
+ * @brief Handles one request.
+ *
+ * @param device The client connection
+ * @param line The request line without its terminator
+ */
+void POSService::handleRequest(QIODevice* device, const QByteArray& line)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+    if (!document.isObject()) {
+        replyError(device, QJsonValue(), "Invalid request: " + parseError.errorString());
+        return;
+    }
+
+    const QJsonObject request = document.object();
+    const QJsonValue id = request.value("id");
+    const QString command = request.value("command").toString();
+    const QJsonValue data = request.value("data");
+
+    if (!m_communication) {
+        replyError(device, id, "Terminal is gone");
+        return;
+    }
+
+    // The terminal expects JSON text; accept both embedded objects and strings
+    const QString json = data.isObject()
+        ? QString::fromUtf8(QJsonDocument(data.toObject()).toJson(QJsonDocument::Compact))
+        : data.toString();
+
+    try {
+        if (command == "status") {
+            replyOk(device, id, status());
+        } else if (command == "connect") {
+            m_communication->connect();
+            replyOk(device, id);
+        } else if (command == "disconnect") {
+            replyWhenFinished(device, id, m_communication->disconnectAsync());
+        } else if (command == "reconnect") {
+            replyWhenFinished(device, id, m_communication->reconnectAsync());
+        } else if (command == "sendBasket") {
+            replyWhenFinished(device, id, m_communication->sendBasketAsync(json),
+                              [](int result) { return QJsonValue(result); });
+        } else if (command == "sendBaskets") {
+            QStringList baskets;
+            for (const QJsonValue& basket : data.toArray()) {
+                baskets.append(basket.isObject()
+                    ? QString::fromUtf8(QJsonDocument(basket.toObject()).toJson(QJsonDocument::Compact))
+                    : basket.toString());
+            }
+            replyWhenFinished(device, id, m_communication->sendBasketsAsync(baskets),
+                              [](const QVector<POSCommunication::BatchResult>& results) {
+                QJsonArray array;
+                for (const POSCommunication::BatchResult& result : results) {
+                    QJsonObject item;
+                    item.insert("ok", result.ok());
+                    if (result.ok()) {
+                        item.insert("result", result.result);
+                    } else {
+                        item.insert("error", result.error);
+                    }
+                    array.append(item);
+                }
+                return QJsonValue(array);
+            });
+        } else if (command == "sendPayment") {
+            replyWhenFinished(device, id, m_communication->sendPaymentAsync(json, request.value("key").toString()),
+                              [](int result) { return QJsonValue(result); });
+        } else if (command == "fiscalInfo") {
+            replyWhenFinished(device, id, m_communication->getFiscalInfoAsync(), [](const QString& info) {
+                const QJsonDocument parsed = QJsonDocument::fromJson(info.toUtf8());
+                return parsed.isObject() ? QJsonValue(parsed.object()) : QJsonValue(info);
+            });
+        } else if (command == "metrics") {
+            replyOk(device, id, m_communication->metricsSnapshot().toJson());
+        } else if (command == "recovered" || command == "settle") {
+            if (!m_journal) {
+                replyError(device, id, "No journal");
+            } else if (command == "recovered") {
+                QJsonArray entries;
+                for (const TransactionJournal::Entry& entry : m_journal->recoveredEntries()) {
+                    QJsonObject item;
+                    item.insert("id", double(entry.id));
+                    item.insert("command", entry.command == TransactionJournal::SendBasket ? "sendBasket" : "sendPayment");
+                    item.insert("data", entry.data);
+                    item.insert("issuedAtMs", double(entry.issuedAtMs));
+                    if (entry.hasResult) {
+                        item.insert("result", entry.resultCode);
+                    }
+                    entries.append(item);
+                }
+                replyOk(device, id, entries);
+            } else {
+                QVector<quint64> ids;
+                for (const QJsonValue& value : data.toArray()) {
+                    ids.append(quint64(value.toDouble()));
+                }
+                replyOk(device, id, m_journal->settle(ids, request.value("note").toString("Settled by client")));
+            }
+        } else if (command == "openChannel") {
+            openChannel(device, id);
+        } else if (command == "subscribe") {
+            m_subscribers.insert(device);
+            replyOk(device, id, status());
+        } else {
+            replyError(device, id, "Unknown command: " + command);
+        }
+    } catch (const std::exception& e) {
+        replyError(device, id, QString::fromUtf8(e.what()));
+    }
+}
+
+/**
+ * @brief Sends the response to a request once its future has finished.
+ *
+ * The watcher is parented to the connection, so a client that disconnects
+ * while its request is running simply gets no response.
+ *
+ * @param device The client connection
+ * @param id The request id
+ * @param future The pending result
+ * @param convert Converts the result to JSON
+ */
+template <typename T, typename Convert>
+void POSService::replyWhenFinished(QIODevice* device, const QJsonValue& id, const QFuture<T>& future, Convert convert)
+{
+    auto* watcher = new QFutureWatcher<T>(device);
+    QObject::connect(watcher, &QFutureWatcher<T>::finished, device, [device, id, watcher, convert]() {
+        watcher->deleteLater();
+        try {
+            replyOk(device, id, convert(watcher->result()));
+        } catch (const std::exception& e) {
+            replyError(device, id, QString::fromUtf8(e.what()));
+        }
+    });
+    watcher->setFuture(future);
+}
+
+/**
+ * @brief Sends the response to a request without a result once it has finished.
+ *
+ * @param device The client connection
+ * @param id The request id
+ * @param future The pending request
+ */
+void POSService::replyWhenFinished(QIODevice* device, const QJsonValue& id, const QFuture<void>& future)
+{
+    auto* watcher = new QFutureWatcher<void>(device);
+    QObject::connect(watcher, &QFutureWatcher<void>::finished, device, [device, id, watcher]() {
+        watcher->deleteLater();
+        try {
+            // Rethrows the exception the request failed with
+            watcher->future().waitForFinished();
+            replyOk(device, id);
+        } catch (const std::exception& e) {
+            replyError(device, id, QString::fromUtf8(e.what()));
+        }
+    });
+    watcher->setFuture(future);
+}
+
+/**
+ * @brief Moves a client onto a shared-memory channel.
+ *
+ * The channel is a child of the local socket, which stays the control
+ * connection: when the client disconnects, the channel goes with it.
+ *
+ * @param device The client connection
+ * @param id The request id
+ */
+void POSService::openChannel(QIODevice* device, const QJsonValue& id)
+{
+    auto* socket = qobject_cast<QLocalSocket*>(device);
+    if (!socket) {
+        replyError(device, id, "Already on a shared-memory channel");
+        return;
+    }
+    if (socket->findChild<SharedMemoryChannel*>()) {
+        replyError(device, id, "Channel already open");
+        return;
+    }
+
+    const QString key = QString("%1-%2-%3")
+                            .arg(m_server.serverName())
+                            .arg(QCoreApplication::applicationPid())
+                            .arg(++m_channelCount);
+    auto* channel = new SharedMemoryChannel(socket);
+    if (!channel->create(key)) {
+        replyError(device, id, "Cannot create channel: " + channel->errorString());
+        delete channel;
+        return;
+    }
+    QObject::connect(channel, &QIODevice::readyRead, this, [this, channel]() { onReadyRead(channel); });
+    QObject::connect(channel, &QObject::destroyed, this, [this, channel]() { m_subscribers.remove(channel); });
+
+    QJsonObject result;
+    result.insert("key", key);
+    replyOk(device, id, result);
+}
+
+/**
+ * @brief Sends a successful response.
+ *
+ * @param device The client connection
+ * @param id The request id
+ * @param result The result value
+ */
+void POSService::replyOk(QIODevice* device, const QJsonValue& id, const QJsonValue& result)
+{
+    QJsonObject response;
+    response.insert("id", id);
+    response.insert("ok", true);
+    if (!result.isUndefined() && !result.isNull()) {
+        response.insert("result", result);
+    }
+    write(device, response);
+}
+
+/**
+ * @brief Sends an error response.
+ *
+ * @param device The client connection
+ * @param id The request id
+ * @param error Human-readable error text
+ */
+void POSService::replyError(QIODevice* device, const QJsonValue& id, const QString& error)
+{
+    QJsonObject response;
+    response.insert("id", id);
+    response.insert("ok", false);
+    response.insert("error", error);
+    write(device, response);
+}
+
+/**
+ * @brief Writes one JSON line to a client.
+ *
+ * @param device The client connection
+ * @param object The message
+ */
+void POSService::write(QIODevice* device, const QJsonObject& object)
+{
+    writeLine(device, QJsonDocument(object).toJson(QJsonDocument::Compact).append('\n'));
+}
+
+/**
+ * @brief Writes one framed line to a client, closing it on a short write.
+ *
+ * A partial line would corrupt the framing of every later message, so a
+ * client whose connection does not take the whole line is closed. The close
+ * is queued, since this may run while the subscriber set is being iterated.
+ *
+ * @param device The client connection
+ * @param line The line, including its terminating newline
+ */
+void POSService::writeLine(QIODevice* device, const QByteArray& line)
+{
+    if (!device->isWritable()) {
+        return;
+    }
+    if (device->write(line) != line.size()) {
+        qWarning() << "Closing client connection after a short write:" << device->errorString();
+        QMetaObject::invokeMethod(device, [device]() { device->close(); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Writes an event to every subscribed client.
+ *
+ * @param event The event message
+ */
+void POSService::broadcast(const QJsonObject& event)
+{
+    if (m_subscribers.isEmpty()) {
+        return;
+    }
+    const QByteArray line = QJsonDocument(event).toJson(QJsonDocument::Compact).append('\n');
+    for (QIODevice* device : qAsConst(m_subscribers)) {
+        writeLine(device, line);
+    }
+}
+
+/**
+ * @brief Forwards serial input to subscribed clients.
+ *
+ * @param typeCode Code indicating the type of received data
+ * @param value The data value
+ */
+void POSService::onSerialIn(int typeCode, const QString& value)
+{
+    QJsonObject event;
+    event.insert("event", "serialIn");
+    event.insert("typeCode", typeCode);
+    event.insert("value", value);
+    broadcast(event);
+}
+
+/**
+ * @brief Forwards device state changes to subscribed clients.
+ *
+ * @param isConnected Whether the device is now connected
+ * @param deviceId Identifier of the affected device
+ */
+void POSService::onDeviceStateChanged(bool isConnected, const QString& deviceId)
+{
+    QJsonObject event;
+    event.insert("event", "deviceState");
+    event.insert("connected", isConnected);
+    event.insert("deviceId", deviceId);
+    broadcast(event);
+}
+
+/**
+ * @brief Forwards connection state changes to subscribed clients.
+ *
+ * @param state The new connection state
+ */
+void POSService::onStateChanged(POSCommunication::State state)
+{
+    QJsonObject event;
+    event.insert("event", "state");
+    event.insert("state", QString::fromLatin1(QMetaEnum::fromType<POSCommunication::State>().valueToKey(state)));
+    broadcast(event);
+}
+
+/**
+ * @brief Returns the terminal status as JSON.
+ *
+ * @return Object with backend, available, ready and state members
+ */
+QJsonObject POSService::status() const
+{
+    QJsonObject object;
+    object.insert("backend", m_communication->backendName());
+    object.insert("ready", m_communication->isReady());
+    object.insert("available", m_communication->isAvailable());
+    object.insert("state",
+                  QString::fromLatin1(QMetaEnum::fromType<POSCommunication::State>().valueToKey(m_communication->state())));
+    return object;
+}
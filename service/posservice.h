@@ -0,0 +1,203 @@
+#ifndef POSSERVICE_H
+#define POSSERVICE_H
+
+/**
+ * @file posservice.h
+ * @brief Local IPC front end for running POSCommunication without a GUI
+ *
+ * This header declares the POSService class used by the headless POSService
+ * executable. Clients on the same machine connect to a QLocalServer (a named
+ * pipe on Windows, a Unix domain socket elsewhere) and exchange one JSON
+ * object per line:
+ *
+ * @code
+ * -> {"id":1,"command":"sendPayment","data":{"amount":100,"type":1}}
+ * <- {"id":1,"ok":true,"result":0}
+ * @endcode
+ *
+ * Commands: status, connect, disconnect, reconnect, sendBasket, sendBaskets,
+ * sendPayment, fiscalInfo, metrics, recovered, settle, subscribe and
+ * openChannel. recovered lists the journaled transactions a crash left open,
+ * and settle takes an array of their ids once they are confirmed. sendBaskets
+ * takes an array of baskets and answers with one {"ok","result"|"error"}
+ * object per basket. sendPayment accepts an optional "key": a payment repeated
+ * with the same key gets the original's answer instead of reaching the
+ * terminal twice. After subscribe, the client also receives {"event":...}
+ * lines for serial input, device state and connection state. openChannel
+ * returns the key of a SharedMemoryChannel that speaks the same protocol with
+ * lower latency; the socket stays open as its control connection, and the
+ * socket remains the fallback when shared memory is unavailable.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QFuture>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocalServer>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include "poscommunication.h"
+#include "transactionjournal.h"
+
+class QIODevice;
+
+/**
+ * @class POSService
+ * @brief Serves one terminal to local clients over a line-based JSON protocol
+ *
+ * Requests run asynchronously, so a slow terminal never stalls other clients;
+ * each response carries the id of its request. Lines longer than
+ * MaxRequestSize close the connection.
+ */
+class POSService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MaxRequestSize = 1024 * 1024;  ///< Longest accepted request line in bytes
+
+    /**
+     * @brief Constructor for POSService
+     * @param communication The terminal to serve
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit POSService(POSCommunication* communication, QObject* parent = nullptr);
+
+    /**
+     * @brief Serves the recovered and settle commands from a journal
+     * @param journal Open journal, or nullptr; not owned
+     */
+    void setJournal(TransactionJournal* journal);
+
+    /**
+     * @brief Starts accepting clients
+     * @param name Server name (pipe or socket name)
+     * @return true if listening, false otherwise (see errorString())
+     *
+     * A stale socket left behind by a crashed instance is removed first.
+     */
+    bool listen(const QString& name);
+
+    /**
+     * @brief Returns a description of the last listen() error
+     * @return Human-readable error text
+     */
+    QString errorString() const;
+
+private slots:
+    /**
+     * @brief Accepts pending clients
+     */
+    void onNewConnection();
+
+    /**
+     * @brief Forwards serial input to subscribed clients
+     * @param typeCode Code indicating the type of received data
+     * @param value The data value
+     */
+    void onSerialIn(int typeCode, const QString& value);
+
+    /**
+     * @brief Forwards device state changes to subscribed clients
+     * @param isConnected Whether the device is now connected
+     * @param deviceId Identifier of the affected device
+     */
+    void onDeviceStateChanged(bool isConnected, const QString& deviceId);
+
+    /**
+     * @brief Forwards connection state changes to subscribed clients
+     * @param state The new connection state
+     */
+    void onStateChanged(POSCommunication::State state);
+
+private:
+    /**
+     * @brief Reads and handles all complete request lines of a client
+     * @param device The client connection
+     */
+    void onReadyRead(QIODevice* device);
+
+    /**
+     * @brief Handles one request
+     * @param device The client connection
+     * @param line The request line without its terminator
+     */
+    void handleRequest(QIODevice* device, const QByteArray& line);
+
+    /**
+     * @brief Sends the response to a request once its future has finished
+     * @param device The client connection
+     * @param id The request id
+     * @param future The pending result
+     * @param convert Converts the result to JSON
+     */
+    template <typename T, typename Convert>
+    void replyWhenFinished(QIODevice* device, const QJsonValue& id, const QFuture<T>& future, Convert convert);
+
+    /**
+     * @brief Sends the response to a request without a result once it has finished
+     * @param device The client connection
+     * @param id The request id
+     * @param future The pending request
+     */
+    void replyWhenFinished(QIODevice* device, const QJsonValue& id, const QFuture<void>& future);
+
+    /**
+     * @brief Moves a client onto a shared-memory channel
+     * @param device The client connection; must be the local socket
+     * @param id The request id
+     */
+    void openChannel(QIODevice* device, const QJsonValue& id);
+
+    /**
+     * @brief Sends a successful response
+     * @param device The client connection
+     * @param id The request id
+     * @param result The result value
+     */
+    static void replyOk(QIODevice* device, const QJsonValue& id, const QJsonValue& result = QJsonValue());
+
+    /**
+     * @brief Sends an error response
+     * @param device The client connection
+     * @param id The request id
+     * @param error Human-readable error text
+     */
+    static void replyError(QIODevice* device, const QJsonValue& id, const QString& error);
+
+    /**
+     * @brief Writes one JSON line to a client
+     * @param device The client connection
+     * @param object The message
+     */
+    static void write(QIODevice* device, const QJsonObject& object);
+
+    /**
+     * @brief Writes one framed line to a client, closing it on a short write
+     * @param device The client connection
+     * @param line The line, including its terminating newline
+     */
+    static void writeLine(QIODevice* device, const QByteArray& line);
+
+    /**
+     * @brief Writes an event to every subscribed client
+     * @param event The event message
+     */
+    void broadcast(const QJsonObject& event);
+
+    /**
+     * @brief Returns the terminal status as JSON
+     * @return Object with backend, ready, available and state members
+     */
+    QJsonObject status() const;
+
+    QPointer<POSCommunication> m_communication;  ///< The terminal being served
+    QPointer<TransactionJournal> m_journal;      ///< Journal for recovered and settle, nullptr if none
+    QLocalServer m_server;                       ///< Listening pipe or socket
+    QSet<QIODevice*> m_subscribers;              ///< Clients that receive events
+    int m_channelCount;                          ///< Shared-memory channels created so far
+};
+
+#endif // POSSERVICE_H
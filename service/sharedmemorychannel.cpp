@@ -0,0 +1,469 @@
+/**
+ * @file sharedmemorychannel.cpp
+ * @brief Implementation of the SharedMemoryChannel class
+ *
+ * Segment layout: a Layout header followed by the client-to-service ring's
+ * bytes and then the service-to-client ring's bytes. Ring positions only
+ * grow; the byte offset is the position modulo the ring size. Head and tail
+ * live on separate cache lines so the producer and consumer do not share one.
+ *
+ * An idle reader spins for SpinIterations polls, then sets its ring's parked
+ * flag, rechecks the ring and blocks on its semaphore. A writer releases the
+ * semaphore only if it clears a set parked flag, so busy channels never
+ * enter the kernel.
+ *
+ * A writer that finds the ring full queues the rest and sets the ring's
+ * writerWaiting flag. The consumer clears it after freeing space and wakes
+ * the writer's reader thread, which moves the queued bytes into the ring.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "sharedmemorychannel.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+
+namespace {
+
+constexpr quint32 LayoutMagic = 0x504F5344;  ///< "POSD"; changed with the Ring layout
+
+/**
+ * @brief Rounds up to the next power of two
+ *
+ * @param value Value to round, at least 1
+ * @return The smallest power of two not below value
+ */
+quint32 nextPowerOfTwo(quint32 value)
+{
+    quint32 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+/**
+ * @brief One direction of the channel
+ */
+struct SharedMemoryChannel::Ring
+{
+    alignas(64) std::atomic<quint64> head;    ///< Bytes written so far (producer only)
+    alignas(64) std::atomic<quint64> tail;    ///< Bytes read so far (consumer only)
+    alignas(64) std::atomic<quint32> parked;  ///< Set while the consumer waits on its semaphore
+    std::atomic<quint32> closed;              ///< Set when the producer has closed the channel
+    std::atomic<quint32> writerWaiting;       ///< Set while the producer has bytes queued for room
+};
+
+/**
+ * @brief Header at the start of the segment
+ */
+struct SharedMemoryChannel::Layout
+{
+    quint32 magic;    ///< LayoutMagic once initialized
+    quint32 ringSize; ///< Bytes per ring
+    Ring toService;   ///< Client-to-service direction
+    Ring toClient;    ///< Service-to-client direction
+};
+
+/**
+ * @brief Constructor for the SharedMemoryChannel class.
+ *
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+SharedMemoryChannel::SharedMemoryChannel(QObject* parent)
+    : QIODevice(parent)
+    , m_in(nullptr)
+    , m_out(nullptr)
+    , m_inData(nullptr)
+    , m_outData(nullptr)
+    , m_ringSize(0)
+    , m_peerClosed(false)
+    , m_readyReadQueued(false)
+    , m_hasPending(false)
+    , m_stopping(false)
+{
+}
+
+/**
+ * @brief Destructor for the SharedMemoryChannel class.
+ */
+SharedMemoryChannel::~SharedMemoryChannel()
+{
+    shutdown();
+}
+
+/**
+ * @brief Creates a new channel.
+ *
+ * @param key Name of the shared-memory segment
+ * @param ringSize Bytes per direction
+ * @return true if the channel is open, false otherwise
+ */
+bool SharedMemoryChannel::create(const QString& key, quint32 ringSize)
+{
+    ringSize = nextPowerOfTwo(std::max<quint32>(ringSize, 4096));
+
+    m_memory.setKey(key);
+    if (!m_memory.create(int(sizeof(Layout) + 2 * quint64(ringSize)))) {
+        setErrorString(m_memory.errorString());
+        return false;
+    }
+
+    std::memset(m_memory.data(), 0, size_t(m_memory.size()));
+    Layout* layout = new (m_memory.data()) Layout();
+    layout->ringSize = ringSize;
+    layout->magic = LayoutMagic;
+
+    m_inWake = std::make_unique<QSystemSemaphore>(key + "-in", 0, QSystemSemaphore::Create);
+    m_outWake = std::make_unique<QSystemSemaphore>(key + "-out", 0, QSystemSemaphore::Create);
+    return start(true);
+}
+
+/**
+ * @brief Attaches to a channel created by the service.
+ *
+ * @param key Key passed to create()
+ * @return true if the channel is open, false otherwise
+ */
+bool SharedMemoryChannel::attach(const QString& key)
+{
+    m_memory.setKey(key);
+    if (!m_memory.attach()) {
+        setErrorString(m_memory.errorString());
+        return false;
+    }
+    const Layout* layout = static_cast<const Layout*>(m_memory.constData());
+    if (m_memory.size() < int(sizeof(Layout)) || layout->magic != LayoutMagic
+        || m_memory.size() < int(sizeof(Layout) + 2 * quint64(layout->ringSize))) {
+        setErrorString("Not a POS service channel");
+        m_memory.detach();
+        return false;
+    }
+
+    // The service's "in" direction is ours to write
+    m_inWake = std::make_unique<QSystemSemaphore>(key + "-out", 0, QSystemSemaphore::Open);
+    m_outWake = std::make_unique<QSystemSemaphore>(key + "-in", 0, QSystemSemaphore::Open);
+    return start(false);
+}
+
+/**
+ * @brief Returns the channel's key.
+ *
+ * @return Key passed to create() or attach()
+ */
+QString SharedMemoryChannel::key() const
+{
+    return m_memory.key();
+}
+
+/**
+ * @brief Wires up the rings and semaphores and starts the reader.
+ *
+ * @param server Whether this is the service side
+ * @return true on success
+ */
+bool SharedMemoryChannel::start(bool server)
+{
+    if (m_inWake->error() != QSystemSemaphore::NoError || m_outWake->error() != QSystemSemaphore::NoError) {
+        setErrorString(m_inWake->error() != QSystemSemaphore::NoError ? m_inWake->errorString()
+                                                                       : m_outWake->errorString());
+        m_inWake.reset();
+        m_outWake.reset();
+        m_memory.detach();
+        return false;
+    }
+
+    Layout* layout = static_cast<Layout*>(m_memory.data());
+    uchar* data = static_cast<uchar*>(m_memory.data()) + sizeof(Layout);
+    m_ringSize = layout->ringSize;
+    m_in = server ? &layout->toService : &layout->toClient;
+    m_out = server ? &layout->toClient : &layout->toService;
+    m_inData = server ? data : data + m_ringSize;
+    m_outData = server ? data + m_ringSize : data;
+
+    m_peerClosed = false;
+    m_pending.clear();
+    m_hasPending = false;
+    m_stopping = false;
+    m_reader = std::thread(&SharedMemoryChannel::runReader, this);
+    return QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+}
+
+/**
+ * @brief Closes the channel and tells the peer.
+ */
+void SharedMemoryChannel::close()
+{
+    shutdown();
+    QIODevice::close();
+}
+
+/**
+ * @brief Stops the reader and releases the segment.
+ */
+void SharedMemoryChannel::shutdown()
+{
+    if (!m_out) {
+        return;
+    }
+
+    {
+        // Hand over whatever still fits before telling the peer
+        QMutexLocker pendingLocker(&m_pendingMutex);
+        flushPendingLocked();
+    }
+    m_out->closed.store(1);
+    m_outWake->release();
+
+    m_stopping = true;
+    m_inWake->release();
+    if (m_reader.joinable()) {
+        m_reader.join();
+    }
+
+    {
+        QMutexLocker pendingLocker(&m_pendingMutex);
+        m_pending.clear();
+        m_hasPending = false;
+    }
+
+    m_in = m_out = nullptr;
+    m_inData = m_outData = nullptr;
+    m_inWake.reset();
+    m_outWake.reset();
+    m_memory.detach();
+
+    QMutexLocker locker(&m_bufferMutex);
+    m_peerClosed = true;
+    m_bufferFilled.wakeAll();
+}
+
+/**
+ * @brief The channel is a stream.
+ *
+ * @return true
+ */
+bool SharedMemoryChannel::isSequential() const
+{
+    return true;
+}
+
+/**
+ * @brief Returns the number of received bytes not yet read.
+ *
+ * @return Byte count
+ */
+qint64 SharedMemoryChannel::bytesAvailable() const
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_buffer.size() + QIODevice::bytesAvailable();
+}
+
+/**
+ * @brief Checks if a complete line has been received.
+ *
+ * @return true if readLine() returns a whole line
+ */
+bool SharedMemoryChannel::canReadLine() const
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_buffer.contains('\n') || QIODevice::canReadLine();
+}
+
+/**
+ * @brief Blocks until bytes arrive, without an event loop.
+ *
+ * @param msecs Timeout in milliseconds, -1 to wait forever
+ * @return true if bytes are available
+ */
+bool SharedMemoryChannel::waitForReadyRead(int msecs)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    if (m_buffer.isEmpty() && !m_peerClosed) {
+        m_bufferFilled.wait(&m_bufferMutex, msecs < 0 ? ULONG_MAX : ulong(msecs));
+    }
+    return !m_buffer.isEmpty();
+}
+
+/**
+ * @brief Reads received bytes.
+ *
+ * @param data Destination
+ * @param maxSize Capacity of data
+ * @return Bytes read, or -1 once the peer has closed and everything was read
+ */
+qint64 SharedMemoryChannel::readData(char* data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    if (m_buffer.isEmpty()) {
+        return m_peerClosed ? -1 : 0;
+    }
+    const int size = int(std::min<qint64>(maxSize, m_buffer.size()));
+    std::memcpy(data, m_buffer.constData(), size_t(size));
+    m_buffer.remove(0, size);
+    return size;
+}
+
+/**
+ * @brief Reads received bytes up to and including the next newline.
+ *
+ * @param data Destination
+ * @param maxSize Capacity of data
+ * @return Bytes read
+ */
+qint64 SharedMemoryChannel::readLineData(char* data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    const int newline = m_buffer.indexOf('\n');
+    const qint64 lineSize = newline >= 0 ? newline + 1 : m_buffer.size();
+    const int size = int(std::min(maxSize, lineSize));
+    std::memcpy(data, m_buffer.constData(), size_t(size));
+    m_buffer.remove(0, size);
+    return size;
+}
+
+/**
+ * @brief Sends bytes without blocking.
+ *
+ * Bytes go straight into the ring while nothing is queued; the rest is
+ * queued behind them. Every call either accepts all bytes or fails, so a
+ * message is never cut in half.
+ *
+ * @param data Bytes to send
+ * @param maxSize Number of bytes
+ * @return maxSize, or -1 if the channel or the peer was closed or the queue overflowed
+ */
+qint64 SharedMemoryChannel::writeData(const char* data, qint64 maxSize)
+{
+    if (!m_out || m_in->closed.load() || m_stopping) {
+        return -1;
+    }
+
+    QMutexLocker locker(&m_pendingMutex);
+    if (m_pending.size() + maxSize > MaxPendingBytes) {
+        locker.unlock();
+        setErrorString("Peer stopped reading");
+        // Not closed here: the caller is inside QIODevice::write()
+        QMetaObject::invokeMethod(this, [this]() { close(); }, Qt::QueuedConnection);
+        return -1;
+    }
+    m_pending.append(data, int(maxSize));
+    flushPendingLocked();
+    return maxSize;
+}
+
+/**
+ * @brief Moves queued bytes into the outgoing ring.
+ *
+ * Called by writers and by the reader thread when the peer has freed space.
+ * If bytes remain, writerWaiting is set and room is checked once more, since
+ * the peer may have drained the ring before it could see the flag.
+ */
+void SharedMemoryChannel::flushPendingLocked()
+{
+    const quint64 mask = m_ringSize - 1;
+    int sent = 0;
+    while (sent < m_pending.size()) {
+        const quint64 head = m_out->head.load(std::memory_order_relaxed);
+        const quint64 tail = m_out->tail.load(std::memory_order_acquire);
+        const quint64 room = m_ringSize - (head - tail);
+        if (room == 0) {
+            if (m_out->writerWaiting.exchange(1) == 0) {
+                continue;
+            }
+            break;
+        }
+
+        const quint64 count = std::min<quint64>(room, quint64(m_pending.size() - sent));
+        const quint64 offset = head & mask;
+        const quint64 first = std::min(count, m_ringSize - offset);
+        std::memcpy(m_outData + offset, m_pending.constData() + sent, size_t(first));
+        std::memcpy(m_outData, m_pending.constData() + sent + first, size_t(count - first));
+        m_out->head.store(head + count, std::memory_order_release);
+        sent += int(count);
+
+        if (m_out->parked.exchange(0)) {
+            m_outWake->release();
+        }
+    }
+    m_pending.remove(0, sent);
+    m_hasPending = !m_pending.isEmpty();
+}
+
+/**
+ * @brief Reader thread.
+ *
+ * Emissions of readyRead() are coalesced: one is queued at a time, and it
+ * covers everything received until the receiver reads.
+ */
+void SharedMemoryChannel::runReader()
+{
+    const quint64 mask = m_ringSize - 1;
+    int idlePolls = 0;
+
+    while (!m_stopping) {
+        const quint64 tail = m_in->tail.load(std::memory_order_relaxed);
+        const quint64 head = m_in->head.load(std::memory_order_acquire);
+
+        if (head != tail) {
+            const quint64 count = head - tail;
+            const quint64 offset = tail & mask;
+            const quint64 first = std::min(count, m_ringSize - offset);
+            {
+                QMutexLocker locker(&m_bufferMutex);
+                m_buffer.append(reinterpret_cast<const char*>(m_inData + offset), int(first));
+                m_buffer.append(reinterpret_cast<const char*>(m_inData), int(count - first));
+                m_bufferFilled.wakeAll();
+            }
+            m_in->tail.store(head, std::memory_order_release);
+            if (m_in->writerWaiting.exchange(0)) {
+                m_outWake->release();
+            }
+
+            if (!m_readyReadQueued.exchange(true)) {
+                QMetaObject::invokeMethod(this, [this]() {
+                    m_readyReadQueued = false;
+                    emit readyRead();
+                }, Qt::QueuedConnection);
+            }
+            idlePolls = 0;
+            continue;
+        }
+
+        if (m_hasPending && m_out->writerWaiting.load() == 0) {
+            // The peer freed space for our queued bytes
+            QMutexLocker locker(&m_pendingMutex);
+            flushPendingLocked();
+        }
+
+        if (m_in->closed.load()) {
+            {
+                QMutexLocker locker(&m_bufferMutex);
+                m_peerClosed = true;
+                m_bufferFilled.wakeAll();
+            }
+            QMetaObject::invokeMethod(this, [this]() { emit readChannelFinished(); }, Qt::QueuedConnection);
+            return;
+        }
+
+        if (++idlePolls < SpinIterations) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Park; the recheck closes the race with a writer that did not see the flag
+        m_in->parked.store(1);
+        if (m_in->head.load() != tail || m_in->closed.load() || m_stopping
+            || (m_hasPending && m_out->writerWaiting.load() == 0)) {
+            m_in->parked.store(0);
+            continue;
+        }
+        m_inWake->acquire();
+        idlePolls = 0;
+    }
+}
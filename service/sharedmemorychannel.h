@@ -0,0 +1,150 @@
+#ifndef SHAREDMEMORYCHANNEL_H
+#define SHAREDMEMORYCHANNEL_H
+
+/**
+ * @file sharedmemorychannel.h
+ * @brief Shared-memory transport between POSService and its local clients
+ *
+ * This header declares the SharedMemoryChannel class. A channel is a
+ * QSharedMemory segment holding two single-producer/single-consumer byte
+ * rings, one per direction, so a request travels from client to service
+ * without a system call while both sides are busy. The sides only fall back
+ * to a QSystemSemaphore to wake a reader that has gone idle.
+ *
+ * Channels are negotiated over POSService's local socket, which stays open
+ * as the control connection: the channel is torn down when it closes.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QString>
+#include <QSystemSemaphore>
+#include <QWaitCondition>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/**
+ * @class SharedMemoryChannel
+ * @brief Bidirectional byte stream over shared memory, usable as a QIODevice
+ *
+ * The service creates the channel and the client attaches to it by key.
+ * Writes never block: bytes that do not fit into the outgoing ring are
+ * queued and moved into it as the peer frees space, so a client that stops
+ * reading cannot stall the service's thread. Once MaxPendingBytes are
+ * queued the write fails and the channel closes. A reader thread moves
+ * incoming bytes into a buffer and emits readyRead() on the channel's
+ * thread, and waitForReadyRead() works without an event loop, so the same
+ * code serves the event-driven service and blocking command-line clients.
+ */
+class SharedMemoryChannel : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint32 DefaultRingSize = 1024 * 1024;  ///< Bytes per direction; a power of two
+    static constexpr int SpinIterations = 4000;              ///< Polls of an empty ring before parking the reader
+    static constexpr int MaxPendingBytes = 4 * 1024 * 1024;  ///< Queued outgoing bytes at which the channel closes
+
+    /**
+     * @brief Constructor for SharedMemoryChannel
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit SharedMemoryChannel(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor
+     *
+     * Closes the channel.
+     */
+    ~SharedMemoryChannel() override;
+
+    /**
+     * @brief Creates a new channel (service side)
+     * @param key Name of the shared-memory segment, unique per channel
+     * @param ringSize Bytes per direction; rounded up to a power of two
+     * @return true if the channel is open, false otherwise (see errorString())
+     */
+    bool create(const QString& key, quint32 ringSize = DefaultRingSize);
+
+    /**
+     * @brief Attaches to a channel created by the service (client side)
+     * @param key Key passed to create()
+     * @return true if the channel is open, false otherwise (see errorString())
+     */
+    bool attach(const QString& key);
+
+    /**
+     * @brief Returns the channel's key
+     * @return Key passed to create() or attach()
+     */
+    QString key() const;
+
+    /**
+     * @brief Closes the channel and tells the peer
+     */
+    void close() override;
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+    bool canReadLine() const override;
+    bool waitForReadyRead(int msecs) override;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 readLineData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    struct Ring;
+    struct Layout;
+
+    /**
+     * @brief Wires up the rings and semaphores and starts the reader
+     * @param server Whether this is the service side
+     * @return true on success
+     */
+    bool start(bool server);
+
+    /**
+     * @brief Reader thread; moves incoming bytes into m_buffer
+     */
+    void runReader();
+
+    /**
+     * @brief Stops the reader and releases the segment
+     */
+    void shutdown();
+
+    /**
+     * @brief Moves queued outgoing bytes into the ring as far as they fit (m_pendingMutex held)
+     */
+    void flushPendingLocked();
+
+    QSharedMemory m_memory;                       ///< The shared segment
+    std::unique_ptr<QSystemSemaphore> m_inWake;   ///< Wakes our parked reader
+    std::unique_ptr<QSystemSemaphore> m_outWake;  ///< Wakes the peer's parked reader
+    Ring* m_in;                                   ///< Ring we read from
+    Ring* m_out;                                  ///< Ring we write to
+    uchar* m_inData;                              ///< Bytes of m_in
+    uchar* m_outData;                             ///< Bytes of m_out
+    quint64 m_ringSize;                           ///< Bytes per ring
+
+    mutable QMutex m_bufferMutex;                 ///< Guards m_buffer and m_peerClosed
+    QWaitCondition m_bufferFilled;                ///< Signaled when bytes arrive or the peer closes
+    QByteArray m_buffer;                          ///< Received bytes not yet read
+    bool m_peerClosed;                            ///< Whether the peer has closed its side
+    std::atomic<bool> m_readyReadQueued;          ///< Whether a readyRead() emission is pending
+
+    QMutex m_pendingMutex;                        ///< Guards m_pending and writes to m_out
+    QByteArray m_pending;                         ///< Outgoing bytes waiting for room in the ring
+    std::atomic<bool> m_hasPending;               ///< Whether m_pending is non-empty
+    std::atomic<bool> m_stopping;                 ///< Tells the reader to exit
+    std::thread m_reader;                         ///< Reader thread
+};
+
+#endif // SHAREDMEMORYCHANNEL_H
@@ -0,0 +1,298 @@
+/**
+ * @file simulatedbackend.cpp
+ * @brief Implementation of the SimulatedBackend class
+ *
+ * Requests sleep for the configured latency and then succeed with result
+ * code 0. The event thread wakes up once per millisecond and fires as many
+ * events as are due, so the configured rates hold above the resolution of
+ * the system timer.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "simulatedbackend.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+const QString SimulatedDeviceId = QStringLiteral("SIM-0001");  ///< ID reported for the simulated device
+
+} // namespace
+
+/**
+ * @brief Constructor for the SimulatedBackend class.
+ *
+ * @param options Initial behaviour of the simulated terminal
+ */
+SimulatedBackend::SimulatedBackend(const Options& options)
+    : m_listener(nullptr)
+    , m_callLatencyUs(options.callLatencyUs)
+    , m_serialInPerSecond(options.serialInPerSecond)
+    , m_deviceStatePerSecond(options.deviceStatePerSecond)
+    , m_payloadLength(options.payloadLength)
+    , m_open(false)
+{
+}
+
+/**
+ * @brief Destructor for the SimulatedBackend class.
+ */
+SimulatedBackend::~SimulatedBackend()
+{
+    close();
+}
+
+/**
+ * @brief Changes the behaviour of the simulated terminal.
+ *
+ * @param options New latency and event rates
+ */
+void SimulatedBackend::setOptions(const Options& options)
+{
+    m_callLatencyUs = options.callLatencyUs;
+    m_serialInPerSecond = options.serialInPerSecond;
+    m_deviceStatePerSecond = options.deviceStatePerSecond;
+    m_payloadLength = options.payloadLength;
+}
+
+/**
+ * @brief Returns the current behaviour of the simulated terminal.
+ *
+ * @return Latency and event rates
+ */
+SimulatedBackend::Options SimulatedBackend::options() const
+{
+    Options options;
+    options.callLatencyUs = m_callLatencyUs;
+    options.serialInPerSecond = m_serialInPerSecond;
+    options.deviceStatePerSecond = m_deviceStatePerSecond;
+    options.payloadLength = m_payloadLength;
+    return options;
+}
+
+/**
+ * @brief Returns the backend name.
+ *
+ * @return "simulated"
+ */
+QString SimulatedBackend::name() const
+{
+    return QStringLiteral("simulated");
+}
+
+/**
+ * @brief Stores the listener.
+ *
+ * @param listener Receiver of events
+ */
+void SimulatedBackend::initialize(Listener* listener)
+{
+    m_listener = listener;
+}
+
+/**
+ * @brief Nothing to load; the simulation is always available.
+ *
+ * @return true
+ */
+bool SimulatedBackend::load()
+{
+    return true;
+}
+
+/**
+ * @brief Opens the simulated connection and starts the event thread.
+ *
+ * @param companyName The merchant/company identifier
+ */
+void SimulatedBackend::open(const QString& companyName)
+{
+    if (m_open) {
+        return;
+    }
+
+    simulateLatency();
+    m_companyName = companyName;
+    m_open = true;
+    m_eventThread = std::thread(&SimulatedBackend::run, this);
+    reportConnected();
+}
+
+/**
+ * @brief Closes the simulated connection and stops the event thread.
+ */
+void SimulatedBackend::close()
+{
+    m_open = false;
+    if (m_eventThread.joinable()) {
+        m_eventThread.join();
+    }
+}
+
+/**
+ * @brief Checks if the simulated connection is open.
+ *
+ * @return true if open, false otherwise
+ */
+bool SimulatedBackend::isOpen() const
+{
+    return m_open;
+}
+
+/**
+ * @brief Simulates re-establishing the connection.
+ */
+void SimulatedBackend::reconnect()
+{
+    simulateLatency();
+    reportConnected();
+}
+
+/**
+ * @brief Returns the index of the simulated device.
+ *
+ * @return 0
+ */
+int SimulatedBackend::activeDeviceIndex()
+{
+    return 0;
+}
+
+/**
+ * @brief Accepts basket data after the configured latency.
+ *
+ * @param jsonData The basket data in JSON format
+ * @return 0
+ */
+int SimulatedBackend::sendBasket(const QString& jsonData)
+{
+    Q_UNUSED(jsonData);
+    simulateLatency();
+    return 0;
+}
+
+/**
+ * @brief Accepts payment data after the configured latency.
+ *
+ * @param jsonData The payment data in JSON format
+ * @return 0
+ */
+int SimulatedBackend::sendPayment(const QString& jsonData)
+{
+    Q_UNUSED(jsonData);
+    simulateLatency();
+    return 0;
+}
+
+/**
+ * @brief Returns fixed fiscal information after the configured latency.
+ *
+ * @return JSON-formatted fiscal details of the simulated device
+ */
+QString SimulatedBackend::fiscalInfo()
+{
+    simulateLatency();
+    return QStringLiteral("{\"serialNumber\":\"SIM-0001\",\"zNo\":1,\"receiptNo\":1}");
+}
+
+/**
+ * @brief Blocks for the configured call latency.
+ *
+ * Sleeps for the bulk of the duration and spins for the last millisecond,
+ * because the system timer is far coarser than typical latencies.
+ */
+void SimulatedBackend::simulateLatency() const
+{
+    using Clock = std::chrono::steady_clock;
+    const int us = m_callLatencyUs;
+    const Clock::time_point deadline = Clock::now() + std::chrono::microseconds(us);
+
+    if (us > 2000) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us - 1000));
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Delivers a serial-in event as if the terminal had sent it.
+ *
+ * @param typeCode Code indicating the type of the data
+ * @param value The data value
+ */
+void SimulatedBackend::injectSerialIn(int typeCode, QStringView value)
+{
+    if (m_open && m_listener) {
+        m_listener->onSerialIn(typeCode, value);
+    }
+}
+
+/**
+ * @brief Delivers a device state change as if the terminal had sent it.
+ *
+ * @param isConnected Whether the device is now connected
+ * @param deviceId Identifier of the affected device
+ */
+void SimulatedBackend::injectDeviceState(bool isConnected, QStringView deviceId)
+{
+    if (m_open && m_listener) {
+        m_listener->onDeviceState(isConnected, deviceId);
+    }
+}
+
+/**
+ * @brief Reports the simulated device as connected to the listener.
+ */
+void SimulatedBackend::reportConnected()
+{
+    if (m_listener) {
+        m_listener->onDeviceState(true, SimulatedDeviceId);
+    }
+}
+
+/**
+ * @brief Event thread.
+ *
+ * Restarts its accounting whenever the rates change, so reconfiguring
+ * mid-run does not cause a burst of catch-up events.
+ */
+void SimulatedBackend::run()
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    int serialRate = -1;
+    int stateRate = -1;
+    long long serialFired = 0;
+    long long stateFired = 0;
+    QString payload;
+
+    while (m_open) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (serialRate != m_serialInPerSecond || stateRate != m_deviceStatePerSecond
+            || payload.size() != m_payloadLength) {
+            serialRate = m_serialInPerSecond;
+            stateRate = m_deviceStatePerSecond;
+            payload = QString(m_payloadLength, QLatin1Char('x'));
+            start = Clock::now();
+            serialFired = 0;
+            stateFired = 0;
+        }
+
+        if (!m_listener) {
+            continue;
+        }
+
+        const long long elapsedUs =
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+        for (const long long due = elapsedUs * serialRate / 1000000; serialFired < due; ++serialFired) {
+            m_listener->onSerialIn(static_cast<int>(serialFired % 16), payload);
+        }
+        for (const long long due = elapsedUs * stateRate / 1000000; stateFired < due; ++stateFired) {
+            reportConnected();
+        }
+    }
+}
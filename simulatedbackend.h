@@ -0,0 +1,122 @@
+#ifndef SIMULATEDBACKEND_H
+#define SIMULATEDBACKEND_H
+
+/**
+ * @file simulatedbackend.h
+ * @brief In-process POSBackend that simulates a payment terminal
+ *
+ * This header declares the SimulatedBackend class. It answers every request
+ * after a configurable latency and, while connected, fires serial-in and
+ * device-state events at configurable rates, so the layers above the backend
+ * can be run and load-tested on machines without the IntegrationHub DLL.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "posbackend.h"
+#include <atomic>
+#include <thread>
+
+/**
+ * @class SimulatedBackend
+ * @brief Terminal simulation with configurable latency and event rates
+ */
+class SimulatedBackend : public POSBackend
+{
+public:
+    /**
+     * @brief Behaviour of the simulated terminal
+     */
+    struct Options
+    {
+        int callLatencyUs = 2000;      ///< Time every request takes
+        int serialInPerSecond = 0;     ///< Serial-in events fired per second while connected
+        int deviceStatePerSecond = 0;  ///< Device-state events fired per second while connected
+        int payloadLength = 64;        ///< Characters per serial-in payload
+    };
+
+    /**
+     * @brief Constructor for SimulatedBackend
+     * @param options Initial behaviour of the simulated terminal
+     */
+    explicit SimulatedBackend(const Options& options = Options());
+
+    /**
+     * @brief Destructor
+     *
+     * Stops the event thread if the connection is still open.
+     */
+    ~SimulatedBackend() override;
+
+    /**
+     * @brief Changes the behaviour of the simulated terminal
+     * @param options New latency and event rates
+     *
+     * Safe to call from any thread; takes effect on the next request or event tick.
+     */
+    void setOptions(const Options& options);
+
+    /**
+     * @brief Returns the current behaviour of the simulated terminal
+     * @return Latency and event rates
+     */
+    Options options() const;
+
+    /**
+     * @brief Delivers a serial-in event as if the terminal had sent it
+     * @param typeCode Code indicating the type of the data
+     * @param value The data value
+     *
+     * Safe to call from any thread while the connection is open, like the
+     * DLL's callback threads; used to replay captured traffic.
+     */
+    void injectSerialIn(int typeCode, QStringView value);
+
+    /**
+     * @brief Delivers a device state change as if the terminal had sent it
+     * @param isConnected Whether the device is now connected
+     * @param deviceId Identifier of the affected device
+     *
+     * Safe to call from any thread while the connection is open.
+     */
+    void injectDeviceState(bool isConnected, QStringView deviceId);
+
+    QString name() const override;
+    void initialize(Listener* listener) override;
+    bool load() override;
+    void open(const QString& companyName) override;
+    void close() override;
+    bool isOpen() const override;
+    void reconnect() override;
+    int activeDeviceIndex() override;
+    int sendBasket(const QString& jsonData) override;
+    int sendPayment(const QString& jsonData) override;
+    QString fiscalInfo() override;
+
+private:
+    /**
+     * @brief Blocks for the configured call latency
+     */
+    void simulateLatency() const;
+
+    /**
+     * @brief Reports the simulated device as connected to the listener
+     */
+    void reportConnected();
+
+    /**
+     * @brief Event thread; fires serial-in and device-state events at the configured rates
+     */
+    void run();
+
+    Listener* m_listener;                     ///< Receiver of events
+    QString m_companyName;                    ///< Company name passed to open()
+    std::atomic<int> m_callLatencyUs;         ///< See Options::callLatencyUs
+    std::atomic<int> m_serialInPerSecond;     ///< See Options::serialInPerSecond
+    std::atomic<int> m_deviceStatePerSecond;  ///< See Options::deviceStatePerSecond
+    std::atomic<int> m_payloadLength;         ///< See Options::payloadLength
+    std::atomic<bool> m_open;                 ///< Whether the simulated connection is open
+    std::thread m_eventThread;                ///< Fires events while the connection is open
+};
+
+#endif // SIMULATEDBACKEND_H
@@ -0,0 +1,271 @@
+/**
+ * @file threadpolicy.cpp
+ * @brief Implementation of the ThreadPolicy struct
+ *
+ * Priorities go through QThread, which also works for threads Qt did not
+ * start, since every thread that emits a signal has an adopted QThread.
+ * Names and core affinity use the native APIs; on Linux, priorities other
+ * than idle only take effect under a real-time scheduling policy.
+ *
+ * Platform: Qt C++ cross-platform framework (core affinity: Windows and Linux)
+ */
+
+#include "threadpolicy.h"
+#include "poslogging.h"
+#include <QMutex>
+#include <QStringList>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Name of a priority in configure() specifications
+ */
+struct PriorityName
+{
+    const char* name;            ///< Name such as "high"
+    QThread::Priority priority;  ///< The priority
+};
+
+const PriorityName PriorityNames[] = {
+    {"idle", QThread::IdlePriority},
+    {"lowest", QThread::LowestPriority},
+    {"low", QThread::LowPriority},
+    {"normal", QThread::NormalPriority},
+    {"high", QThread::HighPriority},
+    {"highest", QThread::HighestPriority},
+    {"timecritical", QThread::TimeCriticalPriority},
+    {"inherit", QThread::InheritPriority},
+};
+
+constexpr int MaxCores = 64;  ///< Cores addressable by an affinity mask
+
+/**
+ * @brief Returns a policy that only sets a priority
+ * @param priority The priority
+ * @return The policy
+ */
+ThreadPolicy priorityPolicy(QThread::Priority priority)
+{
+    ThreadPolicy policy;
+    policy.priority = priority;
+    return policy;
+}
+
+QMutex policyMutex;  ///< Guards policies
+ThreadPolicy policies[ThreadPolicy::LaneCount] = {
+    priorityPolicy(QThread::HighPriority),
+    priorityPolicy(QThread::HighPriority),
+    ThreadPolicy(),
+};
+
+thread_local ThreadPolicy::Lane adoptedLane = ThreadPolicy::LaneCount;  ///< Lane of the calling thread
+thread_local QString adoptedName;                                      ///< Name of the calling thread
+
+/**
+ * @brief Names the calling thread for debuggers and profilers
+ * @param name The name
+ */
+void setCurrentThreadName(const QString& name)
+{
+#if defined(Q_OS_WIN)
+    // SetThreadDescription exists from Windows 10 1607 on
+    using SetThreadDescriptionFunction = HRESULT (WINAPI*)(HANDLE, PCWSTR);
+    static const auto setThreadDescription = reinterpret_cast<SetThreadDescriptionFunction>(
+        reinterpret_cast<void*>(GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription")));
+    if (setThreadDescription) {
+        setThreadDescription(GetCurrentThread(), reinterpret_cast<PCWSTR>(name.utf16()));
+    }
+#elif defined(Q_OS_LINUX)
+    // Linux thread names are limited to 15 bytes
+    pthread_setname_np(pthread_self(), name.toUtf8().left(15).constData());
+#elif defined(Q_OS_MACOS)
+    pthread_setname_np(name.toUtf8().constData());
+#else
+    Q_UNUSED(name);
+#endif
+}
+
+/**
+ * @brief Restricts the calling thread to a set of cores
+ * @param mask Bit n allows core n
+ * @return true on success
+ */
+bool setCurrentThreadAffinity(quint64 mask)
+{
+#if defined(Q_OS_WIN)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(mask)) != 0;
+#elif defined(Q_OS_LINUX)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (int core = 0; core < MaxCores && core < CPU_SETSIZE; ++core) {
+        if (mask & (quint64(1) << core)) {
+            CPU_SET(core, &cores);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+#else
+    Q_UNUSED(mask);
+    return false;
+#endif
+}
+
+} // namespace
+
+/**
+ * @brief Sets the policy of a lane.
+ *
+ * @param lane The lane
+ * @param policy The policy
+ */
+void ThreadPolicy::set(Lane lane, const ThreadPolicy& policy)
+{
+    if (lane < 0 || lane >= LaneCount) {
+        return;
+    }
+    {
+        QMutexLocker locker(&policyMutex);
+        policies[lane] = policy;
+    }
+    s_generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Returns the policy of a lane.
+ *
+ * @param lane The lane
+ * @return The policy, or a policy that changes nothing for an invalid lane
+ */
+ThreadPolicy ThreadPolicy::get(Lane lane)
+{
+    if (lane < 0 || lane >= LaneCount) {
+        return ThreadPolicy();
+    }
+    QMutexLocker locker(&policyMutex);
+    return policies[lane];
+}
+
+/**
+ * @brief Sets the policies of several lanes from a specification.
+ *
+ * @param spec Semicolon-separated lane=priority[@cores] entries
+ * @param error Receives a description of the first invalid entry, may be nullptr
+ * @return true on success
+ */
+bool ThreadPolicy::configure(const QString& spec, QString* error)
+{
+    const auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    ThreadPolicy parsed[LaneCount];
+    bool present[LaneCount] = {};
+    for (const QString& entry : spec.split(';', Qt::SkipEmptyParts)) {
+        const int equals = entry.indexOf('=');
+        if (equals < 0) {
+            return fail("Expected lane=priority[@cores]: " + entry.trimmed());
+        }
+
+        const QString laneText = entry.left(equals).trimmed();
+        int lane = 0;
+        while (lane < LaneCount && laneName(Lane(lane)) != laneText) {
+            ++lane;
+        }
+        if (lane == LaneCount) {
+            return fail("Unknown thread lane: " + laneText);
+        }
+
+        const QString value = entry.mid(equals + 1);
+        const int at = value.indexOf('@');
+        const QString priorityText = value.left(at).trimmed();
+        ThreadPolicy policy;
+        if (!priorityText.isEmpty()) {
+            const PriorityName* match = nullptr;
+            for (const PriorityName& name : PriorityNames) {
+                if (priorityText == QLatin1String(name.name)) {
+                    match = &name;
+                }
+            }
+            if (!match) {
+                return fail("Unknown thread priority: " + priorityText);
+            }
+            policy.priority = match->priority;
+        }
+        if (at >= 0) {
+            for (const QString& core : value.mid(at + 1).split(',')) {
+                bool ok = false;
+                const uint number = core.trimmed().toUInt(&ok);
+                if (!ok || number >= MaxCores) {
+                    return fail("Invalid core number: " + core.trimmed());
+                }
+                policy.affinityMask |= quint64(1) << number;
+            }
+        }
+
+        parsed[lane] = policy;
+        present[lane] = true;
+    }
+
+    for (int lane = 0; lane < LaneCount; ++lane) {
+        if (present[lane]) {
+            set(Lane(lane), parsed[lane]);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the name of a lane used by configure().
+ *
+ * @param lane The lane
+ * @return The lane name
+ */
+QString ThreadPolicy::laneName(Lane lane)
+{
+    switch (lane) {
+    case DeviceLane:   return QStringLiteral("device");
+    case CallbackLane: return QStringLiteral("callback");
+    case JournalLane:  return QStringLiteral("journal");
+    default:           return QString();
+    }
+}
+
+/**
+ * @brief Applies the current policy to the calling thread.
+ *
+ * The first call on a thread fixes its lane and name. The generation is
+ * read before the policy, so a change racing with this call is applied
+ * again on the next adopt().
+ *
+ * @param lane Lane of the calling thread, unless it already adopted one
+ * @param name Thread name; empty to use the QThread's objectName()
+ */
+void ThreadPolicy::apply(Lane lane, const QString& name)
+{
+    s_appliedGeneration = s_generation.load(std::memory_order_acquire);
+
+    if (adoptedLane == LaneCount) {
+        adoptedLane = lane;
+        adoptedName = name.isEmpty() ? QThread::currentThread()->objectName() : name;
+        if (!adoptedName.isEmpty()) {
+            setCurrentThreadName(adoptedName);
+        }
+    }
+
+    const ThreadPolicy policy = get(adoptedLane);
+    if (policy.priority != QThread::InheritPriority) {
+        QThread::currentThread()->setPriority(policy.priority);
+    }
+    if (policy.affinityMask != 0 && !setCurrentThreadAffinity(policy.affinityMask)) {
+        qCWarning(lcPosThread) << "Cannot restrict" << laneName(adoptedLane) << "thread" << adoptedName
+                               << "to cores" << QString::number(policy.affinityMask, 16).prepend("0x");
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+/**
+ * @file threadpolicy.h
+ * @brief Scheduling priority, core affinity and names of the wrapper's threads
+ *
+ * This header declares the ThreadPolicy struct. The threads of the wrapper
+ * fall into lanes: the device worker threads that run every DLL call, the
+ * DLL's threads that deliver callbacks, and the background disk writers (the
+ * journal's commit thread and the traffic capture's writer).
+ * Each lane has one process-wide policy, so payment-critical lanes can be
+ * raised above other applications on the till and kept off the cores they
+ * use, e.g. on 2-core POS hardware.
+ *
+ * Platform: Qt C++ cross-platform framework (core affinity: Windows and Linux)
+ */
+
+#include <QString>
+#include <QThread>
+#include <atomic>
+
+/**
+ * @struct ThreadPolicy
+ * @brief Priority and core affinity of the threads of one lane
+ *
+ * Threads adopt their lane's policy themselves: each one calls adopt() from
+ * its own loop, which costs a thread-local comparison unless a policy was
+ * changed since the thread last applied it. Changes therefore take effect
+ * the next time each thread wakes up, including DLL threads the wrapper did
+ * not create. adopt() also names the thread for debuggers and profilers.
+ *
+ * A thread keeps the lane it adopted first, so a device worker that also
+ * receives a callback is not reconfigured as a callback thread.
+ */
+struct ThreadPolicy
+{
+    /**
+     * @brief Class of threads sharing one policy
+     */
+    enum Lane {
+        DeviceLane,    ///< Device worker and watchdog threads; default: high priority
+        CallbackLane,  ///< DLL threads delivering serial-in and device state callbacks; default: high priority
+        JournalLane,   ///< Transaction journal commit and traffic capture writer threads; default: unchanged
+        LaneCount
+    };
+
+    QThread::Priority priority = QThread::InheritPriority;  ///< InheritPriority leaves the priority unchanged
+    quint64 affinityMask = 0;                               ///< Bit n allows core n; 0 leaves the affinity unchanged
+
+    /**
+     * @brief Sets the policy of a lane
+     * @param lane The lane
+     * @param policy Policy applied by the lane's threads from their next wake-up
+     */
+    static void set(Lane lane, const ThreadPolicy& policy);
+
+    /**
+     * @brief Returns the policy of a lane
+     * @param lane The lane
+     * @return The policy
+     */
+    static ThreadPolicy get(Lane lane);
+
+    /**
+     * @brief Sets the policies of several lanes from a specification
+     * @param spec Semicolon-separated lane=priority[@cores] entries, e.g.
+     *             "device=highest@0;callback=high@0;journal=low@1"
+     * @param error Receives a description of the first invalid entry, may be nullptr
+     * @return true if every entry was valid; nothing is changed otherwise
+     *
+     * Lanes are device, callback and journal. Priorities are idle, lowest,
+     * low, normal, high, highest, timecritical and inherit. Cores are a
+     * comma-separated list of core numbers below 64.
+     */
+    static bool configure(const QString& spec, QString* error = nullptr);
+
+    /**
+     * @brief Returns the name of a lane used by configure()
+     * @param lane The lane
+     * @return Name such as "device"
+     */
+    static QString laneName(Lane lane);
+
+    /**
+     * @brief Applies the lane's policy to the calling thread if it changed
+     * @param lane Lane of the calling thread, unless it already adopted one
+     * @param name Thread name for profilers; empty to use the QThread's objectName()
+     */
+    static void adopt(Lane lane, const QString& name = QString())
+    {
+        if (s_appliedGeneration != s_generation.load(std::memory_order_acquire)) {
+            apply(lane, name);
+        }
+    }
+
+private:
+    /**
+     * @brief Applies the current policy to the calling thread
+     * @param lane Lane of the calling thread, unless it already adopted one
+     * @param name Thread name, see adopt()
+     */
+    static void apply(Lane lane, const QString& name);
+
+    static inline std::atomic<quint32> s_generation{1};         ///< Incremented by every policy change
+    static inline thread_local quint32 s_appliedGeneration = 0;  ///< Generation last applied by this thread
+};
+
+#endif // THREADPOLICY_H
@@ -0,0 +1,336 @@
+/**
+ * @file trafficcapture.cpp
+ * @brief Implementation of the TrafficCapture class
+ *
+ * File layout, all fixed-size integers little-endian:
+ * - 16-byte header: magic "POSTRAF1", format version, reserved
+ * - records: u8 kind, varint nanoseconds since the previous record,
+ *   zigzag varint value, varint text length, UTF-8 text
+ *
+ * Varints use 7 bits per byte, low bits first, so the common record (a short
+ * gap and a small type code) costs a handful of bytes plus its payload.
+ *
+ * The writer thread and record() trade two buffers: the writer swaps the
+ * filled buffer for the one it wrote last, whose capacity is kept, so
+ * neither side allocates in the steady state. The writer runs in the
+ * journal lane, as both are background disk writers.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "trafficcapture.h"
+#include "poslogging.h"
+#include "threadpolicy.h"
+#include <QtEndian>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+const char Magic[8] = {'P', 'O', 'S', 'T', 'R', 'A', 'F', '1'};  ///< File signature
+constexpr quint32 FormatVersion = 1;                              ///< Version written to the header
+constexpr int HeaderSize = 16;                                    ///< Bytes before the first record
+
+/**
+ * @brief Appends an unsigned varint.
+ *
+ * @param out Buffer to append to
+ * @param value The value
+ */
+void appendVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+/**
+ * @brief Reads an unsigned varint.
+ *
+ * @param data Read position, advanced past the varint
+ * @param end End of the buffer
+ * @param value Receives the value
+ * @return false if the buffer ends inside the varint
+ */
+bool readVarint(const uchar*& data, const uchar* end, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (data == end) {
+            return false;
+        }
+        const uchar byte = *data++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Constructor for the TrafficCapture class.
+ *
+ * Nothing is recorded until open() is called.
+ */
+TrafficCapture::TrafficCapture()
+    : m_lastNs(0)
+    , m_count(0)
+    , m_dropped(0)
+    , m_open(false)
+    , m_stopping(false)
+{
+}
+
+/**
+ * @brief Destructor for the TrafficCapture class.
+ */
+TrafficCapture::~TrafficCapture()
+{
+    close();
+}
+
+/**
+ * @brief Creates the capture file, replacing an existing one.
+ *
+ * @param path Capture file path
+ * @return true on success, false if the file cannot be written
+ */
+bool TrafficCapture::open(const QString& path)
+{
+    close();
+
+    QMutexLocker locker(&m_mutex);
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_error = m_file.errorString();
+        qCWarning(lcPosCapture) << "Cannot create capture" << path << ":" << m_error;
+        return false;
+    }
+
+    m_buffer.clear();
+    m_buffer.reserve(FlushThreshold + 1024);
+    m_buffer.append(Magic, sizeof(Magic));
+    uchar version[8] = {};
+    qToLittleEndian<quint32>(FormatVersion, version);
+    m_buffer.append(reinterpret_cast<const char*>(version), sizeof(version));
+
+    m_lastNs = 0;
+    m_count = 0;
+    m_dropped = 0;
+    m_error.clear();
+    m_open = true;
+    m_stopping = false;
+    m_clock.start();
+    m_writer = std::thread(&TrafficCapture::runWriter, this);
+    qCInfo(lcPosCapture) << "Capturing terminal traffic to" << path;
+    return true;
+}
+
+/**
+ * @brief Writes buffered records and closes the file.
+ *
+ * Waits for the writer thread to write the rest.
+ */
+void TrafficCapture::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_open) {
+            return;
+        }
+        m_open = false;
+        m_stopping = true;
+        m_flushWanted.wakeOne();
+    }
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+    m_file.close();
+
+    QMutexLocker locker(&m_mutex);
+    qCInfo(lcPosCapture) << "Captured" << m_count << "events to" << m_file.fileName();
+    if (m_dropped > 0) {
+        qCWarning(lcPosCapture) << "Dropped" << m_dropped << "events because the disk fell behind";
+    }
+}
+
+/**
+ * @brief Checks if the capture is open.
+ *
+ * @return true if recording
+ */
+bool TrafficCapture::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_open;
+}
+
+/**
+ * @brief Returns a description of the last file error.
+ *
+ * @return The error text
+ */
+QString TrafficCapture::errorString() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_error;
+}
+
+/**
+ * @brief Appends one event.
+ *
+ * The payload is encoded before the lock is taken, so concurrent callers
+ * only serialize on the timestamp and a buffer append; the file is written
+ * by the writer thread.
+ *
+ * @param kind What happened
+ * @param value Type code or connection flag
+ * @param text Payload
+ */
+void TrafficCapture::record(Kind kind, int value, QStringView text)
+{
+    const QByteArray utf8 = text.toUtf8();
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) {
+        return;
+    }
+    if (m_buffer.size() + utf8.size() > MaxBufferBytes) {
+        // The next record's time delta still counts from the last one kept
+        ++m_dropped;
+        return;
+    }
+
+    const int before = m_buffer.size();
+    const qint64 now = m_clock.nsecsElapsed();
+    m_buffer.append(char(kind));
+    appendVarint(m_buffer, quint64(now - m_lastNs));
+    appendVarint(m_buffer, (quint32(value) << 1) ^ quint32(value >> 31));
+    appendVarint(m_buffer, quint64(utf8.size()));
+    m_buffer.append(utf8);
+    m_lastNs = now;
+    ++m_count;
+
+    if (before < FlushThreshold && m_buffer.size() >= FlushThreshold) {
+        m_flushWanted.wakeOne();
+    }
+}
+
+/**
+ * @brief Returns the number of events recorded since open().
+ *
+ * @return Event count
+ */
+quint64 TrafficCapture::recordedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_count;
+}
+
+/**
+ * @brief Returns the number of events dropped since open().
+ *
+ * @return Dropped event count
+ */
+quint64 TrafficCapture::droppedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+/**
+ * @brief Writes the buffer whenever it fills or the flush interval passes.
+ *
+ * A failed write is logged and the block dropped, so a full disk costs the
+ * capture but never blocks the terminal.
+ */
+void TrafficCapture::runWriter()
+{
+    QByteArray block;
+    block.reserve(FlushThreshold + 1024);
+
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        ThreadPolicy::adopt(ThreadPolicy::JournalLane, QStringLiteral("POSCapture"));
+        if (!m_stopping && m_buffer.size() < FlushThreshold) {
+            m_flushWanted.wait(&m_mutex, FlushIntervalMs);
+        }
+        const bool stopping = m_stopping;
+        std::swap(block, m_buffer);
+        locker.unlock();
+
+        if (!block.isEmpty() && (m_file.write(block) != block.size() || !m_file.flush())) {
+            const QString error = m_file.errorString();
+            qCWarning(lcPosCapture) << "Cannot write capture" << m_file.fileName() << ":" << error;
+            locker.relock();
+            m_error = error;
+            locker.unlock();
+        }
+        // Keeps the capacity, so the next swap hands record() a buffer that needs no allocation
+        block.resize(0);
+
+        if (stopping) {
+            return;
+        }
+        locker.relock();
+    }
+}
+
+/**
+ * @brief Reads a capture file.
+ *
+ * @param path Capture file path
+ * @param events Receives the events in recorded order
+ * @param error Receives a description of the failure, may be nullptr
+ * @return true on success
+ */
+bool TrafficCapture::load(const QString& path, QVector<Event>& events, QString* error)
+{
+    const auto fail = [error](const QString& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    const QByteArray content = file.readAll();
+    if (content.size() < HeaderSize || std::memcmp(content.constData(), Magic, sizeof(Magic)) != 0
+        || qFromLittleEndian<quint32>(content.constData() + 8) != FormatVersion) {
+        return fail(path + " is not a traffic capture");
+    }
+
+    events.clear();
+    const uchar* data = reinterpret_cast<const uchar*>(content.constData()) + HeaderSize;
+    const uchar* const end = reinterpret_cast<const uchar*>(content.constData()) + content.size();
+    qint64 timeNs = 0;
+    while (data < end) {
+        const uchar kind = *data++;
+        quint64 delta = 0;
+        quint64 zigzag = 0;
+        quint64 length = 0;
+        if (kind >= KindCount || !readVarint(data, end, delta) || !readVarint(data, end, zigzag)
+            || !readVarint(data, end, length) || length > quint64(end - data)) {
+            qCWarning(lcPosCapture) << "Capture" << path << "ends with a torn record after" << events.size() << "events";
+            break;
+        }
+
+        Event event;
+        event.kind = Kind(kind);
+        timeNs += qint64(delta);
+        event.timeNs = timeNs;
+        event.value = int(qint32(quint32(zigzag >> 1) ^ (0u - quint32(zigzag & 1))));
+        event.text = QString::fromUtf8(reinterpret_cast<const char*>(data), int(length));
+        data += length;
+        events.append(std::move(event));
+    }
+    return true;
+}
@@ -0,0 +1,156 @@
+#ifndef TRAFFICCAPTURE_H
+#define TRAFFICCAPTURE_H
+
+/**
+ * @file trafficcapture.h
+ * @brief Binary capture of terminal traffic for offline replay
+ *
+ * This header declares the TrafficCapture class. While a capture is attached
+ * to a POSCommunication, every request sent to the terminal and every event
+ * received from it is appended to a compact binary file with a nanosecond
+ * timestamp. POSReplay reads the file back and reproduces the traffic against
+ * the simulated terminal, at the recorded pace or faster.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <QWaitCondition>
+#include <thread>
+
+/**
+ * @class TrafficCapture
+ * @brief Append-only recorder of requests and callbacks
+ *
+ * Records are encoded into a memory buffer under a short lock. A writer
+ * thread swaps the buffer out and writes it to the file without the lock,
+ * once FlushThreshold bytes are buffered and otherwise every FlushIntervalMs,
+ * so recording never waits for the disk. Records that would grow the buffer
+ * beyond MaxBufferBytes, because the disk cannot keep up, are dropped and
+ * counted. Timestamps are taken under the same lock and are therefore
+ * ordered like the records. Thread-safe; records arrive from the device
+ * worker and the backend's callback threads.
+ *
+ * File layout: a 16-byte header ("POSTRAF1", format version, reserved)
+ * followed by records of one kind byte and varint-encoded time since the
+ * previous record, value and UTF-8 text length, then the text itself.
+ */
+class TrafficCapture
+{
+public:
+    static constexpr int FlushThreshold = 64 * 1024;       ///< Buffered bytes that trigger a file write
+    static constexpr int FlushIntervalMs = 1000;           ///< Longest time a record stays buffered
+    static constexpr int MaxBufferBytes = 64 * FlushThreshold;  ///< Buffered bytes beyond which records are dropped
+
+    /**
+     * @brief Kind of a recorded event
+     */
+    enum Kind : quint8 {
+        SendBasket,     ///< sendBasket; text is the basket JSON
+        SendPayment,    ///< sendPayment; text is the payment JSON
+        GetFiscalInfo,  ///< Fiscal info query that reached the terminal
+        SerialIn,       ///< Serial-in callback; value is the type code
+        DeviceState,    ///< Device state callback; value is 1 if connected, text is the device ID
+        KindCount
+    };
+
+    /**
+     * @brief One recorded event
+     */
+    struct Event
+    {
+        Kind kind = SendBasket;  ///< What happened
+        qint64 timeNs = 0;       ///< Time since the capture was opened
+        int value = 0;           ///< Type code or connection flag, see Kind
+        QString text;            ///< Payload, see Kind
+    };
+
+    TrafficCapture();
+
+    /**
+     * @brief Destructor
+     *
+     * Writes buffered records and closes the file.
+     */
+    ~TrafficCapture();
+
+    /**
+     * @brief Creates the capture file, replacing an existing one
+     * @param path Capture file path
+     * @return true on success, false if the file cannot be written (see errorString())
+     */
+    bool open(const QString& path);
+
+    /**
+     * @brief Writes buffered records and closes the file
+     */
+    void close();
+
+    /**
+     * @brief Checks if the capture is open
+     * @return true if open() succeeded and close() has not been called since
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Returns a description of the last file error
+     * @return The error text
+     */
+    QString errorString() const;
+
+    /**
+     * @brief Appends one event; does nothing if the capture is not open
+     * @param kind What happened
+     * @param value Type code or connection flag, see Kind
+     * @param text Payload, see Kind
+     */
+    void record(Kind kind, int value = 0, QStringView text = QStringView());
+
+    /**
+     * @brief Returns the number of events recorded since open()
+     * @return Event count, excluding dropped events
+     */
+    quint64 recordedCount() const;
+
+    /**
+     * @brief Returns the number of events dropped since open() because the disk fell behind
+     * @return Dropped event count
+     */
+    quint64 droppedCount() const;
+
+    /**
+     * @brief Reads a capture file
+     * @param path Capture file path
+     * @param events Receives the events in recorded order
+     * @param error Receives a description of the failure, may be nullptr
+     * @return true on success; a record torn by a crash ends the capture early
+     */
+    static bool load(const QString& path, QVector<Event>& events, QString* error = nullptr);
+
+private:
+    /**
+     * @brief Writer thread; writes the buffer when it fills or the flush interval passes
+     */
+    void runWriter();
+
+    mutable QMutex m_mutex;         ///< Guards all members below except m_file
+    QWaitCondition m_flushWanted;   ///< Wakes the writer
+    QByteArray m_buffer;            ///< Encoded records not yet written
+    QElapsedTimer m_clock;          ///< Started by open()
+    qint64 m_lastNs;                ///< Timestamp of the previous record
+    quint64 m_count;                ///< Records since open()
+    quint64 m_dropped;              ///< Records dropped since open()
+    bool m_open;                    ///< Whether records are accepted
+    bool m_stopping;                ///< Tells the writer to write the rest and exit
+    QString m_error;                ///< Description of the last file error
+    QFile m_file;                   ///< Capture file; used by the writer thread while open
+    std::thread m_writer;           ///< Writer thread
+};
+
+#endif // TRAFFICCAPTURE_H
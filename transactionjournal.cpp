@@ -0,0 +1,745 @@
+/**
+ * @file transactionjournal.cpp
+ * @brief Implementation of the TransactionJournal class
+ *
+ * File layout, all integers little-endian:
+ * - 16-byte header: magic "POSJRNL1", format version, reserved
+ * - records: u32 body length, u32 CRC-32 of the body, then the body
+ *   (u8 type, 3 reserved bytes, i32 code, u64 transaction ID,
+ *   i64 timestamp in ms since epoch, UTF-8 text)
+ *
+ * The file is created at full size, so unused space reads as zeros and the
+ * scan stops at the first zero length. A record whose checksum does not match
+ * was torn by a crash and ends the scan as well.
+ *
+ * Syncing runs without the append lock. The map lock only keeps the mapping
+ * alive while it is synced; it is taken for writing to remap the file during
+ * compaction and close.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include "transactionjournal.h"
+#include "poscommunication.h"
+#include "poslogging.h"
+#include "threadpolicy.h"
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char Magic[8] = {'P', 'O', 'S', 'J', 'R', 'N', 'L', '1'};  ///< File signature
+constexpr quint32 FormatVersion = 1;                              ///< Version written to the header
+constexpr qint64 HeaderSize = 16;                                 ///< Bytes before the first record
+constexpr qint64 RecordHeaderSize = 8;                            ///< Length and checksum
+constexpr qint64 BodyFixedSize = 24;                              ///< Body bytes before the text
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3) of a buffer.
+ *
+ * @param data Start of the buffer
+ * @param size Length in bytes
+ * @return The checksum
+ */
+quint32 crc32(const uchar* data, qint64 size)
+{
+    static const auto table = []() {
+        std::array<quint32, 256> entries{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (qint64 i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Writes a mapped range and the file metadata to disk.
+ *
+ * @param file The mapped file
+ * @param map Start of the mapping
+ * @param from First byte to sync
+ * @param to End of the range to sync
+ * @return true on success
+ */
+bool syncRange(QFile& file, uchar* map, qint64 from, qint64 to)
+{
+    if (to <= from) {
+        return true;
+    }
+#ifdef Q_OS_WIN
+    return FlushViewOfFile(map + from, SIZE_T(to - from))
+        && FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    Q_UNUSED(file);
+    // msync needs a page-aligned start address
+    const qint64 page = sysconf(_SC_PAGESIZE);
+    const qint64 aligned = from - from % page;
+    return msync(map + aligned, size_t(to - aligned), MS_SYNC) == 0;
+#endif
+}
+
+/**
+ * @brief Serializes one record.
+ *
+ * @param out Destination, at least RecordHeaderSize + BodyFixedSize + text size bytes
+ * @param type Record type
+ * @param code Record code
+ * @param id Transaction ID
+ * @param timestampMs Record time
+ * @param text UTF-8 payload
+ * @return Bytes written
+ */
+qint64 encodeRecord(uchar* out, quint8 type, qint32 code, quint64 id, qint64 timestampMs, const QByteArray& text)
+{
+    uchar* body = out + RecordHeaderSize;
+    body[0] = type;
+    body[1] = body[2] = body[3] = 0;
+    qToLittleEndian<qint32>(code, body + 4);
+    qToLittleEndian<quint64>(id, body + 8);
+    qToLittleEndian<qint64>(timestampMs, body + 16);
+    std::memcpy(body + BodyFixedSize, text.constData(), size_t(text.size()));
+
+    const qint64 bodySize = BodyFixedSize + text.size();
+    qToLittleEndian<quint32>(quint32(bodySize), out);
+    qToLittleEndian<quint32>(crc32(body, bodySize), out + 4);
+    return RecordHeaderSize + bodySize;
+}
+
+} // namespace
+
+/**
+ * @brief Constructor for the TransactionJournal class.
+ *
+ * @param parent The parent QObject for memory management (can be nullptr)
+ */
+TransactionJournal::TransactionJournal(QObject* parent)
+    : QObject(parent)
+    , m_map(nullptr)
+    , m_capacity(0)
+    , m_writeOffset(0)
+    , m_syncedOffset(0)
+    , m_mapGeneration(0)
+    , m_nextId(1)
+    , m_firstSessionId(1)
+    , m_commitIntervalMs(DefaultCommitIntervalMs)
+    , m_stopping(false)
+{
+    qRegisterMetaType<TransactionJournal::Entry>();
+    qRegisterMetaType<QVector<TransactionJournal::Entry>>();
+}
+
+/**
+ * @brief Destructor for the TransactionJournal class.
+ */
+TransactionJournal::~TransactionJournal()
+{
+    close();
+}
+
+/**
+ * @brief Opens or creates the journal and recovers its open transactions.
+ *
+ * @param path Journal file path
+ * @param capacity File size used when creating the journal
+ * @return true on success, false otherwise
+ */
+bool TransactionJournal::open(const QString& path, qint64 capacity)
+{
+    close();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_path = path;
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            qCWarning(lcPosJournal) << "Cannot open journal" << path << ":" << m_file.errorString();
+            return false;
+        }
+
+        if (m_file.size() < HeaderSize) {
+            if (!m_file.resize(std::max(capacity, HeaderSize + 4096))) {
+                qCWarning(lcPosJournal) << "Cannot size journal" << path << ":" << m_file.errorString();
+                m_file.close();
+                return false;
+            }
+            uchar header[HeaderSize] = {};
+            std::memcpy(header, Magic, sizeof(Magic));
+            qToLittleEndian<quint32>(FormatVersion, header + 8);
+            m_file.write(reinterpret_cast<const char*>(header), HeaderSize);
+            m_file.flush();
+        }
+
+        m_open.clear();
+        m_recovered.clear();
+        m_nextId = 1;
+        if (!mapAndScanLocked()) {
+            m_file.close();
+            return false;
+        }
+
+        // Only transactions of this session can receive serial-in outcomes
+        m_firstSessionId = m_nextId;
+        for (const auto& entry : m_open) {
+            m_recovered.append(entry.first);
+        }
+        if (!m_recovered.isEmpty()) {
+            qCWarning(lcPosJournal) << "Recovered" << m_recovered.size() << "unsettled transactions from" << path;
+        }
+
+        m_stopping = false;
+    }
+
+    m_committer = std::thread(&TransactionJournal::runCommitter, this);
+    return true;
+}
+
+/**
+ * @brief Syncs outstanding records and closes the file.
+ */
+void TransactionJournal::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_commitWanted.wakeAll();
+    }
+    if (m_committer.joinable()) {
+        m_committer.join();
+    }
+
+    commitPending();
+
+    QMutexLocker locker(&m_mutex);
+    QWriteLocker mapLocker(&m_mapLock);
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+    ++m_mapGeneration;
+}
+
+/**
+ * @brief Checks if the journal is open.
+ *
+ * @return true if open
+ */
+bool TransactionJournal::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_map != nullptr;
+}
+
+/**
+ * @brief Sets the group-commit window.
+ *
+ * @param ms Longest time a record stays unsynced
+ */
+void TransactionJournal::setCommitInterval(int ms)
+{
+    QMutexLocker locker(&m_mutex);
+    m_commitIntervalMs = std::max(0, ms);
+}
+
+/**
+ * @brief Returns the group-commit window.
+ *
+ * @return Interval in milliseconds
+ */
+int TransactionJournal::commitIntervalMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_commitIntervalMs;
+}
+
+/**
+ * @brief Sets which serial-in events complete a payment.
+ *
+ * @param filter Returns true for events that carry the terminal's outcome
+ */
+void TransactionJournal::setOutcomeFilter(OutcomeFilter filter)
+{
+    QMutexLocker locker(&m_mutex);
+    m_outcomeFilter = std::move(filter);
+}
+
+/**
+ * @brief Journals a command before it is sent to the terminal.
+ *
+ * @param command Kind of command
+ * @param data JSON sent to the terminal
+ * @return Transaction ID, or 0 if the journal is not open
+ */
+quint64 TransactionJournal::beginTransaction(Command command, const QString& data)
+{
+    quint64 id = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_map) {
+            return 0;
+        }
+        id = m_nextId++;
+        if (!appendLocked(Issued, id, command, data)) {
+            return 0;
+        }
+    }
+    scheduleCommit();
+    return id;
+}
+
+/**
+ * @brief Journals the result code of the DLL call.
+ *
+ * @param id Transaction ID from beginTransaction()
+ * @param resultCode Value returned by the terminal
+ */
+void TransactionJournal::recordResult(quint64 id, int resultCode)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_map || !appendLocked(Result, id, resultCode, QStringView())) {
+            return;
+        }
+    }
+    scheduleCommit();
+}
+
+/**
+ * @brief Journals that a DLL call threw.
+ *
+ * @param id Transaction ID from beginTransaction()
+ * @param error Error description
+ */
+void TransactionJournal::recordFailure(quint64 id, const QString& error)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_map || !appendLocked(Failed, id, 0, error)) {
+            return;
+        }
+    }
+    scheduleCommit();
+}
+
+/**
+ * @brief Offers a serial-in event as the outcome of the oldest open payment.
+ *
+ * Runs on the backend's callback thread. Costs one uncontended lock when no
+ * payment is waiting for its outcome.
+ *
+ * @param typeCode Code indicating the type of received data
+ * @param value The data value
+ * @return true if the event completed a payment
+ */
+bool TransactionJournal::recordSerialIn(int typeCode, QStringView value)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_map || !m_outcomeFilter) {
+            return false;
+        }
+
+        auto it = m_open.lower_bound(m_firstSessionId);
+        while (it != m_open.end() && !(it->second.command == SendPayment && it->second.hasResult)) {
+            ++it;
+        }
+        if (it == m_open.end() || !m_outcomeFilter(typeCode, value)) {
+            return false;
+        }
+        if (!appendLocked(Outcome, it->first, typeCode, value)) {
+            return false;
+        }
+    }
+    scheduleCommit();
+    return true;
+}
+
+/**
+ * @brief Returns the transactions recovered by open() that are still unsettled.
+ *
+ * @return Entries in the order they were issued
+ */
+QVector<TransactionJournal::Entry> TransactionJournal::recoveredEntries() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Entry> entries;
+    entries.reserve(m_recovered.size());
+    for (const quint64 id : m_recovered) {
+        const auto it = m_open.find(id);
+        if (it != m_open.end()) {
+            entries.append(it->second);
+        }
+    }
+    return entries;
+}
+
+/**
+ * @brief Fetches the fiscal info to check all recovered transactions against.
+ *
+ * Nothing is settled here: the fiscal info does not tell which transactions
+ * it covers, so only the application can match them.
+ *
+ * @param communication Connected terminal to query
+ */
+void TransactionJournal::reconcile(POSCommunication* communication)
+{
+    if (recoveredEntries().isEmpty()) {
+        return;
+    }
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    QObject::connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+
+        QString fiscalInfo;
+        try {
+            fiscalInfo = watcher->result();
+        } catch (const std::exception& e) {
+            qCWarning(lcPosJournal) << "Reconciliation query failed:" << e.what();
+            emit reconcileFailed(QString::fromUtf8(e.what()));
+            return;
+        }
+
+        const QVector<Entry> entries = recoveredEntries();
+        if (!entries.isEmpty()) {
+            emit reconciliationReady(entries, fiscalInfo);
+        }
+    });
+    watcher->setFuture(communication->getFiscalInfoAsync());
+}
+
+/**
+ * @brief Marks transactions as settled once the application has confirmed them.
+ *
+ * @param ids Transaction IDs
+ * @param evidence Text stored with the settlement
+ * @return Number of transactions settled
+ */
+int TransactionJournal::settle(const QVector<quint64>& ids, const QString& evidence)
+{
+    int settled = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_map) {
+            return 0;
+        }
+        for (const quint64 id : ids) {
+            if (m_open.find(id) != m_open.end() && appendLocked(Reconciled, id, 0, evidence)) {
+                m_recovered.removeOne(id);
+                ++settled;
+            }
+        }
+    }
+    if (settled > 0) {
+        commitPending();
+        qCInfo(lcPosJournal) << "Settled" << settled << "transactions";
+    }
+    return settled;
+}
+
+/**
+ * @brief Syncs all appended records to disk.
+ *
+ * @return true on success
+ */
+bool TransactionJournal::sync()
+{
+    return commitPending();
+}
+
+/**
+ * @brief Appends a record and applies it to the open transactions.
+ *
+ * Compacts, and if necessary grows, the file when the record does not fit.
+ *
+ * @param type Record type
+ * @param id Transaction ID
+ * @param code Command, result or type code, depending on the type
+ * @param text Payload text
+ * @return true on success
+ */
+bool TransactionJournal::appendLocked(RecordType type, quint64 id, qint32 code, QStringView text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    const qint64 size = RecordHeaderSize + BodyFixedSize + utf8.size();
+
+    if (m_writeOffset + size > m_capacity && !compactLocked(size)) {
+        return false;
+    }
+
+    const qint64 timestampMs = QDateTime::currentMSecsSinceEpoch();
+    m_writeOffset += encodeRecord(m_map + m_writeOffset, type, code, id, timestampMs, utf8);
+    applyLocked(type, id, code, timestampMs, type == Issued ? QString::fromUtf8(utf8) : QString());
+    return true;
+}
+
+/**
+ * @brief Applies a record to the open transactions.
+ *
+ * @param type Record type
+ * @param id Transaction ID
+ * @param code Record code
+ * @param timestampMs Record time
+ * @param text Payload of Issued records
+ */
+void TransactionJournal::applyLocked(RecordType type, quint64 id, qint32 code, qint64 timestampMs, const QString& text)
+{
+    m_nextId = std::max(m_nextId, id + 1);
+
+    switch (type) {
+    case Issued: {
+        Entry& entry = m_open[id];
+        entry.id = id;
+        entry.command = Command(code);
+        entry.data = text;
+        entry.issuedAtMs = timestampMs;
+        break;
+    }
+    case Result: {
+        const auto it = m_open.find(id);
+        if (it == m_open.end()) {
+            break;
+        }
+        // Baskets are settled by the call itself; payments wait for their outcome
+        if (it->second.command == SendBasket) {
+            m_open.erase(it);
+        } else {
+            it->second.hasResult = true;
+            it->second.resultCode = code;
+        }
+        break;
+    }
+    case Failed:
+    case Outcome:
+    case Reconciled:
+        m_open.erase(id);
+        break;
+    }
+}
+
+/**
+ * @brief Rewrites the file with the open transactions only.
+ *
+ * The new file is written next to the old one and atomically replaces it,
+ * so a crash during compaction leaves one of the two intact.
+ *
+ * @param required Bytes that must fit after compaction
+ * @return true on success
+ */
+bool TransactionJournal::compactLocked(qint64 required)
+{
+    QByteArray image(int(HeaderSize), '\0');
+    std::memcpy(image.data(), Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(FormatVersion, image.data() + 8);
+
+    for (const auto& open : m_open) {
+        const Entry& entry = open.second;
+        const QByteArray data = entry.data.toUtf8();
+        const qint64 offset = image.size();
+        image.resize(int(offset + RecordHeaderSize + BodyFixedSize + data.size()));
+        encodeRecord(reinterpret_cast<uchar*>(image.data()) + offset, Issued, entry.command, entry.id,
+                     entry.issuedAtMs, data);
+        if (entry.hasResult) {
+            const qint64 resultOffset = image.size();
+            image.resize(int(resultOffset + RecordHeaderSize + BodyFixedSize));
+            encodeRecord(reinterpret_cast<uchar*>(image.data()) + resultOffset, Result, entry.resultCode,
+                         entry.id, entry.issuedAtMs, QByteArray());
+        }
+    }
+
+    // Grow if the open transactions alone fill more than half the file
+    qint64 capacity = m_capacity;
+    while (image.size() + required > capacity / 2) {
+        capacity *= 2;
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcPosJournal) << "Cannot compact journal" << m_path << ":" << file.errorString();
+        return false;
+    }
+    file.write(image);
+    const QByteArray zeros(64 * 1024, '\0');
+    for (qint64 written = image.size(); written < capacity; written += zeros.size()) {
+        file.write(zeros.constData(), std::min<qint64>(zeros.size(), capacity - written));
+    }
+
+    // Windows cannot replace a file that is still open and mapped
+    QWriteLocker mapLocker(&m_mapLock);
+    syncRange(m_file, m_map, m_syncedOffset, m_writeOffset);
+    m_file.unmap(m_map);
+    m_map = nullptr;
+    m_file.close();
+    ++m_mapGeneration;
+
+    const bool committed = file.commit();
+    if (!committed) {
+        qCWarning(lcPosJournal) << "Cannot compact journal" << m_path << ":" << file.errorString();
+    }
+
+    // Rescan whichever file is now in place
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qCWarning(lcPosJournal) << "Cannot reopen journal" << m_path << ":" << m_file.errorString();
+        return false;
+    }
+    m_open.clear();
+    if (!mapAndScanLocked()) {
+        m_file.close();
+        return false;
+    }
+    return committed;
+}
+
+/**
+ * @brief Maps the file and scans it.
+ *
+ * @return true on success
+ */
+bool TransactionJournal::mapAndScanLocked()
+{
+    m_capacity = m_file.size();
+    m_map = m_file.map(0, m_capacity);
+    if (!m_map) {
+        qCWarning(lcPosJournal) << "Cannot map journal" << m_path << ":" << m_file.errorString();
+        return false;
+    }
+    if (std::memcmp(m_map, Magic, sizeof(Magic)) != 0
+        || qFromLittleEndian<quint32>(m_map + 8) != FormatVersion) {
+        qCWarning(lcPosJournal) << m_path << "is not a transaction journal";
+        m_file.unmap(m_map);
+        m_map = nullptr;
+        return false;
+    }
+
+    qint64 offset = HeaderSize;
+    while (offset + RecordHeaderSize + BodyFixedSize <= m_capacity) {
+        const quint32 bodySize = qFromLittleEndian<quint32>(m_map + offset);
+        const uchar* body = m_map + offset + RecordHeaderSize;
+        if (bodySize < BodyFixedSize || offset + RecordHeaderSize + bodySize > m_capacity
+            || crc32(body, bodySize) != qFromLittleEndian<quint32>(m_map + offset + 4)) {
+            break;
+        }
+
+        const RecordType type = RecordType(body[0]);
+        const qint32 code = qFromLittleEndian<qint32>(body + 4);
+        const quint64 id = qFromLittleEndian<quint64>(body + 8);
+        const qint64 timestampMs = qFromLittleEndian<qint64>(body + 16);
+        const QString text = type == Issued
+            ? QString::fromUtf8(reinterpret_cast<const char*>(body + BodyFixedSize), int(bodySize - BodyFixedSize))
+            : QString();
+        applyLocked(type, id, code, timestampMs, text);
+        offset += RecordHeaderSize + bodySize;
+    }
+
+    // Clear a torn tail so it cannot be mistaken for records later
+    const qint64 tail = std::min<qint64>(m_capacity - offset, RecordHeaderSize + BodyFixedSize + 64 * 1024);
+    if (tail > 0 && (offset + 4 > m_capacity || qFromLittleEndian<quint32>(m_map + offset) != 0)) {
+        std::memset(m_map + offset, 0, size_t(tail));
+    }
+
+    m_writeOffset = offset;
+    m_syncedOffset = offset;
+    return true;
+}
+
+/**
+ * @brief Wakes the committer, or syncs right away without a commit window.
+ */
+void TransactionJournal::scheduleCommit()
+{
+    int interval;
+    {
+        QMutexLocker locker(&m_mutex);
+        interval = m_commitIntervalMs;
+        if (interval > 0) {
+            m_commitWanted.wakeOne();
+        }
+    }
+    if (interval == 0) {
+        commitPending();
+    }
+}
+
+/**
+ * @brief Syncs the records appended since the last sync.
+ *
+ * The append lock is only held to read the range; the sync itself runs under
+ * the map lock, so appends continue while the disk is busy.
+ *
+ * @return true on success
+ */
+bool TransactionJournal::commitPending()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_map || m_writeOffset == m_syncedOffset) {
+        return true;
+    }
+    const qint64 from = m_syncedOffset;
+    const qint64 to = m_writeOffset;
+    const quint64 generation = m_mapGeneration;
+    uchar* const map = m_map;
+
+    m_mapLock.lockForRead();
+    locker.unlock();
+    const bool synced = syncRange(m_file, map, from, to);
+    m_mapLock.unlock();
+
+    if (!synced) {
+        qCWarning(lcPosJournal) << "Failed to sync journal" << m_path;
+        return false;
+    }
+
+    locker.relock();
+    if (generation == m_mapGeneration) {
+        m_syncedOffset = std::max(m_syncedOffset, to);
+    }
+    return true;
+}
+
+/**
+ * @brief Group-commit thread.
+ *
+ * Sleeps until records are appended, then waits out the commit window so
+ * that every record appended meanwhile shares the same sync.
+ */
+void TransactionJournal::runCommitter()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_stopping) {
+        ThreadPolicy::adopt(ThreadPolicy::JournalLane, QStringLiteral("POSJournal"));
+        if (m_writeOffset == m_syncedOffset) {
+            m_commitWanted.wait(&m_mutex);
+            continue;
+        }
+
+        const int interval = m_commitIntervalMs;
+        locker.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+        commitPending();
+        locker.relock();
+    }
+}
@@ -0,0 +1,306 @@
+#ifndef TRANSACTIONJOURNAL_H
+#define TRANSACTIONJOURNAL_H
+
+/**
+ * @file transactionjournal.h
+ * @brief Crash-safe write-ahead journal of basket and payment commands
+ *
+ * This header declares the TransactionJournal class. Every basket and payment
+ * sent to the terminal is appended to a memory-mapped, append-only file before
+ * the DLL call, followed by the call's result and the outcome reported by the
+ * terminal. After a crash, open() finds the transactions that never received
+ * an outcome and reconcile() fetches the fiscal info to check all of them
+ * against with a single query; the application settles the ones it confirmed.
+ *
+ * Platform: Qt C++ cross-platform framework
+ */
+
+#include <QFile>
+#include <QMutex>
+#include <QObject>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+#include <map>
+#include <thread>
+
+class POSCommunication;
+
+/**
+ * @class TransactionJournal
+ * @brief Append-only, memory-mapped journal with group-commit syncing
+ *
+ * Appending a record copies it into the mapped file under a short lock; a
+ * background thread syncs the mapping to disk at most every commit interval,
+ * so all records written in that window share one sync. A record is therefore
+ * durable at most commitIntervalMs() after it was appended, or immediately
+ * after sync() returns.
+ *
+ * When the file is full it is compacted: records of finished transactions are
+ * dropped and the open ones are rewritten into a fresh file.
+ *
+ * Thread-safe; records are appended from the device worker and the backend's
+ * callback thread.
+ */
+class TransactionJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DefaultCapacity = 4 * 1024 * 1024;  ///< Default journal file size in bytes
+    static constexpr int DefaultCommitIntervalMs = 5;            ///< Default group-commit window
+
+    /**
+     * @brief Kind of command a transaction was created for
+     */
+    enum Command {
+        SendBasket,   ///< sendBasket
+        SendPayment   ///< sendPayment
+    };
+
+    /**
+     * @brief A journaled transaction
+     */
+    struct Entry
+    {
+        quint64 id = 0;                  ///< Journal-assigned transaction ID
+        Command command = SendPayment;   ///< Command that was sent
+        QString data;                    ///< JSON sent to the terminal
+        qint64 issuedAtMs = 0;           ///< Time the command was issued (ms since epoch)
+        bool hasResult = false;          ///< Whether the DLL call returned
+        int resultCode = 0;              ///< Result code of the DLL call, valid if hasResult
+    };
+
+    /**
+     * @brief Constructor for TransactionJournal
+     * @param parent The parent QObject (for memory management)
+     */
+    explicit TransactionJournal(QObject* parent = nullptr);
+
+    /**
+     * @brief Destructor
+     *
+     * Syncs outstanding records and closes the file.
+     */
+    ~TransactionJournal() override;
+
+    /**
+     * @brief Opens or creates the journal and recovers its open transactions
+     * @param path Journal file path
+     * @param capacity File size used when creating the journal
+     * @return true on success, false if the file cannot be created or mapped
+     *
+     * A torn record at the end of the file, left by a crash mid-write, is
+     * discarded. Transactions without an outcome are available through
+     * recoveredEntries() until reconcile() settles them.
+     */
+    bool open(const QString& path, qint64 capacity = DefaultCapacity);
+
+    /**
+     * @brief Syncs outstanding records and closes the file
+     */
+    void close();
+
+    /**
+     * @brief Checks if the journal is open
+     * @return true if open() succeeded and close() has not been called since
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Sets the group-commit window
+     * @param ms Longest time a record stays unsynced; 0 syncs on every append
+     */
+    void setCommitInterval(int ms);
+    int commitIntervalMs() const;
+
+    /**
+     * @brief Selects serial-in events that carry the terminal's outcome of a payment
+     */
+    using OutcomeFilter = std::function<bool(int typeCode, QStringView value)>;
+
+    /**
+     * @brief Sets which serial-in events complete a payment
+     * @param filter Returns true for events that carry the terminal's outcome
+     *
+     * An accepted event completes the oldest payment still waiting for its
+     * outcome. Without a filter no serial-in event does, so payments stay
+     * open until they are settled after recovery.
+     */
+    void setOutcomeFilter(OutcomeFilter filter);
+
+    /**
+     * @brief Returns a filter accepting the events of one SerialInDecoder event type
+     * @tparam Event Event type with a TypeCode and parse(), see serialindecoder.h
+     * @return Filter accepting events with Event::TypeCode whose payload parses
+     */
+    template <typename Event>
+    static OutcomeFilter outcomeFilter()
+    {
+        return [](int typeCode, QStringView value) {
+            Event event;
+            return typeCode == Event::TypeCode && Event::parse(value, event);
+        };
+    }
+
+    /**
+     * @brief Journals a command before it is sent to the terminal
+     * @param command Kind of command
+     * @param data JSON sent to the terminal
+     * @return Transaction ID, or 0 if the journal is not open
+     */
+    quint64 beginTransaction(Command command, const QString& data);
+
+    /**
+     * @brief Journals the result code of the DLL call
+     * @param id Transaction ID from beginTransaction()
+     * @param resultCode Value returned by the terminal
+     *
+     * Completes basket transactions; payments stay open until their outcome.
+     */
+    void recordResult(quint64 id, int resultCode);
+
+    /**
+     * @brief Journals that a DLL call threw; the transaction is closed
+     * @param id Transaction ID from beginTransaction()
+     * @param error Error description
+     */
+    void recordFailure(quint64 id, const QString& error);
+
+    /**
+     * @brief Offers a serial-in event as the outcome of the oldest open payment
+     * @param typeCode Code indicating the type of received data
+     * @param value The data value
+     * @return true if the event completed a payment
+     */
+    bool recordSerialIn(int typeCode, QStringView value);
+
+    /**
+     * @brief Returns the transactions recovered by open() that are still unsettled
+     * @return Entries in the order they were issued
+     */
+    QVector<Entry> recoveredEntries() const;
+
+    /**
+     * @brief Fetches the fiscal info to check all recovered transactions against
+     * @param communication Connected terminal to query
+     *
+     * Does nothing if nothing was recovered. Emits reconciliationReady() with
+     * the recovered entries and the fiscal info, against which the application
+     * matches them, or reconcileFailed() if the query fails. Entries stay
+     * recovered until settle() is called for them.
+     */
+    void reconcile(POSCommunication* communication);
+
+    /**
+     * @brief Marks transactions as settled once the application has confirmed them
+     * @param ids Transaction IDs, usually recovered entries matched against the fiscal info
+     * @param evidence Text stored with the settlement, e.g. the matching fiscal info
+     * @return Number of transactions settled; IDs that are not open are skipped
+     */
+    int settle(const QVector<quint64>& ids, const QString& evidence = QString());
+
+    /**
+     * @brief Syncs all appended records to disk
+     * @return true on success
+     */
+    bool sync();
+
+signals:
+    /**
+     * @brief Signal emitted when the fiscal info for recovered transactions has arrived
+     * @param entries The recovered transactions still unsettled
+     * @param fiscalInfo Fiscal info returned by the terminal, as JSON
+     *
+     * Call settle() for the entries the fiscal info confirms.
+     */
+    void reconciliationReady(const QVector<TransactionJournal::Entry>& entries, const QString& fiscalInfo);
+
+    /**
+     * @brief Signal emitted when the reconciliation query failed
+     * @param error Human-readable error description
+     */
+    void reconcileFailed(const QString& error);
+
+private:
+    /**
+     * @brief Type of a journal record
+     */
+    enum RecordType : quint8 {
+        Issued = 1,   ///< Command about to be sent
+        Result,       ///< DLL call returned
+        Failed,       ///< DLL call threw
+        Outcome,      ///< Outcome reported by the terminal
+        Reconciled    ///< Settled after recovery
+    };
+
+    /**
+     * @brief Appends a record (caller holds m_mutex)
+     * @param type Record type
+     * @param id Transaction ID
+     * @param code Command, result or type code, depending on the type
+     * @param text Payload text
+     * @return true on success
+     */
+    bool appendLocked(RecordType type, quint64 id, qint32 code, QStringView text);
+
+    /**
+     * @brief Applies a record to the open transactions (caller holds m_mutex)
+     */
+    void applyLocked(RecordType type, quint64 id, qint32 code, qint64 timestampMs, const QString& text);
+
+    /**
+     * @brief Rewrites the file with the open transactions only (caller holds m_mutex)
+     * @param required Bytes that must fit after compaction
+     * @return true on success
+     */
+    bool compactLocked(qint64 required);
+
+    /**
+     * @brief Maps the file and scans it (caller holds m_mutex)
+     * @return true on success
+     */
+    bool mapAndScanLocked();
+
+    /**
+     * @brief Wakes the committer, or syncs right away without a commit window
+     */
+    void scheduleCommit();
+
+    /**
+     * @brief Syncs the records appended since the last sync
+     * @return true on success
+     */
+    bool commitPending();
+
+    /**
+     * @brief Group-commit thread; syncs pending records once per commit window
+     */
+    void runCommitter();
+
+    mutable QMutex m_mutex;                 ///< Guards everything below
+    QWaitCondition m_commitWanted;          ///< Wakes the committer
+    QReadWriteLock m_mapLock;               ///< Keeps the mapping alive while it is synced
+    QString m_path;                         ///< Journal file path
+    QFile m_file;                           ///< Journal file
+    uchar* m_map;                           ///< Mapped file contents, nullptr if closed
+    qint64 m_capacity;                      ///< Mapped size in bytes
+    qint64 m_writeOffset;                   ///< End of the last record
+    qint64 m_syncedOffset;                  ///< End of the last synced record
+    quint64 m_mapGeneration;                ///< Incremented whenever the file is remapped
+    quint64 m_nextId;                       ///< ID for the next transaction
+    quint64 m_firstSessionId;               ///< First ID issued since open()
+    std::map<quint64, Entry> m_open;        ///< Unfinished transactions by ID
+    QVector<quint64> m_recovered;           ///< IDs of unfinished transactions found by open()
+    int m_commitIntervalMs;                 ///< Group-commit window
+    OutcomeFilter m_outcomeFilter;          ///< Selects outcome events, none if empty
+    bool m_stopping;                        ///< Tells the committer to exit
+    std::thread m_committer;                ///< Group-commit thread
+};
+
+Q_DECLARE_METATYPE(TransactionJournal::Entry)
+
+#endif // TRANSACTIONJOURNAL_H